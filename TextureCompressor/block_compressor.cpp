@@ -0,0 +1,342 @@
+#include "block_compressor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// weights of the 16 bc7 palette entries between the two endpoints, out of 64
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// power iterations used to find the principal axis, the covariance of 16 texels converges well before this
+static const int PRINCIPAL_AXIS_ITERATIONS = 8;
+
+static void WriteBits(uint8_t* block, uint32_t& bit, uint32_t value, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++, bit++)
+	{
+		if ((value >> i) & 1)
+			block[bit >> 3] |= 1 << (bit & 7);
+	}
+}
+
+static uint16_t PackRGB565(const float color[4])
+{
+	uint32_t r = (uint32_t)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	uint32_t g = (uint32_t)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+	uint32_t b = (uint32_t)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t packed, int color[3])
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+uint32_t BlockCompressor::GetBlockSize(Format format)
+{
+	return (format == Format::BC1) ? 8 : 16;
+}
+
+std::vector<uint8_t> BlockCompressor::CompressImage(Format format, const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+	uint32_t blocks_x = (width + 3) / 4;
+	uint32_t blocks_y = (height + 3) / 4;
+	uint32_t block_size = GetBlockSize(format);
+
+	std::vector<uint8_t> blocks((size_t)blocks_x * blocks_y * block_size, 0);
+
+	for (uint32_t by = 0; by < blocks_y; by++)
+	{
+		for (uint32_t bx = 0; bx < blocks_x; bx++)
+		{
+			// gather the block's texels, clamped to the image for levels smaller than a block
+			uint8_t texels[16][4];
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t x = std::min(bx * 4 + (i & 3), width - 1);
+				uint32_t y = std::min(by * 4 + (i >> 2), height - 1);
+				memcpy(texels[i], pixels + ((size_t)y * width + x) * 4, 4);
+			}
+
+			uint8_t* block = &blocks[((size_t)by * blocks_x + bx) * block_size];
+
+			switch (format)
+			{
+			case Format::BC1:
+				CompressBC1Block(texels, block);
+				break;
+			case Format::BC3:
+				// the alpha block comes first, the colour block is always read in its four colour mode
+				CompressAlphaBlock(texels, block);
+				CompressBC1Block(texels, block + 8);
+				break;
+			case Format::BC7:
+				CompressBC7Block(texels, block);
+				break;
+			}
+		}
+	}
+
+	return blocks;
+}
+
+void BlockCompressor::CompressBC1Block(const uint8_t texels[16][4], uint8_t* block)
+{
+	float min_endpoint[4], max_endpoint[4];
+	FindEndpoints(texels, 3, min_endpoint, max_endpoint);
+
+	// the four colour mode needs the first endpoint to be the larger one
+	uint16_t color0 = PackRGB565(max_endpoint);
+	uint16_t color1 = PackRGB565(min_endpoint);
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	// the palette the decoder will rebuild from the quantized endpoints
+	int palette[4][3];
+	UnpackRGB565(color0, palette[0]);
+	UnpackRGB565(color1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			int best_index = 0, best_error = INT32_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+					error += (texels[i][c] - palette[p][c]) * (texels[i][c] - palette[p][c]);
+
+				if (error < best_error)
+				{
+					best_error = error;
+					best_index = p;
+				}
+			}
+			indices |= best_index << (i * 2);
+		}
+	}
+
+	block[0] = color0 & 0xFF;
+	block[1] = color0 >> 8;
+	block[2] = color1 & 0xFF;
+	block[3] = color1 >> 8;
+	block[4] = indices & 0xFF;
+	block[5] = (indices >> 8) & 0xFF;
+	block[6] = (indices >> 16) & 0xFF;
+	block[7] = indices >> 24;
+}
+
+void BlockCompressor::CompressAlphaBlock(const uint8_t texels[16][4], uint8_t* block)
+{
+	int alpha0 = 0, alpha1 = 255;
+	for (int i = 0; i < 16; i++)
+	{
+		alpha0 = std::max(alpha0, (int)texels[i][3]);
+		alpha1 = std::min(alpha1, (int)texels[i][3]);
+	}
+
+	memset(block, 0, 8);
+	block[0] = (uint8_t)alpha0;
+	block[1] = (uint8_t)alpha1;
+
+	// a flat block leaves every index on the first endpoint
+	if (alpha0 == alpha1)
+		return;
+
+	// the eight value mode, the first endpoint is the larger one
+	int palette[8];
+	palette[0] = alpha0;
+	palette[1] = alpha1;
+	for (int p = 2; p < 8; p++)
+		palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+
+	uint32_t bit = 16;
+	for (int i = 0; i < 16; i++)
+	{
+		int best_index = 0, best_error = INT32_MAX;
+		for (int p = 0; p < 8; p++)
+		{
+			int error = std::abs(texels[i][3] - palette[p]);
+			if (error < best_error)
+			{
+				best_error = error;
+				best_index = p;
+			}
+		}
+		WriteBits(block, bit, best_index, 3);
+	}
+}
+
+void BlockCompressor::CompressBC7Block(const uint8_t texels[16][4], uint8_t* block)
+{
+	float endpoints[2][4];
+	FindEndpoints(texels, 4, endpoints[0], endpoints[1]);
+
+	// mode 6 stores 7 bits per channel and one shared low bit per endpoint, the low bit is picked to minimise the error
+	int quantized[2][4], p_bits[2], values[2][4];
+	for (int e = 0; e < 2; e++)
+	{
+		int best_error = INT32_MAX;
+		for (int p = 0; p < 2; p++)
+		{
+			int error = 0;
+			int candidate[4];
+			for (int c = 0; c < 4; c++)
+			{
+				candidate[c] = std::min(std::max((int)floorf((endpoints[e][c] - p) / 2.0f + 0.5f), 0), 127);
+				int value = (candidate[c] << 1) | p;
+				error += (int)((value - endpoints[e][c]) * (value - endpoints[e][c]));
+			}
+
+			if (error < best_error)
+			{
+				best_error = error;
+				p_bits[e] = p;
+				memcpy(quantized[e], candidate, sizeof(candidate));
+			}
+		}
+
+		for (int c = 0; c < 4; c++)
+			values[e][c] = (quantized[e][c] << 1) | p_bits[e];
+	}
+
+	int palette[16][4];
+	for (int p = 0; p < 16; p++)
+	{
+		for (int c = 0; c < 4; c++)
+			palette[p][c] = ((64 - BC7_WEIGHTS[p]) * values[0][c] + BC7_WEIGHTS[p] * values[1][c] + 32) >> 6;
+	}
+
+	int indices[16];
+	for (int i = 0; i < 16; i++)
+	{
+		int best_index = 0, best_error = INT32_MAX;
+		for (int p = 0; p < 16; p++)
+		{
+			int error = 0;
+			for (int c = 0; c < 4; c++)
+				error += (texels[i][c] - palette[p][c]) * (texels[i][c] - palette[p][c]);
+
+			if (error < best_error)
+			{
+				best_error = error;
+				best_index = p;
+			}
+		}
+		indices[i] = best_index;
+	}
+
+	// the first index is stored without its top bit, so the endpoints are swapped if it would need one
+	if (indices[0] >= 8)
+	{
+		for (int c = 0; c < 4; c++)
+			std::swap(quantized[0][c], quantized[1][c]);
+		std::swap(p_bits[0], p_bits[1]);
+
+		for (int i = 0; i < 16; i++)
+			indices[i] = 15 - indices[i];
+	}
+
+	memset(block, 0, 16);
+	uint32_t bit = 0;
+
+	WriteBits(block, bit, 1 << 6, 7);
+	for (int c = 0; c < 4; c++)
+	{
+		WriteBits(block, bit, quantized[0][c], 7);
+		WriteBits(block, bit, quantized[1][c], 7);
+	}
+	WriteBits(block, bit, p_bits[0], 1);
+	WriteBits(block, bit, p_bits[1], 1);
+
+	WriteBits(block, bit, indices[0], 3);
+	for (int i = 1; i < 16; i++)
+		WriteBits(block, bit, indices[i], 4);
+}
+
+void BlockCompressor::FindEndpoints(const uint8_t texels[16][4], int channels, float min_endpoint[4], float max_endpoint[4])
+{
+	float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < channels; c++)
+			mean[c] += texels[i][c] / 16.0f;
+	}
+
+	float covariance[4][4] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < channels; b++)
+				covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+		}
+	}
+
+	// start from the covariance of the channel that varies most, the iteration turns it towards the axis of greatest variance
+	int widest = 0;
+	for (int c = 1; c < channels; c++)
+	{
+		if (covariance[c][c] > covariance[widest][widest])
+			widest = c;
+	}
+
+	float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int c = 0; c < channels; c++)
+		axis[c] = covariance[c][widest];
+	for (int iteration = 0; iteration < PRINCIPAL_AXIS_ITERATIONS; iteration++)
+	{
+		float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float length = 0.0f;
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < channels; b++)
+				next[a] += covariance[a][b] * axis[b];
+			length += next[a] * next[a];
+		}
+
+		// a flat block has no variance, any axis spans it
+		if (length < 1e-6f)
+			break;
+
+		length = sqrtf(length);
+		for (int a = 0; a < channels; a++)
+			axis[a] = next[a] / length;
+	}
+
+	float min_t = 0.0f, max_t = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+			t += (texels[i][c] - mean[c]) * axis[c];
+
+		min_t = std::min(min_t, t);
+		max_t = std::max(max_t, t);
+	}
+
+	for (int c = 0; c < 4; c++)
+	{
+		if (c < channels)
+		{
+			min_endpoint[c] = std::min(std::max(mean[c] + axis[c] * min_t, 0.0f), 255.0f);
+			max_endpoint[c] = std::min(std::max(mean[c] + axis[c] * max_t, 0.0f), 255.0f);
+		}
+		else
+		{
+			min_endpoint[c] = 255.0f;
+			max_endpoint[c] = 255.0f;
+		}
+	}
+}
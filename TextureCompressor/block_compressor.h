@@ -0,0 +1,33 @@
+#ifndef _BLOCK_COMPRESSOR_H_
+#define _BLOCK_COMPRESSOR_H_
+
+#include <stdint.h>
+#include <vector>
+
+// encodes rgba8 images into the bc block formats, one 4x4 block at a time
+class BlockCompressor
+{
+public:
+	enum class Format
+	{
+		BC1,	// opaque rgb, 8 bytes per block
+		BC3,	// rgb with interpolated alpha, 16 bytes per block
+		BC7		// rgba at higher quality, 16 bytes per block, only mode 6 is written
+	};
+
+public:
+	static uint32_t GetBlockSize(Format format);
+
+	// compresses a whole image, texels past the right and bottom edges repeat the edge texel
+	static std::vector<uint8_t> CompressImage(Format format, const uint8_t* pixels, uint32_t width, uint32_t height);
+
+protected:
+	static void CompressBC1Block(const uint8_t texels[16][4], uint8_t* block);
+	static void CompressAlphaBlock(const uint8_t texels[16][4], uint8_t* block);
+	static void CompressBC7Block(const uint8_t texels[16][4], uint8_t* block);
+
+	// the endpoints of the texels' principal axis over the given channels, found by power iteration on their covariance
+	static void FindEndpoints(const uint8_t texels[16][4], int channels, float min_endpoint[4], float max_endpoint[4]);
+};
+
+#endif
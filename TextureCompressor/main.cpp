@@ -0,0 +1,248 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include "block_compressor.h"
+#include "../VulkanApp/ktx2.h"
+
+// khronos data format descriptor values for the block compressed colour models, see the khr_df specification
+static const uint32_t DFD_MODEL_BC1A = 128;
+static const uint32_t DFD_MODEL_BC3 = 130;
+static const uint32_t DFD_MODEL_BC7 = 136;
+static const uint32_t DFD_CHANNEL_COLOR = 0;
+static const uint32_t DFD_CHANNEL_ALPHA = 15;
+static const uint32_t DFD_PRIMARIES_BT709 = 1;
+static const uint32_t DFD_TRANSFER_LINEAR = 1;
+
+// the texture loader uploads unorm formats, matching the rgba8 images it decodes without a compressed copy
+static VkFormat GetVkFormat(BlockCompressor::Format format)
+{
+	switch (format)
+	{
+	case BlockCompressor::Format::BC1:
+		return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case BlockCompressor::Format::BC3:
+		return VK_FORMAT_BC3_UNORM_BLOCK;
+	default:
+		return VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+}
+
+// a basic data format descriptor block with one sample per plane of the block
+static std::vector<uint32_t> BuildDataFormatDescriptor(BlockCompressor::Format format)
+{
+	struct Sample
+	{
+		uint32_t bit_offset, bit_length, channel;
+	};
+
+	std::vector<Sample> samples;
+	uint32_t color_model;
+
+	switch (format)
+	{
+	case BlockCompressor::Format::BC1:
+		color_model = DFD_MODEL_BC1A;
+		samples.push_back({ 0, 64, DFD_CHANNEL_COLOR });
+		break;
+	case BlockCompressor::Format::BC3:
+		color_model = DFD_MODEL_BC3;
+		samples.push_back({ 0, 64, DFD_CHANNEL_ALPHA });
+		samples.push_back({ 64, 64, DFD_CHANNEL_COLOR });
+		break;
+	default:
+		color_model = DFD_MODEL_BC7;
+		samples.push_back({ 0, 128, DFD_CHANNEL_COLOR });
+		break;
+	}
+
+	uint32_t block_size = 24 + 16 * static_cast<uint32_t>(samples.size());
+
+	std::vector<uint32_t> dfd;
+	dfd.push_back(4 + block_size);
+	dfd.push_back(0);														// khronos vendor, basic descriptor type
+	dfd.push_back(2 | (block_size << 16));									// version 2 and the block's size
+	dfd.push_back(color_model | (DFD_PRIMARIES_BT709 << 8) | (DFD_TRANSFER_LINEAR << 16));
+	dfd.push_back(3 | (3 << 8));											// 4x4 texel blocks, stored as the dimension minus one
+	dfd.push_back(BlockCompressor::GetBlockSize(format));					// bytes per block in the single plane
+	dfd.push_back(0);
+
+	for (const Sample& sample : samples)
+	{
+		dfd.push_back(sample.bit_offset | ((sample.bit_length - 1) << 16) | (sample.channel << 24));
+		dfd.push_back(0);
+		dfd.push_back(0);
+		dfd.push_back(UINT32_MAX);
+	}
+
+	return dfd;
+}
+
+// averages each 2x2 block into the next level, odd edges are clamped
+static void DownsampleLevel(const std::vector<uint8_t>& src, uint32_t src_width, uint32_t src_height, std::vector<uint8_t>& dst)
+{
+	uint32_t dst_width = std::max(src_width / 2, 1u);
+	uint32_t dst_height = std::max(src_height / 2, 1u);
+	dst.resize((size_t)dst_width * dst_height * 4);
+
+	for (uint32_t y = 0; y < dst_height; y++)
+	{
+		uint32_t y0 = std::min(y * 2, src_height - 1);
+		uint32_t y1 = std::min(y * 2 + 1, src_height - 1);
+
+		for (uint32_t x = 0; x < dst_width; x++)
+		{
+			uint32_t x0 = std::min(x * 2, src_width - 1);
+			uint32_t x1 = std::min(x * 2 + 1, src_width - 1);
+
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				uint32_t sum = src[((size_t)y0 * src_width + x0) * 4 + c] + src[((size_t)y0 * src_width + x1) * 4 + c] + src[((size_t)y1 * src_width + x0) * 4 + c] + src[((size_t)y1 * src_width + x1) * 4 + c];
+				dst[((size_t)y * dst_width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+			}
+		}
+	}
+}
+
+static size_t AlignTo(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: TextureCompressor <image> [bc1|bc3|bc7]" << std::endl;
+		std::cout << "writes <image>.ktx2 next to the image with a full mip chain, bc1 for opaque images and bc3 otherwise by default" << std::endl;
+		return 1;
+	}
+
+	std::string filename = argv[1];
+
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(filename.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels)
+	{
+		std::cerr << "failed to load " << filename << "!" << std::endl;
+		return 1;
+	}
+
+	std::vector<uint8_t> level((size_t)width * height * 4);
+	memcpy(level.data(), pixels, level.size());
+	stbi_image_free(pixels);
+
+	// bc1 has no alpha worth keeping, so images with any translucency default to bc3
+	bool opaque = true;
+	for (size_t i = 3; i < level.size(); i += 4)
+		opaque = opaque && (level[i] == 255);
+
+	BlockCompressor::Format format = opaque ? BlockCompressor::Format::BC1 : BlockCompressor::Format::BC3;
+	if (argc > 2)
+	{
+		std::string format_name = argv[2];
+		if (format_name == "bc1")
+			format = BlockCompressor::Format::BC1;
+		else if (format_name == "bc3")
+			format = BlockCompressor::Format::BC3;
+		else if (format_name == "bc7")
+			format = BlockCompressor::Format::BC7;
+		else
+		{
+			std::cerr << "unknown format " << format_name << "!" << std::endl;
+			return 1;
+		}
+	}
+
+	// compress every level down to a single texel along the longer side
+	std::vector<std::vector<uint8_t>> compressed_levels;
+	uint32_t level_width = width, level_height = height;
+	while (true)
+	{
+		compressed_levels.push_back(BlockCompressor::CompressImage(format, level.data(), level_width, level_height));
+
+		if (level_width == 1 && level_height == 1)
+			break;
+
+		std::vector<uint8_t> next_level;
+		DownsampleLevel(level, level_width, level_height, next_level);
+		level.swap(next_level);
+		level_width = std::max(level_width / 2, 1u);
+		level_height = std::max(level_height / 2, 1u);
+	}
+
+	uint32_t level_count = static_cast<uint32_t>(compressed_levels.size());
+	std::vector<uint32_t> dfd = BuildDataFormatDescriptor(format);
+
+	KTX2Header header = {};
+	memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.vk_format = GetVkFormat(format);
+	header.type_size = 1;
+	header.pixel_width = width;
+	header.pixel_height = height;
+	header.pixel_depth = 0;
+	header.layer_count = 0;
+	header.face_count = 1;
+	header.level_count = level_count;
+	header.supercompression_scheme = 0;
+	header.dfd_byte_offset = static_cast<uint32_t>(sizeof(KTX2Header) + sizeof(KTX2LevelIndex) * level_count);
+	header.dfd_byte_length = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+	// the levels are stored smallest first, each aligned to its block size
+	size_t block_size = BlockCompressor::GetBlockSize(format);
+	std::vector<KTX2LevelIndex> level_index(level_count);
+	size_t offset = header.dfd_byte_offset + header.dfd_byte_length;
+	for (uint32_t i = level_count; i > 0; i--)
+	{
+		offset = AlignTo(offset, block_size);
+		level_index[i - 1].byte_offset = offset;
+		level_index[i - 1].byte_length = compressed_levels[i - 1].size();
+		level_index[i - 1].uncompressed_byte_length = compressed_levels[i - 1].size();
+		offset += compressed_levels[i - 1].size();
+	}
+
+	std::string output_filename = filename.substr(0, filename.find_last_of('.')) + ".ktx2";
+	std::ofstream file(output_filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "failed to open " << output_filename << "!" << std::endl;
+		return 1;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(KTX2Header));
+	file.write(reinterpret_cast<const char*>(level_index.data()), sizeof(KTX2LevelIndex) * level_count);
+	file.write(reinterpret_cast<const char*>(dfd.data()), dfd.size() * sizeof(uint32_t));
+
+	for (uint32_t i = level_count; i > 0; i--)
+	{
+		static const char padding[16] = {};
+		size_t position = static_cast<size_t>(file.tellp());
+		file.write(padding, level_index[i - 1].byte_offset - position);
+		file.write(reinterpret_cast<const char*>(compressed_levels[i - 1].data()), compressed_levels[i - 1].size());
+	}
+
+	if (!file)
+	{
+		std::cerr << "failed to write " << output_filename << "!" << std::endl;
+		return 1;
+	}
+
+	// the uncompressed size counts the same mip chain as rgba8
+	size_t compressed_size = 0, uncompressed_size = 0;
+	for (uint32_t i = 0; i < level_count; i++)
+	{
+		compressed_size += compressed_levels[i].size();
+		uncompressed_size += (size_t)std::max(width >> i, 1) * std::max(height >> i, 1) * 4;
+	}
+
+	const char* format_names[] = { "BC1", "BC3", "BC7" };
+	std::cout << "Wrote " << output_filename << ": " << width << "x" << height << ", " << level_count << " levels of " << format_names[static_cast<int>(format)]
+		<< ", " << compressed_size / 1024 << " KB from " << uncompressed_size / 1024 << " KB of rgba8" << std::endl;
+
+	return 0;
+}
@@ -1,10 +1,78 @@
 #include "HDR.h"
+#include <iostream>
+#include <algorithm>
+
+// blur from tiles loaded into shared memory, otherwise each texel gathers its taps from the source image
+#define SHARED_MEMORY_BLUR
+
+// bloom through a dual filter downsample and upsample pyramid instead of the two pass gaussian blur
+#define DUAL_FILTER_BLOOM
+
+// expose the scene from a gpu luminance histogram instead of the fixed exposure level
+#define AUTO_EXPOSURE
+
+// store the half resolution images in a packed float format when the device can write one, otherwise in half floats
+#define PACKED_HDR_FORMATS
+
+// time each stage of the chain with timestamp queries and print the average milliseconds and estimated bandwidth per stage
+//#define HDR_STAGE_TIMING
+
+static const int BLUR_RADIUS = 8;
+static const uint32_t STAGE_TIMING_REPORT_INTERVAL = 600;
+static const uint32_t BLOOM_MAX_LEVELS = 6;
+static const uint32_t BLOOM_DEFAULT_LEVELS = 5;
+
+// must match HISTOGRAM_BINS in luminance_histogram.comp and exposure_adapt.comp
+static const uint32_t LUMINANCE_HISTOGRAM_BINS = 256;
+
+// the histogram covers luminances from 2^-8 to 2^4, the exposure closes the gap to its target at this rate per second
+static const float MIN_LOG_LUMINANCE = -8.0f;
+static const float LOG_LUMINANCE_RANGE = 12.0f;
+static const float EXPOSURE_ADAPTATION_RATE = 3.0f;
+static const float EXPOSURE_KEY = 0.18f;
+
+// timestamps before the chain, after the suppress pass, after each blur pass and after the tonemap
+static const uint32_t HDR_STAGE_TIMESTAMPS = 5;
+
+// passes of the chain the half resolution images are used in, images whose passes never overlap share memory
+static const uint32_t HDR_PASS_LDR_SUPPRESS = 0;
+static const uint32_t HDR_PASS_BLUR_FIRST = 1;
+static const uint32_t HDR_PASS_BLUR_SECOND = 2;
+static const uint32_t HDR_PASS_TONEMAP = 3;
 
 void HDR::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VkCommandPool command_pool)
 {
 	devices_ = devices;
-
-	InitResources();
+	intermediate_image_ = swap_chain->GetIntermediateImage();
+	command_pool_ = command_pool;
+
+#ifdef SHARED_MEMORY_BLUR
+	shared_memory_blur_ = true;
+#else
+	shared_memory_blur_ = false;
+#endif
+
+#ifdef DUAL_FILTER_BLOOM
+	dual_filter_bloom_ = true;
+#else
+	dual_filter_bloom_ = false;
+#endif
+
+#ifdef AUTO_EXPOSURE
+	auto_exposure_ = true;
+#else
+	auto_exposure_ = false;
+#endif
+
+#ifdef PACKED_HDR_FORMATS
+	packed_hdr_formats_ = true;
+#else
+	packed_hdr_formats_ = false;
+#endif
+	bloom_levels_ = BLOOM_DEFAULT_LEVELS;
+	bloom_max_levels_ = BLOOM_MAX_LEVELS;
+
+	InitResources(swap_chain);
 	InitShaders(swap_chain);
 	InitPipelines(swap_chain);
 	InitCommandBuffers(command_pool);
@@ -17,264 +85,430 @@ void HDR::Cleanup()
 	delete ldr_suppress_shader_;
 	ldr_suppress_shader_ = nullptr;
 
-	gaussian_blur_shader_->Cleanup();
-	delete gaussian_blur_shader_;
-	gaussian_blur_shader_ = nullptr;
+	if (dual_filter_bloom_)
+	{
+		bloom_downsample_shader_->Cleanup();
+		delete bloom_downsample_shader_;
+		bloom_downsample_shader_ = nullptr;
+
+		bloom_upsample_shader_->Cleanup();
+		delete bloom_upsample_shader_;
+		bloom_upsample_shader_ = nullptr;
+	}
+	else
+	{
+		gaussian_blur_shader_->Cleanup();
+		delete gaussian_blur_shader_;
+		gaussian_blur_shader_ = nullptr;
+	}
 
 	tonemap_shader_->Cleanup();
 	delete tonemap_shader_;
 	tonemap_shader_ = nullptr;
 
-	// clean up samplers
-	vkDestroySampler(devices_->GetLogicalDevice(), buffer_sampler_, nullptr);
+	if (auto_exposure_)
+	{
+		luminance_histogram_shader_->Cleanup();
+		delete luminance_histogram_shader_;
+		luminance_histogram_shader_ = nullptr;
 
-	// clean up buffers
-	vkDestroyBuffer(devices_->GetLogicalDevice(), gaussian_blur_factors_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), gaussian_blur_factors_buffer_memory_, nullptr);
+		exposure_adapt_shader_->Cleanup();
+		delete exposure_adapt_shader_;
+		exposure_adapt_shader_ = nullptr;
+	}
 
+	// clean up buffers
 	vkDestroyBuffer(devices_->GetLogicalDevice(), tonemap_factors_buffer_, nullptr);
 	vkFreeMemory(devices_->GetLogicalDevice(), tonemap_factors_buffer_memory_, nullptr);
 
-	// clean up render targets
-	ldr_suppress_scene_->Cleanup();
-	delete ldr_suppress_scene_;
-	ldr_suppress_scene_ = nullptr;
+	vkDestroyBuffer(devices_->GetLogicalDevice(), render_region_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), render_region_buffer_memory_, nullptr);
+
+	vkDestroyBuffer(devices_->GetLogicalDevice(), histogram_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), histogram_buffer_memory_, nullptr);
+
+	vkDestroyBuffer(devices_->GetLogicalDevice(), exposure_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), exposure_buffer_memory_, nullptr);
 
-	blur_scene_->Cleanup();
-	delete blur_scene_;
-	blur_scene_ = nullptr;
+	// clean up the half resolution images
+	transient_images_->Cleanup();
+	delete transient_images_;
+	transient_images_ = nullptr;
+	blur_images_.clear();
+
+	// clean up the bloom pyramid
+	if (dual_filter_bloom_)
+	{
+		for (VkImageView level_view : bloom_level_views_)
+		{
+			vkDestroyImageView(devices_->GetLogicalDevice(), level_view, nullptr);
+		}
+		bloom_level_views_.clear();
 
-	tonemap_scene_->Cleanup();
-	delete tonemap_scene_;
-	tonemap_scene_ = nullptr;
+		vkDestroyImage(devices_->GetLogicalDevice(), bloom_image_, nullptr);
+		vkFreeMemory(devices_->GetLogicalDevice(), bloom_image_memory_, nullptr);
+	}
 
 	// clean up pipelines
 	ldr_suppress_pipeline_->CleanUp();
 	delete ldr_suppress_pipeline_;
 	ldr_suppress_pipeline_ = nullptr;
 
-	gaussian_blur_pipeline_[0]->CleanUp();
-	delete gaussian_blur_pipeline_[0];
-	gaussian_blur_pipeline_[0] = nullptr;
+	if (dual_filter_bloom_)
+	{
+		for (HDRPipeline* pipeline : bloom_downsample_pipelines_)
+		{
+			pipeline->CleanUp();
+			delete pipeline;
+		}
+		bloom_downsample_pipelines_.clear();
 
-	gaussian_blur_pipeline_[1]->CleanUp();
-	delete gaussian_blur_pipeline_[1];
-	gaussian_blur_pipeline_[1] = nullptr;
+		for (HDRPipeline* pipeline : bloom_upsample_pipelines_)
+		{
+			pipeline->CleanUp();
+			delete pipeline;
+		}
+		bloom_upsample_pipelines_.clear();
+	}
+	else
+	{
+		gaussian_blur_pipeline_[0]->CleanUp();
+		delete gaussian_blur_pipeline_[0];
+		gaussian_blur_pipeline_[0] = nullptr;
+
+		gaussian_blur_pipeline_[1]->CleanUp();
+		delete gaussian_blur_pipeline_[1];
+		gaussian_blur_pipeline_[1] = nullptr;
+	}
 
 	tonemap_pipeline_->CleanUp();
 	delete tonemap_pipeline_;
 	tonemap_pipeline_ = nullptr;
 
+	if (auto_exposure_)
+	{
+		luminance_histogram_pipeline_->CleanUp();
+		delete luminance_histogram_pipeline_;
+		luminance_histogram_pipeline_ = nullptr;
+
+		exposure_adapt_pipeline_->CleanUp();
+		delete exposure_adapt_pipeline_;
+		exposure_adapt_pipeline_ = nullptr;
+	}
+
 	// clean up semaphores
-	vkDestroySemaphore(devices_->GetLogicalDevice(), ldr_suppress_semaphore_, nullptr);
-	vkDestroySemaphore(devices_->GetLogicalDevice(), gaussian_blur_semaphore_[0], nullptr);
-	vkDestroySemaphore(devices_->GetLogicalDevice(), gaussian_blur_semaphore_[1], nullptr);
 	vkDestroySemaphore(devices_->GetLogicalDevice(), hdr_semaphore_, nullptr);
+
+	if (stage_query_pool_ != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(devices_->GetLogicalDevice(), stage_query_pool_, nullptr);
+		stage_query_pool_ = VK_NULL_HANDLE;
+	}
 }
 
-void HDR::Render(VulkanSwapChain* swap_chain, VkSemaphore* wait_semaphore)
+void HDR::Render(VkSemaphore* wait_semaphore)
 {
 	VkQueue graphics_queue;
 	vkGetDeviceQueue(devices_->GetLogicalDevice(), devices_->GetQueueFamilyIndices().graphics_family, 0, &graphics_queue);
 
+	// read back the previous submission's stage timings before the queries are reset
+	if (stage_query_pool_ != VK_NULL_HANDLE)
+		ReportStageTimings();
+
+	// the chain starts by transitioning the intermediate image away from the color attachment layout
 	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
+	// submit the hdr command buffer
 	VkSubmitInfo submit_info = {};
-	VkSemaphore signal_semaphores[1];
-
-	// clear the render targets
-	ldr_suppress_scene_->ClearImage();
-	blur_scene_->ClearImage();
-	tonemap_scene_->ClearImage();
-
-	// suppress low dynamic range pixels and downscaled image
-	// submit the draw command buffer
 	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submit_info.waitSemaphoreCount = 1;
 	submit_info.pWaitSemaphores = wait_semaphore;
 	submit_info.pWaitDstStageMask = wait_stages;
 	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &ldr_suppress_command_buffer_;
-
-	signal_semaphores[0] = ldr_suppress_semaphore_;
+	submit_info.pCommandBuffers = &hdr_command_buffer_;
 	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	submit_info.pSignalSemaphores = &hdr_semaphore_;
 
-	VkResult result = vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+	if (vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
 	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
+		throw std::runtime_error("failed to submit hdr command buffer!");
 	}
+}
 
-	// apply a gaussian blur filter to the image
-	// horizontal filter
-	GaussianBlurFactors blur_factors =
-	{
-		8.0f,
-		glm::vec2(1.0f, 0.0f),
-		0.0f
-	};
-	devices_->CopyDataToBuffer(gaussian_blur_factors_buffer_memory_, &blur_factors, sizeof(GaussianBlurFactors));
+void HDR::RecordRenderRegionUpdate(VkCommandBuffer command_buffer, VkExtent2D render_extent, float frame_time)
+{
+	// written in the scene's command buffer, the semaphore the chain waits on makes it visible to the tonemap and exposure passes
+	RenderRegion render_region = {};
+	render_region.extent = glm::ivec2(render_extent.width, render_extent.height);
+	render_region.frame_time = frame_time;
+	vkCmdUpdateBuffer(command_buffer, render_region_buffer_, 0, sizeof(RenderRegion), &render_region);
+}
 
-	// submit the draw command buffer
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = &ldr_suppress_semaphore_;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &gaussian_blur_command_buffers_[0];
+void HDR::UpdateRenderRegion(VkExtent2D render_extent, float frame_time)
+{
+	// for scenes recorded once at init, staged through the transfer queue instead
+	RenderRegion render_region = {};
+	render_region.extent = glm::ivec2(render_extent.width, render_extent.height);
+	render_region.frame_time = frame_time;
+	devices_->UploadDataToBuffer(render_region_buffer_, &render_region, sizeof(RenderRegion));
+}
 
-	signal_semaphores[0] = gaussian_blur_semaphore_[0];
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+void HDR::InitPipelines(VulkanSwapChain* swap_chain)
+{
+	VkExtent2D swap_chain_dimensions = swap_chain->GetSwapChainExtent();
+	uint32_t half_width = swap_chain_dimensions.width / 2;
+	uint32_t half_height = swap_chain_dimensions.height / 2;
+	blur_extent_ = { half_width, half_height };
+
+	// initialize the half resolution images, the compute stages keep them in the general layout
+	hdr_format_ = ChooseHDRFormat(swap_chain->GetIntermediateImageFormat());
+	VkFormat hdr_format = hdr_format_;
+	VkImageUsageFlags hdr_usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 
-	result = vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+	transient_images_ = new TransientImagePool();
+	transient_images_->Init(devices_);
+
+	// the bloom pyramid's last upsample writes the suppressed image in place, so it is also the blurred image
+	// the gaussian blur's vertical pass can reuse the suppressed image's memory, the horizontal pass has finished reading it
+	if (dual_filter_bloom_)
+	{
+		ldr_suppress_image_ = transient_images_->AddImage(half_width, half_height, hdr_format, hdr_usage, HDR_PASS_LDR_SUPPRESS, HDR_PASS_TONEMAP);
+		blur_images_.push_back(ldr_suppress_image_);
+	}
+	else
 	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
+		ldr_suppress_image_ = transient_images_->AddImage(half_width, half_height, hdr_format, hdr_usage, HDR_PASS_LDR_SUPPRESS, HDR_PASS_BLUR_FIRST);
+		blur_images_.push_back(transient_images_->AddImage(half_width, half_height, hdr_format, hdr_usage, HDR_PASS_BLUR_FIRST, HDR_PASS_BLUR_SECOND));
+		blur_images_.push_back(transient_images_->AddImage(half_width, half_height, hdr_format, hdr_usage, HDR_PASS_BLUR_SECOND, HDR_PASS_TONEMAP));
 	}
 
-	// vertical filter
-	blur_factors.direction = glm::vec2(0.0f, 1.0f);
-	devices_->CopyDataToBuffer(gaussian_blur_factors_buffer_memory_, &blur_factors, sizeof(GaussianBlurFactors));
+	transient_images_->Allocate();
 
-	// submit the draw command buffer
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = &gaussian_blur_semaphore_[0];
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &gaussian_blur_command_buffers_[1];
+	for (uint32_t i = 0; i < transient_images_->GetImageCount(); i++)
+	{
+		devices_->TransitionImageLayout(transient_images_->GetImage(i), hdr_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+	}
 
-	signal_semaphores[0] = gaussian_blur_semaphore_[1];
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	std::cout << "HDR images are " << ((hdr_format == VK_FORMAT_B10G11R11_UFLOAT_PACK32) ? "B10G11R11 packed floats" : (hdr_format == VK_FORMAT_R16G16B16A16_SFLOAT) ? "RGBA16 floats" : "the intermediate format") << std::endl;
+	std::cout << "HDR images use " << transient_images_->GetMemorySize() / (1024 * 1024) << " MB, " << transient_images_->GetUnaliasedMemorySize() / (1024 * 1024) << " MB without aliasing" << std::endl;
 
-	result = vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+	// initialize the ldr suppresssion pipeline
+	ldr_suppress_pipeline_ = new HDRPipeline();
+	ldr_suppress_pipeline_->SetShader(ldr_suppress_shader_);
+	ldr_suppress_pipeline_->SetOutputSize(half_width, half_height);
+	ldr_suppress_pipeline_->AddStorageImage(0, swap_chain->GetIntermediateImageView());
+	ldr_suppress_pipeline_->AddStorageImage(1, transient_images_->GetImageView(ldr_suppress_image_));
+	ldr_suppress_pipeline_->AddUniformBuffer(2, render_region_buffer_, sizeof(RenderRegion));
+	ldr_suppress_pipeline_->Init(devices_);
+
+	if (dual_filter_bloom_)
+		InitBloomPipelines(swap_chain);
+	else
+		InitGaussianBlurPipelines(half_width, half_height);
+	
+	// intialize the tonemap pipeline
+	tonemap_pipeline_ = new HDRPipeline();
+	tonemap_pipeline_->SetShader(tonemap_shader_);
+	tonemap_pipeline_->SetOutputSize(swap_chain_dimensions.width, swap_chain_dimensions.height);
+	tonemap_pipeline_->AddUniformBuffer(0, tonemap_factors_buffer_, sizeof(TonemapFactors));
+	tonemap_pipeline_->AddStorageImage(1, swap_chain->GetIntermediateImageView());
+	tonemap_pipeline_->AddTexture(2, transient_images_->GetImageView(blur_images_.back()), VK_IMAGE_LAYOUT_GENERAL);
+	tonemap_pipeline_->AddStorageBuffer(3, exposure_buffer_, sizeof(ExposureData));
+	tonemap_pipeline_->AddUniformBuffer(4, render_region_buffer_, sizeof(RenderRegion));
+	tonemap_pipeline_->Init(devices_);
+
+	if (auto_exposure_)
 	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
+		ExposureFactors exposure_factors =
+		{
+			MIN_LOG_LUMINANCE,
+			LOG_LUMINANCE_RANGE,
+			EXPOSURE_ADAPTATION_RATE,
+			EXPOSURE_KEY
+		};
+
+		// initialize the luminance histogram pipeline, it reads the full resolution scene
+		luminance_histogram_pipeline_ = new HDRPipeline();
+		luminance_histogram_pipeline_->SetShader(luminance_histogram_shader_);
+		luminance_histogram_pipeline_->SetOutputSize(swap_chain_dimensions.width, swap_chain_dimensions.height);
+		luminance_histogram_pipeline_->SetPushConstants(&exposure_factors, sizeof(ExposureFactors));
+		luminance_histogram_pipeline_->AddStorageImage(0, swap_chain->GetIntermediateImageView());
+		luminance_histogram_pipeline_->AddStorageBuffer(1, histogram_buffer_, sizeof(uint32_t) * LUMINANCE_HISTOGRAM_BINS);
+		luminance_histogram_pipeline_->AddUniformBuffer(2, render_region_buffer_, sizeof(RenderRegion));
+		luminance_histogram_pipeline_->Init(devices_);
+
+		// initialize the exposure pipeline, a single workgroup with one invocation per bin
+		exposure_adapt_pipeline_ = new HDRPipeline();
+		exposure_adapt_pipeline_->SetShader(exposure_adapt_shader_);
+		exposure_adapt_pipeline_->SetWorkgroupSize(LUMINANCE_HISTOGRAM_BINS, 1);
+		exposure_adapt_pipeline_->SetOutputSize(1, 1);
+		exposure_adapt_pipeline_->SetPushConstants(&exposure_factors, sizeof(ExposureFactors));
+		exposure_adapt_pipeline_->AddStorageBuffer(0, histogram_buffer_, sizeof(uint32_t) * LUMINANCE_HISTOGRAM_BINS);
+		exposure_adapt_pipeline_->AddStorageBuffer(1, exposure_buffer_, sizeof(ExposureData));
+		exposure_adapt_pipeline_->AddUniformBuffer(2, render_region_buffer_, sizeof(RenderRegion));
+		exposure_adapt_pipeline_->Init(devices_);
 	}
+}
 
-	// tonemap the blurred image with the original
-	// update tonemapping data
-	devices_->CopyDataToBuffer(tonemap_factors_buffer_memory_, &tonemap_factors_, sizeof(TonemapFactors));
+void HDR::InitGaussianBlurPipelines(uint32_t width, uint32_t height)
+{
+	// initialize the gaussian blur pipelines, horizontal then vertical
+	GaussianBlurFactors blur_factors = { glm::ivec2(1, 0) };
 
-	// submit the draw command buffer
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = &gaussian_blur_semaphore_[1];
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &tonemap_command_buffer_;
+	gaussian_blur_pipeline_[0] = new HDRPipeline();
+	gaussian_blur_pipeline_[0]->SetShader(gaussian_blur_shader_);
+	gaussian_blur_pipeline_[0]->SetOutputSize(width, height);
+	gaussian_blur_pipeline_[0]->SetPushConstants(&blur_factors, sizeof(GaussianBlurFactors));
+	gaussian_blur_pipeline_[0]->AddTexture(0, transient_images_->GetImageView(ldr_suppress_image_), VK_IMAGE_LAYOUT_GENERAL);
+	gaussian_blur_pipeline_[0]->AddStorageImage(1, transient_images_->GetImageView(blur_images_[0]));
 
-	signal_semaphores[0] = hdr_semaphore_;
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	blur_factors.direction = glm::ivec2(0, 1);
+
+	gaussian_blur_pipeline_[1] = new HDRPipeline();
+	gaussian_blur_pipeline_[1]->SetShader(gaussian_blur_shader_);
+	gaussian_blur_pipeline_[1]->SetOutputSize(width, height);
+	gaussian_blur_pipeline_[1]->SetPushConstants(&blur_factors, sizeof(GaussianBlurFactors));
+	gaussian_blur_pipeline_[1]->AddTexture(0, transient_images_->GetImageView(blur_images_[0]), VK_IMAGE_LAYOUT_GENERAL);
+	gaussian_blur_pipeline_[1]->AddStorageImage(1, transient_images_->GetImageView(blur_images_[1]));
 
-	result = vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+	// the shared memory kernel runs one workgroup per run of texels along a line, the vertical pass has its lines down the columns
+	if (shared_memory_blur_)
 	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
+		gaussian_blur_pipeline_[0]->SetWorkgroupSize(BLUR_TILE_SIZE, 1);
+		gaussian_blur_pipeline_[1]->SetWorkgroupSize(BLUR_TILE_SIZE, 1);
+		gaussian_blur_pipeline_[1]->SetOutputSize(height, width);
 	}
 
-	// wait until tonemapping is complete
-	vkQueueWaitIdle(graphics_queue);
-
-	// copy the tonemapped image to the intermediate image
-	swap_chain->CopyToIntermediateImage(tonemap_scene_->GetImages()[0], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	gaussian_blur_pipeline_[0]->Init(devices_);
+	gaussian_blur_pipeline_[1]->Init(devices_);
 }
 
-void HDR::InitPipelines(VulkanSwapChain* swap_chain)
+void HDR::InitBloomPipelines(VulkanSwapChain* swap_chain)
 {
-	VkExtent2D swap_chain_dimensions = swap_chain->GetSwapChainExtent();
-
-	// initialize the HDR render targets
-	ldr_suppress_scene_ = new VulkanRenderTarget();
-	ldr_suppress_scene_->Init(devices_, swap_chain->GetIntermediateImageFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2, 1, false);
-
-	blur_scene_ = new VulkanRenderTarget();
-	blur_scene_->Init(devices_, swap_chain->GetIntermediateImageFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2, 2, false);
+	// level zero is the ldr suppress target, the levels below it are the mips of the bloom image
+	uint32_t width = std::max(blur_extent_.width / 2, 1u);
+	uint32_t height = std::max(blur_extent_.height / 2, 1u);
+
+	std::vector<uint32_t> level_widths, level_heights;
+	level_widths.push_back(width);
+	level_heights.push_back(height);
+	while (level_widths.size() < BLOOM_MAX_LEVELS && width > 1 && height > 1)
+	{
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+		level_widths.push_back(width);
+		level_heights.push_back(height);
+	}
+	bloom_max_levels_ = static_cast<uint32_t>(level_widths.size());
+	bloom_levels_ = std::min(bloom_levels_, bloom_max_levels_);
 
-	tonemap_scene_ = new VulkanRenderTarget();
-	tonemap_scene_->Init(devices_, swap_chain->GetIntermediateImageFormat(), swap_chain_dimensions.width, swap_chain_dimensions.height, 1, false);
+	// the pyramid levels are stored in the same format as the half resolution images
+	VkFormat bloom_format = hdr_format_;
+	devices_->CreateImage(level_widths[0], level_heights[0], bloom_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bloom_image_, bloom_image_memory_, bloom_max_levels_);
+	for (uint32_t i = 0; i < bloom_max_levels_; i++)
+	{
+		bloom_level_views_.push_back(devices_->CreateImageView(bloom_image_, bloom_format, VK_IMAGE_ASPECT_COLOR_BIT, i, 1));
+	}
+	devices_->TransitionImageLayout(bloom_image_, bloom_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, bloom_max_levels_);
 
-	// initialize the ldr suppresssion pipeline
-	ldr_suppress_pipeline_ = new LDRSuppressPipeline();
-	ldr_suppress_pipeline_->SetShader(ldr_suppress_shader_);
-	ldr_suppress_pipeline_->SetOutputImage(ldr_suppress_scene_->GetImageViews()[0], ldr_suppress_scene_->GetRenderTargetFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2);
-	ldr_suppress_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 0, buffer_sampler_);
-	ldr_suppress_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 1, swap_chain->GetIntermediateImageView());
-	ldr_suppress_pipeline_->Init(devices_, swap_chain);
+	// pyramid level i, the ldr suppress target for level zero
+	auto level_view = [&](uint32_t level)
+	{
+		return (level == 0) ? transient_images_->GetImageView(ldr_suppress_image_) : bloom_level_views_[level - 1];
+	};
 
-	// initialize the gaussian blur pipelines
-	gaussian_blur_pipeline_[0] = new GaussianBlurPipeline();
-	gaussian_blur_pipeline_[0]->SetShader(gaussian_blur_shader_);
-	gaussian_blur_pipeline_[0]->SetOutputImage(blur_scene_->GetImageViews()[0], blur_scene_->GetRenderTargetFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2);
-	gaussian_blur_pipeline_[0]->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, gaussian_blur_factors_buffer_, sizeof(GaussianBlurFactors));
-	gaussian_blur_pipeline_[0]->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 1, buffer_sampler_);
-	gaussian_blur_pipeline_[0]->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 2, ldr_suppress_scene_->GetImageViews()[0]);
-	gaussian_blur_pipeline_[0]->Init(devices_, swap_chain);
+	// each downsample writes the level below from the level above it
+	for (uint32_t i = 0; i < bloom_max_levels_; i++)
+	{
+		HDRPipeline* pipeline = new HDRPipeline();
+		pipeline->SetShader(bloom_downsample_shader_);
+		pipeline->SetOutputSize(level_widths[i], level_heights[i]);
+		pipeline->AddSampler(0, bloom_sampler_);
+		pipeline->AddTexture(1, level_view(i), VK_IMAGE_LAYOUT_GENERAL);
+		pipeline->AddStorageImage(2, bloom_level_views_[i]);
+		pipeline->Init(devices_);
+		bloom_downsample_pipelines_.push_back(pipeline);
+	}
 
-	gaussian_blur_pipeline_[1] = new GaussianBlurPipeline();
-	gaussian_blur_pipeline_[1]->SetShader(gaussian_blur_shader_);
-	gaussian_blur_pipeline_[1]->SetOutputImage(blur_scene_->GetImageViews()[1], blur_scene_->GetRenderTargetFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2);
-	gaussian_blur_pipeline_[1]->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, gaussian_blur_factors_buffer_, sizeof(GaussianBlurFactors));
-	gaussian_blur_pipeline_[1]->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 1, buffer_sampler_);
-	gaussian_blur_pipeline_[1]->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 2, blur_scene_->GetImageViews()[0]);
-	gaussian_blur_pipeline_[1]->Init(devices_, swap_chain);
-	
-	// intialize the tonemap pipeline
-	tonemap_pipeline_ = new TonemapPipeline();
-	tonemap_pipeline_->SetShader(tonemap_shader_);
-	tonemap_pipeline_->SetOutputImage(tonemap_scene_->GetImageViews()[0], tonemap_scene_->GetRenderTargetFormat(), swap_chain_dimensions.width, swap_chain_dimensions.height);
-	tonemap_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, tonemap_factors_buffer_, sizeof(TonemapFactors));
-	tonemap_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 1, buffer_sampler_);
-	tonemap_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 2, swap_chain->GetIntermediateImageView());
-	tonemap_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 3, blur_scene_->GetImageViews()[1]);
-	tonemap_pipeline_->Init(devices_, swap_chain);
+	// each upsample blends the upsampled level below into its own level in place, level zero leaves the final blurred image in the suppressed image
+	for (uint32_t i = 0; i < bloom_max_levels_; i++)
+	{
+		HDRPipeline* pipeline = new HDRPipeline();
+		pipeline->SetShader(bloom_upsample_shader_);
+		pipeline->SetOutputSize((i == 0) ? blur_extent_.width : level_widths[i - 1], (i == 0) ? blur_extent_.height : level_heights[i - 1]);
+		pipeline->AddSampler(0, bloom_sampler_);
+		pipeline->AddTexture(1, bloom_level_views_[i], VK_IMAGE_LAYOUT_GENERAL);
+		pipeline->AddTexture(2, level_view(i), VK_IMAGE_LAYOUT_GENERAL);
+		pipeline->AddStorageImage(3, level_view(i));
+		pipeline->Init(devices_);
+		bloom_upsample_pipelines_.push_back(pipeline);
+	}
 }
 
 void HDR::InitShaders(VulkanSwapChain* swap_chain)
 {
-	ldr_suppress_shader_ = new VulkanShader();
-	ldr_suppress_shader_->Init(devices_, swap_chain, "../res/shaders/screen_space.vert.spv", "", "", "", "../res/shaders/ldr_suppress.frag.spv");
+	ldr_suppress_shader_ = new VulkanComputeShader();
+	ldr_suppress_shader_->Init(devices_, swap_chain, "../res/shaders/ldr_suppress.comp.spv");
 
-	gaussian_blur_shader_ = new VulkanShader();
-	gaussian_blur_shader_->Init(devices_, swap_chain, "../res/shaders/screen_space.vert.spv", "", "", "", "../res/shaders/gaussian_blur.frag.spv");
+	if (dual_filter_bloom_)
+	{
+		bloom_downsample_shader_ = new VulkanComputeShader();
+		bloom_downsample_shader_->Init(devices_, swap_chain, "../res/shaders/bloom_downsample.comp.spv");
+
+		bloom_upsample_shader_ = new VulkanComputeShader();
+		bloom_upsample_shader_->Init(devices_, swap_chain, "../res/shaders/bloom_upsample.comp.spv");
+	}
+	else
+	{
+		gaussian_blur_shader_ = new VulkanComputeShader();
+		if (shared_memory_blur_)
+			gaussian_blur_shader_->Init(devices_, swap_chain, "../res/shaders/gaussian_blur_shared.comp.spv");
+		else
+			gaussian_blur_shader_->Init(devices_, swap_chain, "../res/shaders/gaussian_blur.comp.spv");
+		gaussian_blur_shader_->SetSpecializationConstant(0, BLUR_RADIUS);
+	}
+
+	tonemap_shader_ = new VulkanComputeShader();
+	tonemap_shader_->Init(devices_, swap_chain, "../res/shaders/tonemap.comp.spv");
+	tonemap_shader_->SetSpecializationConstant(0, auto_exposure_ ? 1 : 0);
 
-	tonemap_shader_ = new VulkanShader();
-	tonemap_shader_->Init(devices_, swap_chain, "../res/shaders/screen_space.vert.spv", "", "", "", "../res/shaders/tonemap.frag.spv");
+	if (auto_exposure_)
+	{
+		luminance_histogram_shader_ = new VulkanComputeShader();
+		luminance_histogram_shader_->Init(devices_, swap_chain, "../res/shaders/luminance_histogram.comp.spv");
+
+		exposure_adapt_shader_ = new VulkanComputeShader();
+		exposure_adapt_shader_->Init(devices_, swap_chain, "../res/shaders/exposure_adapt.comp.spv");
+	}
 }
 
-void HDR::InitResources()
+void HDR::InitResources(VulkanSwapChain* swap_chain)
 {
 	// start as hdr on normal
 	hdr_mode_ = 1;
 
-	// initialize the sampler that will be used for buffers
-	// initialize the g buffer sampler
-	VkSamplerCreateInfo sampler_info = {};
-	sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	sampler_info.magFilter = VK_FILTER_NEAREST;
-	sampler_info.minFilter = VK_FILTER_NEAREST;
-	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	sampler_info.anisotropyEnable = VK_FALSE;
-	sampler_info.maxAnisotropy = 1;
-	sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-	sampler_info.unnormalizedCoordinates = VK_FALSE;
-	sampler_info.compareEnable = VK_FALSE;
-	sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
-	sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-
-	if (vkCreateSampler(devices_->GetLogicalDevice(), &sampler_info, nullptr, &buffer_sampler_) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create buffer sampler!");
-	}
-
-	// intialize the blur factors buffer
-	devices_->CreateBuffer(sizeof(GaussianBlurFactors), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, gaussian_blur_factors_buffer_, gaussian_blur_factors_buffer_memory_);
+	// the bloom pyramid is sampled between texels so each tap averages a 2x2 block
+	if (dual_filter_bloom_)
+	{
+		VkSamplerCreateInfo sampler_info = {};
+		sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		sampler_info.magFilter = VK_FILTER_LINEAR;
+		sampler_info.minFilter = VK_FILTER_LINEAR;
+		sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.anisotropyEnable = VK_FALSE;
+		sampler_info.maxAnisotropy = 1;
+		sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+		sampler_info.unnormalizedCoordinates = VK_FALSE;
+		sampler_info.compareEnable = VK_FALSE;
+		sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+		sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		sampler_info.minLod = 0.0f;
+		sampler_info.maxLod = 0.0f;
+
+		bloom_sampler_ = devices_->GetSampler(sampler_info);
+	}
 
 	// initialize the tonemap factors buffer
 	devices_->CreateBuffer(sizeof(TonemapFactors), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, tonemap_factors_buffer_, tonemap_factors_buffer_memory_);
@@ -290,16 +524,63 @@ void HDR::InitResources()
 
 	devices_->CopyDataToBuffer(tonemap_factors_buffer_memory_, &tonemap_factors_, sizeof(TonemapFactors));
 
+	// initialize the render region to the whole intermediate image, it is rewritten each frame with the frame time
+	devices_->CreateBuffer(sizeof(RenderRegion), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, render_region_buffer_, render_region_buffer_memory_);
+
+	RenderRegion render_region = {};
+	render_region.extent = glm::ivec2(swap_chain->GetSwapChainExtent().width, swap_chain->GetSwapChainExtent().height);
+	devices_->UploadDataToBuffer(render_region_buffer_, &render_region, sizeof(RenderRegion));
+
+	// initialize the histogram buffer, the exposure pass clears each bin after reading it so it only needs clearing once
+	devices_->CreateBuffer(sizeof(uint32_t) * LUMINANCE_HISTOGRAM_BINS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, histogram_buffer_, histogram_buffer_memory_);
+
+	std::vector<uint32_t> empty_histogram(LUMINANCE_HISTOGRAM_BINS, 0);
+	devices_->UploadDataToBuffer(histogram_buffer_, empty_histogram.data(), sizeof(uint32_t) * LUMINANCE_HISTOGRAM_BINS);
+
+	// initialize the exposure buffer to the fixed exposure level so the first frames match it
+	devices_->CreateBuffer(sizeof(ExposureData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, exposure_buffer_, exposure_buffer_memory_);
+
+	ExposureData exposure_data = {};
+	exposure_data.adapted_luminance = EXPOSURE_KEY / tonemap_factors_.exposure_level;
+	exposure_data.auto_exposure = tonemap_factors_.exposure_level;
+	devices_->UploadDataToBuffer(exposure_buffer_, &exposure_data, sizeof(ExposureData));
+
 	// initialize semaphores
 	VkSemaphoreCreateInfo semaphore_info = {};
 	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &ldr_suppress_semaphore_) != VK_SUCCESS ||
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &gaussian_blur_semaphore_[0]) != VK_SUCCESS ||
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &gaussian_blur_semaphore_[1]) != VK_SUCCESS || 
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &hdr_semaphore_) != VK_SUCCESS) {
+	if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &hdr_semaphore_) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create semaphores!");
 	}
+
+	// initialize the stage timing queries
+	stage_query_pool_ = VK_NULL_HANDLE;
+	for (double& total_stage_time : total_stage_times_)
+		total_stage_time = 0.0;
+	stage_timing_frame_count_ = 0;
+
+#ifdef HDR_STAGE_TIMING
+	VkPhysicalDeviceProperties device_properties;
+	vkGetPhysicalDeviceProperties(devices_->GetPhysicalDevice(), &device_properties);
+	timestamp_period_ = device_properties.limits.timestampPeriod;
+
+	if (device_properties.limits.timestampComputeAndGraphics)
+	{
+		VkQueryPoolCreateInfo query_pool_info = {};
+		query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		query_pool_info.queryCount = HDR_STAGE_TIMESTAMPS;
+
+		if (vkCreateQueryPool(devices_->GetLogicalDevice(), &query_pool_info, nullptr, &stage_query_pool_) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create hdr stage timing query pool!");
+		}
+	}
+	else
+	{
+		std::cout << "HDR stage timing needs timestamp queries, which this device does not support" << std::endl;
+	}
+#endif
 }
 
 void HDR::InitCommandBuffers(VkCommandPool command_pool)
@@ -315,68 +596,246 @@ void HDR::InitCommandBuffers(VkCommandPool command_pool)
 	allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocate_info.commandPool = command_pool;
 	allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-
-	// init ldr suppress command buffer
 	allocate_info.commandBufferCount = 1;
 
-	if (vkAllocateCommandBuffers(devices_->GetLogicalDevice(), &allocate_info, &ldr_suppress_command_buffer_) != VK_SUCCESS)
+	if (vkAllocateCommandBuffers(devices_->GetLogicalDevice(), &allocate_info, &hdr_command_buffer_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate hdr command buffers!");
+	}
+
+	vkBeginCommandBuffer(hdr_command_buffer_, &begin_info);
+
+	// each timestamp is written once the work before it has completed
+	if (stage_query_pool_ != VK_NULL_HANDLE)
 	{
-		throw std::runtime_error("failed to allocate ldr suppression command buffers!");
+		vkCmdResetQueryPool(hdr_command_buffer_, stage_query_pool_, 0, HDR_STAGE_TIMESTAMPS);
+		vkCmdWriteTimestamp(hdr_command_buffer_, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, stage_query_pool_, 0);
 	}
 
+	// the scene passes leave the intermediate image as a color attachment, the chain reads and writes it as a storage image
+	VkImageMemoryBarrier intermediate_barrier = {};
+	intermediate_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	intermediate_barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	intermediate_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	intermediate_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	intermediate_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	intermediate_barrier.image = intermediate_image_;
+	intermediate_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	intermediate_barrier.subresourceRange.baseMipLevel = 0;
+	intermediate_barrier.subresourceRange.levelCount = 1;
+	intermediate_barrier.subresourceRange.baseArrayLayer = 0;
+	intermediate_barrier.subresourceRange.layerCount = 1;
+	intermediate_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	intermediate_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(hdr_command_buffer_, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &intermediate_barrier);
+
+	// suppress low dynamic range pixels into the half resolution image
+	transient_images_->RecordAcquireBarriers(hdr_command_buffer_, HDR_PASS_LDR_SUPPRESS, VK_IMAGE_LAYOUT_GENERAL);
+	ldr_suppress_pipeline_->RecordCommands(hdr_command_buffer_);
+
+	// histogram the scene before it is tonemapped in place, it runs alongside the suppress pass
+	if (auto_exposure_)
+		luminance_histogram_pipeline_->RecordCommands(hdr_command_buffer_);
+
+	RecordStageBarrier(hdr_command_buffer_);
+
+	// adapt the exposure towards the histogram's average, the blur does not depend on it so no barrier is needed before it
+	if (auto_exposure_)
+		exposure_adapt_pipeline_->RecordCommands(hdr_command_buffer_);
 
-	vkBeginCommandBuffer(ldr_suppress_command_buffer_, &begin_info);
+	if (stage_query_pool_ != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(hdr_command_buffer_, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, stage_query_pool_, 1);
 
-	ldr_suppress_pipeline_->RecordCommands(ldr_suppress_command_buffer_, 0);
+	// blur the suppressed image, either down and back up the bloom pyramid or with a horizontal then vertical gaussian
 
-	vkCmdEndRenderPass(ldr_suppress_command_buffer_);
+	transient_images_->RecordAcquireBarriers(hdr_command_buffer_, HDR_PASS_BLUR_FIRST, VK_IMAGE_LAYOUT_GENERAL);
 
-	if (vkEndCommandBuffer(ldr_suppress_command_buffer_) != VK_SUCCESS)
+	if (dual_filter_bloom_)
 	{
-		throw std::runtime_error("failed to record ldr suppression command buffer!");
+		for (uint32_t i = 0; i < bloom_levels_; i++)
+		{
+			bloom_downsample_pipelines_[i]->RecordCommands(hdr_command_buffer_);
+			RecordStageBarrier(hdr_command_buffer_);
+		}
+	}
+	else
+	{
+		gaussian_blur_pipeline_[0]->RecordCommands(hdr_command_buffer_);
+		RecordStageBarrier(hdr_command_buffer_);
 	}
 
-	// init gaussian blur command buffers
-	allocate_info.commandBufferCount = 2;
+	if (stage_query_pool_ != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(hdr_command_buffer_, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, stage_query_pool_, 2);
 
-	if (vkAllocateCommandBuffers(devices_->GetLogicalDevice(), &allocate_info, gaussian_blur_command_buffers_) != VK_SUCCESS)
+	transient_images_->RecordAcquireBarriers(hdr_command_buffer_, HDR_PASS_BLUR_SECOND, VK_IMAGE_LAYOUT_GENERAL);
+
+	if (dual_filter_bloom_)
 	{
-		throw std::runtime_error("failed to allocate gaussian blur command buffers!");
+		for (uint32_t i = bloom_levels_; i > 0; i--)
+		{
+			bloom_upsample_pipelines_[i - 1]->RecordCommands(hdr_command_buffer_);
+			RecordStageBarrier(hdr_command_buffer_);
+		}
 	}
+	else
+	{
+		gaussian_blur_pipeline_[1]->RecordCommands(hdr_command_buffer_);
+		RecordStageBarrier(hdr_command_buffer_);
+	}
+
+	if (stage_query_pool_ != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(hdr_command_buffer_, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, stage_query_pool_, 3);
+
+	// tonemap the blurred image with the original
+	transient_images_->RecordAcquireBarriers(hdr_command_buffer_, HDR_PASS_TONEMAP, VK_IMAGE_LAYOUT_GENERAL);
+	tonemap_pipeline_->RecordCommands(hdr_command_buffer_);
+
+	if (stage_query_pool_ != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(hdr_command_buffer_, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, stage_query_pool_, 4);
 
-	for (int i = 0; i < 2; i++)
+	// return the intermediate image to the layout the swap chain expects it in
+	intermediate_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	intermediate_barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	intermediate_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	intermediate_barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+	vkCmdPipelineBarrier(hdr_command_buffer_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &intermediate_barrier);
+
+	if (vkEndCommandBuffer(hdr_command_buffer_) != VK_SUCCESS)
 	{
-		vkBeginCommandBuffer(gaussian_blur_command_buffers_[i], &begin_info);
+		throw std::runtime_error("failed to record hdr command buffer!");
+	}
+}
+
+void HDR::RecordStageBarrier(VkCommandBuffer command_buffer)
+{
+	// each stage reads the image the previous stage wrote
+	VkMemoryBarrier stage_barrier = {};
+	stage_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	stage_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	stage_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-		gaussian_blur_pipeline_[i]->RecordCommands(gaussian_blur_command_buffers_[i], 0);
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &stage_barrier, 0, nullptr, 0, nullptr);
+}
+
+VkFormat HDR::ChooseHDRFormat(VkFormat fallback_format)
+{
+	if (!packed_hdr_formats_)
+		return fallback_format;
 
-		vkCmdEndRenderPass(gaussian_blur_command_buffers_[i]);
+	// the chain writes the images as storage images and reads them back as textures, the bloom pyramid also filters them
+	// E5B9G9R9 would keep more precision but is never a storage format, so it cannot be written by the chain
+	std::vector<VkFormat> candidates = { VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_FORMAT_R16G16B16A16_SFLOAT };
+	VkFormatFeatureFlags features = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
 
-		if (vkEndCommandBuffer(gaussian_blur_command_buffers_[i]) != VK_SUCCESS)
+	for (VkFormat format : candidates)
+	{
+		VkFormatProperties format_properties;
+		vkGetPhysicalDeviceFormatProperties(devices_->GetPhysicalDevice(), format, &format_properties);
+
+		if ((format_properties.optimalTilingFeatures & features) == features)
+			return format;
+	}
+
+	std::cout << "Packed HDR formats need storage image support for B10G11R11 or RGBA16 floats, which this device does not support" << std::endl;
+	return fallback_format;
+}
+
+VkDeviceSize HDR::GetTexelSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+		return 4;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+		return 8;
+	default:
+		return 16;
+	}
+}
+
+void HDR::ReportStageTimings()
+{
+	// not ready until the chain has been submitted once
+	uint64_t timestamps[HDR_STAGE_TIMESTAMPS];
+	if (vkGetQueryPoolResults(devices_->GetLogicalDevice(), stage_query_pool_, 0, HDR_STAGE_TIMESTAMPS, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	// timestamps are in ticks of the timestamp period in nanoseconds
+	for (uint32_t i = 0; i < HDR_STAGE_TIMESTAMPS - 1; i++)
+		total_stage_times_[i] += (timestamps[i + 1] - timestamps[i]) * timestamp_period_ / 1000000.0;
+	stage_timing_frame_count_++;
+
+	if (stage_timing_frame_count_ < STAGE_TIMING_REPORT_INTERVAL)
+		return;
+
+	// estimate the bytes each stage moves from the texels it reads and writes, ignoring cache hits and the small buffers
+	VkDeviceSize full_texels = (VkDeviceSize)blur_extent_.width * blur_extent_.height * 4;
+	VkDeviceSize half_texels = (VkDeviceSize)blur_extent_.width * blur_extent_.height;
+	VkDeviceSize full_size = GetTexelSize(VK_FORMAT_R32G32B32A32_SFLOAT);
+	VkDeviceSize half_size = GetTexelSize(hdr_format_);
+
+	VkDeviceSize stage_bytes[HDR_STAGE_TIMESTAMPS - 1];
+	stage_bytes[0] = half_texels * full_size + half_texels * half_size + (auto_exposure_ ? full_texels * full_size : 0);
+	stage_bytes[3] = full_texels * full_size * 2 + half_texels * half_size;
+
+	if (dual_filter_bloom_)
+	{
+		// each downsample reads the level above and writes its own, each upsample reads both and writes the level above
+		VkDeviceSize level_texels = half_texels;
+		stage_bytes[1] = 0;
+		stage_bytes[2] = 0;
+		for (uint32_t i = 0; i < bloom_levels_; i++)
 		{
-			throw std::runtime_error("failed to record gaussian blur command buffer!");
+			stage_bytes[1] += level_texels * half_size + level_texels / 4 * half_size;
+			stage_bytes[2] += level_texels / 4 * half_size + level_texels * half_size * 2;
+			level_texels /= 4;
 		}
 	}
+	else
+	{
+		stage_bytes[1] = half_texels * half_size * 2;
+		stage_bytes[2] = half_texels * half_size * 2;
+	}
 
-	// init tonemap command buffer
-	allocate_info.commandBufferCount = 1;
+	const char* stage_names[HDR_STAGE_TIMESTAMPS - 1] = { "suppress", dual_filter_bloom_ ? "downsample" : "horizontal blur", dual_filter_bloom_ ? "upsample" : "vertical blur", "tonemap" };
 
-	if (vkAllocateCommandBuffers(devices_->GetLogicalDevice(), &allocate_info, &tonemap_command_buffer_) != VK_SUCCESS)
+	std::cout << "HDR stages at " << blur_extent_.width << "x" << blur_extent_.height << " with " << half_size << " byte half resolution texels:" << std::endl;
+	for (uint32_t i = 0; i < HDR_STAGE_TIMESTAMPS - 1; i++)
 	{
-		throw std::runtime_error("failed to allocate tonemap command buffers!");
+		double stage_time = total_stage_times_[i] / stage_timing_frame_count_;
+		double stage_megabytes = stage_bytes[i] / (1024.0 * 1024.0);
+
+		std::cout << "  " << stage_names[i] << " " << stage_time << " ms, " << stage_megabytes << " MB, " << stage_megabytes / 1024.0 / std::max(stage_time / 1000.0, 0.000001) << " GB/s" << std::endl;
+		total_stage_times_[i] = 0.0;
 	}
 
+	stage_timing_frame_count_ = 0;
+}
 
-	vkBeginCommandBuffer(tonemap_command_buffer_, &begin_info);
+void HDR::SetBloomLevels(uint32_t levels)
+{
+	if (!dual_filter_bloom_)
+		return;
 
-	tonemap_pipeline_->RecordCommands(tonemap_command_buffer_, 0);
+	levels = std::max(1u, std::min(levels, bloom_max_levels_));
+	if (levels == bloom_levels_)
+		return;
 
-	vkCmdEndRenderPass(tonemap_command_buffer_);
+	bloom_levels_ = levels;
 
-	if (vkEndCommandBuffer(tonemap_command_buffer_) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to record tonemap command buffer!");
-	}
+	// the chain is recorded once, so re-record it once the gpu has finished with it
+	vkDeviceWaitIdle(devices_->GetLogicalDevice());
+	vkFreeCommandBuffers(devices_->GetLogicalDevice(), command_pool_, 1, &hdr_command_buffer_);
+	InitCommandBuffers(command_pool_);
+
+	std::cout << "Bloom levels: " << bloom_levels_ << std::endl;
+}
+
+void HDR::CycleBloomLevels()
+{
+	SetBloomLevels(bloom_levels_ % bloom_max_levels_ + 1);
 }
 
 void HDR::CycleHDRMode()
@@ -395,4 +854,7 @@ void HDR::CycleHDRMode()
 	{
 		hdr_mode_ = 0;
 	}
+
+	// only written when the mode changes rather than every frame
+	devices_->CopyDataToBuffer(tonemap_factors_buffer_memory_, &tonemap_factors_, sizeof(TonemapFactors));
 }
\ No newline at end of file
@@ -3,19 +3,40 @@
 
 #include <glm\glm.hpp>
 
-#include "pipelines/ldr_suppress_pipeline.h"
-#include "pipelines/gaussian_blur_pipeline.h"
-#include "pipelines/tonemap_pipeline.h"
-#include "render_target.h"
+#include "compute_shader.h"
+#include "pipelines/hdr_pipeline.h"
+#include "transient_image_pool.h"
 
 class HDR
 {
 public:
+	// pushed with each blur dispatch, must match BlurFactors in gaussian_blur.comp and gaussian_blur_shared.comp
 	struct GaussianBlurFactors
 	{
-		float radius;
-		glm::vec2 direction;
-		float padding;
+		glm::ivec2 direction;
+	};
+
+	// pushed with the histogram and exposure passes, must match ExposureFactors in luminance_histogram.comp and exposure_adapt.comp
+	struct ExposureFactors
+	{
+		float min_log_luminance;
+		float log_luminance_range;
+		float adaptation_rate;
+		float exposure_key;
+	};
+
+	// written by the exposure pass and read by the tonemap, must match ExposureData in exposure_adapt.comp and tonemap.comp
+	struct ExposureData
+	{
+		float adapted_luminance;
+		float auto_exposure;
+	};
+
+	// the part of the intermediate image the scene was drawn into and the time since the last frame, must match RenderRegion in every pass of the chain that reads it
+	struct RenderRegion
+	{
+		glm::ivec2 extent;
+		float frame_time;
 	};
 
 	struct TonemapFactors
@@ -29,33 +50,87 @@ public:
 public:
 	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VkCommandPool command_pool);
 	void Cleanup();
-	void Render(VulkanSwapChain* swap_chain, VkSemaphore* wait_semaphore);
+
+	// submits the whole chain as one command buffer, the tonemapped result is written back into the intermediate image
+	void Render(VkSemaphore* wait_semaphore);
+
+	// records the write of the frame's render extent and frame time into a buffer so the recorded chain does not need re-recording when they change
+	void RecordRenderRegionUpdate(VkCommandBuffer command_buffer, VkExtent2D render_extent, float frame_time);
+	void UpdateRenderRegion(VkExtent2D render_extent, float frame_time);
 
 	inline VkSemaphore GetHDRSemaphore() { return hdr_semaphore_; }
-	inline VulkanRenderTarget* DebugBuffer() { return ldr_suppress_scene_; }
+	inline VkImageView DebugImageView() { return transient_images_->GetImageView(ldr_suppress_image_); }
 
 	void CycleHDRMode();
 	inline int GetHDRMode() { return hdr_mode_; }
 
+	// number of bloom pyramid levels below the half resolution image, fewer levels trade glow width for time
+	void SetBloomLevels(uint32_t levels);
+	void CycleBloomLevels();
+	inline uint32_t GetBloomLevels() { return bloom_levels_; }
+
 protected:
 	void InitPipelines(VulkanSwapChain* swap_chain);
+	void InitGaussianBlurPipelines(uint32_t width, uint32_t height);
+	void InitBloomPipelines(VulkanSwapChain* swap_chain);
 	void InitShaders(VulkanSwapChain* swap_chain);
-	void InitResources();
+	void InitResources(VulkanSwapChain* swap_chain);
 	void InitCommandBuffers(VkCommandPool command_pool);
 
+	// picks the format of the half resolution images, the fallback if the packed formats are off or not supported
+	VkFormat ChooseHDRFormat(VkFormat fallback_format);
+	VkDeviceSize GetTexelSize(VkFormat format);
+
+	void RecordStageBarrier(VkCommandBuffer command_buffer);
+	void ReportStageTimings();
+
 protected:
 	VulkanDevices* devices_;
+	VkImage intermediate_image_;
+	VkCommandPool command_pool_;
 	
-	VkSampler buffer_sampler_;
-	VulkanShader *ldr_suppress_shader_, *gaussian_blur_shader_, *tonemap_shader_;
-	LDRSuppressPipeline* ldr_suppress_pipeline_;
-	GaussianBlurPipeline* gaussian_blur_pipeline_[2];
-	TonemapPipeline* tonemap_pipeline_;
-	VulkanRenderTarget *ldr_suppress_scene_, *blur_scene_, *tonemap_scene_;
-	VkBuffer gaussian_blur_factors_buffer_, tonemap_factors_buffer_;
-	VkDeviceMemory gaussian_blur_factors_buffer_memory_, tonemap_factors_buffer_memory_;
-	VkCommandBuffer ldr_suppress_command_buffer_, gaussian_blur_command_buffers_[2], tonemap_command_buffer_;
-	VkSemaphore ldr_suppress_semaphore_, gaussian_blur_semaphore_[2], hdr_semaphore_;
+	VulkanComputeShader *ldr_suppress_shader_, *gaussian_blur_shader_, *tonemap_shader_;
+	HDRPipeline* ldr_suppress_pipeline_;
+	HDRPipeline* gaussian_blur_pipeline_[2];
+	HDRPipeline* tonemap_pipeline_;
+
+	// half resolution images of the chain, those whose passes never overlap share memory
+	TransientImagePool* transient_images_;
+	bool packed_hdr_formats_;
+	VkFormat hdr_format_;
+	uint32_t ldr_suppress_image_;
+	std::vector<uint32_t> blur_images_;
+	VkBuffer tonemap_factors_buffer_;
+	VkDeviceMemory tonemap_factors_buffer_memory_;
+	VkBuffer render_region_buffer_;
+	VkDeviceMemory render_region_buffer_memory_;
+	VkCommandBuffer hdr_command_buffer_;
+	VkSemaphore hdr_semaphore_;
+
+	// luminance histogram and the exposure adapted from it, neither is read back by the cpu
+	bool auto_exposure_;
+	VulkanComputeShader *luminance_histogram_shader_, *exposure_adapt_shader_;
+	HDRPipeline *luminance_histogram_pipeline_, *exposure_adapt_pipeline_;
+	VkBuffer histogram_buffer_, exposure_buffer_;
+	VkDeviceMemory histogram_buffer_memory_, exposure_buffer_memory_;
+
+	// dual filter bloom pyramid, used in place of the gaussian blur
+	bool dual_filter_bloom_;
+	uint32_t bloom_levels_, bloom_max_levels_;
+	VkImage bloom_image_;
+	VkDeviceMemory bloom_image_memory_;
+	std::vector<VkImageView> bloom_level_views_;
+	VkSampler bloom_sampler_;
+	VulkanComputeShader *bloom_downsample_shader_, *bloom_upsample_shader_;
+	std::vector<HDRPipeline*> bloom_downsample_pipelines_, bloom_upsample_pipelines_;
+
+	// timestamps between the stages of the chain
+	bool shared_memory_blur_;
+	VkQueryPool stage_query_pool_;
+	float timestamp_period_;
+	double total_stage_times_[4];
+	uint32_t stage_timing_frame_count_;
+	VkExtent2D blur_extent_;
 
 	int hdr_mode_;
 	TonemapFactors tonemap_factors_;
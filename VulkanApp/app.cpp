@@ -196,6 +196,13 @@ void App::Update()
 		camera_.SetSpeed(current_speed);
 		input_->SetKeyUp(GLFW_KEY_E);
 	}
+
+	// bloom quality, cycles through the pyramid level counts
+	if (input_->IsKeyPressed(GLFW_KEY_B))
+	{
+		renderer_->GetHDR()->CycleBloomLevels();
+		input_->SetKeyUp(GLFW_KEY_B);
+	}
 }
 
 void App::DrawFrame()
@@ -215,7 +222,7 @@ void App::DrawFrame()
 	}
 
 	// draw the scene using the renderer
-	renderer_->RenderScene();
+	renderer_->RenderScene(frame_time_);
 	
 	// present the swap chain image to the window
 	result = swap_chain_->PostRender(renderer_->GetRenderSemaphore());
@@ -387,10 +394,20 @@ void App::InitDevices()
 	device_features.geometryShader = VK_TRUE;
 	device_features.tessellationShader = VK_TRUE;
 	device_features.shaderStorageImageExtendedFormats = VK_TRUE;
+	device_features.shaderStorageImageWriteWithoutFormat = VK_TRUE;
 
 	// create the physical device
 	devices_ = new VulkanDevices(vk_instance_, swap_chain_->GetSurface(), device_features, device_extensions_);
 
+	// enable optional features when the chosen device supports them
+	VkPhysicalDeviceFeatures supported_features;
+	vkGetPhysicalDeviceFeatures(devices_->GetPhysicalDevice(), &supported_features);
+	device_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+	device_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+	device_features.pipelineStatisticsQuery = supported_features.pipelineStatisticsQuery;
+	device_features.inheritedQueries = supported_features.inheritedQueries;
+	device_features.textureCompressionBC = supported_features.textureCompressionBC;
+
 	// setup requirements for logical device
 	QueueFamilyIndices indices = devices_->GetQueueFamilyIndices();
 	std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
@@ -93,4 +93,38 @@ glm::mat4 Camera::GetProjectionMatrix()
 	proj_matrix = clip * glm::infinitePerspective(fov_, view_width_ / view_height_, 0.1f);
 	
 	return proj_matrix;
+}
+
+void Camera::GetFrustumPlanes(glm::vec4 planes[6])
+{
+	ExtractFrustumPlanes(GetProjectionMatrix() * GetViewMatrix(), planes);
+}
+
+void Camera::ExtractFrustumPlanes(const glm::mat4& view_projection, glm::vec4 planes[6])
+{
+	// rows of the view projection matrix, glm stores matrices column major
+	glm::vec4 row_x = glm::vec4(view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]);
+	glm::vec4 row_y = glm::vec4(view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]);
+	glm::vec4 row_z = glm::vec4(view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]);
+	glm::vec4 row_w = glm::vec4(view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]);
+
+	// left, right, bottom, top, near and far, depth is in the 0 to 1 range after the clip correction
+	planes[0] = row_w + row_x;
+	planes[1] = row_w - row_x;
+	planes[2] = row_w + row_y;
+	planes[3] = row_w - row_y;
+	planes[4] = row_z;
+	planes[5] = row_w - row_z;
+
+	// normalize so plane distances are in world units
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(planes[i]));
+
+		// the infinite projection has no far plane, replace it with one that contains everything
+		if (length < 1e-6f)
+			planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		else
+			planes[i] /= length;
+	}
 }
\ No newline at end of file
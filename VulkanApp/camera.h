@@ -35,6 +35,9 @@ public:
 	glm::mat4 GetViewMatrixVerticalOnly();
 	glm::mat4 GetProjectionMatrix();
 
+	void GetFrustumPlanes(glm::vec4 planes[6]);
+	static void ExtractFrustumPlanes(const glm::mat4& view_projection, glm::vec4 planes[6]);
+
 	inline void SetViewDimensions(float width, float height) { view_width_ = width; view_height_ = height; }
 	inline void GetViewDimensions(float& width, float& height) { width = view_width_; height = view_height_; }
 
@@ -0,0 +1,167 @@
+#include "command_recorder.h"
+
+void CommandRecorder::Init(VulkanDevices* devices)
+{
+	devices_ = devices;
+	frame_index_ = 0;
+
+	uint32_t pool_count = devices_->GetJobSystem()->GetWorkerCount() + 1;
+
+	for (FrameResources& frame : frames_)
+	{
+		frame.worker_pools.resize(pool_count);
+		for (WorkerPool& worker_pool : frame.worker_pools)
+		{
+			worker_pool.command_pool = CreateCommandPool();
+			worker_pool.used_count = 0;
+		}
+
+		frame.primary_command_pool = CreateCommandPool();
+		devices_->CreateCommandBuffers(frame.primary_command_pool, &frame.primary_command_buffer);
+
+		// start signalled so the first use of each slot does not wait
+		VkFenceCreateInfo fence_info = {};
+		fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		if (vkCreateFence(devices_->GetLogicalDevice(), &fence_info, nullptr, &frame.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create fence!");
+		}
+	}
+}
+
+void CommandRecorder::Cleanup()
+{
+	for (FrameResources& frame : frames_)
+	{
+		vkWaitForFences(devices_->GetLogicalDevice(), 1, &frame.fence, VK_TRUE, UINT64_MAX);
+		vkDestroyFence(devices_->GetLogicalDevice(), frame.fence, nullptr);
+
+		// destroying the pools frees their command buffers
+		for (WorkerPool& worker_pool : frame.worker_pools)
+		{
+			vkDestroyCommandPool(devices_->GetLogicalDevice(), worker_pool.command_pool, nullptr);
+		}
+		frame.worker_pools.clear();
+
+		vkDestroyCommandPool(devices_->GetLogicalDevice(), frame.primary_command_pool, nullptr);
+	}
+}
+
+VkCommandBuffer CommandRecorder::BeginFrame()
+{
+	frame_index_ = (frame_index_ + 1) % FRAME_RESOURCE_COUNT;
+	FrameResources& frame = frames_[frame_index_];
+
+	// the slot's command buffers can only be reset once the gpu has finished with them
+	vkWaitForFences(devices_->GetLogicalDevice(), 1, &frame.fence, VK_TRUE, UINT64_MAX);
+	vkResetFences(devices_->GetLogicalDevice(), 1, &frame.fence);
+
+	// resetting whole pools is cheaper than resetting each buffer, the buffers are kept for reuse
+	for (WorkerPool& worker_pool : frame.worker_pools)
+	{
+		vkResetCommandPool(devices_->GetLogicalDevice(), worker_pool.command_pool, 0);
+		worker_pool.used_count = 0;
+	}
+	vkResetCommandPool(devices_->GetLogicalDevice(), frame.primary_command_pool, 0);
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	begin_info.pInheritanceInfo = nullptr;
+
+	vkBeginCommandBuffer(frame.primary_command_buffer, &begin_info);
+
+	return frame.primary_command_buffer;
+}
+
+void CommandRecorder::SubmitFrame(VkQueue queue, VkSemaphore signal_semaphore)
+{
+	FrameResources& frame = frames_[frame_index_];
+
+	if (vkEndCommandBuffer(frame.primary_command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record frame command buffer!");
+	}
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.waitSemaphoreCount = 0;
+	submit_info.pWaitSemaphores = nullptr;
+	submit_info.pWaitDstStageMask = nullptr;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &frame.primary_command_buffer;
+	submit_info.signalSemaphoreCount = 1;
+	submit_info.pSignalSemaphores = &signal_semaphore;
+
+	if (vkQueueSubmit(queue, 1, &submit_info, frame.fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit frame command buffer!");
+	}
+}
+
+VkCommandBuffer CommandRecorder::BeginSecondary(uint32_t worker_index, VkRenderPass render_pass, VkFramebuffer framebuffer, VkQueryPipelineStatisticFlags pipeline_statistics)
+{
+	// only the owning worker touches its pool, so no locking is needed
+	WorkerPool& worker_pool = frames_[frame_index_].worker_pools[worker_index];
+
+	if (worker_pool.used_count == worker_pool.command_buffers.size())
+	{
+		VkCommandBufferAllocateInfo allocate_info = {};
+		allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocate_info.commandPool = worker_pool.command_pool;
+		allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocate_info.commandBufferCount = 1;
+
+		VkCommandBuffer command_buffer;
+		if (vkAllocateCommandBuffers(devices_->GetLogicalDevice(), &allocate_info, &command_buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate secondary command buffer!");
+		}
+		worker_pool.command_buffers.push_back(command_buffer);
+	}
+
+	VkCommandBuffer command_buffer = worker_pool.command_buffers[worker_pool.used_count++];
+
+	VkCommandBufferInheritanceInfo inheritance_info = {};
+	inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance_info.renderPass = render_pass;
+	inheritance_info.subpass = 0;
+	inheritance_info.framebuffer = framebuffer;
+	inheritance_info.occlusionQueryEnable = VK_FALSE;
+	inheritance_info.pipelineStatistics = pipeline_statistics;
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	begin_info.pInheritanceInfo = &inheritance_info;
+
+	vkBeginCommandBuffer(command_buffer, &begin_info);
+
+	return command_buffer;
+}
+
+void CommandRecorder::EndSecondary(VkCommandBuffer command_buffer)
+{
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record secondary command buffer!");
+	}
+}
+
+VkCommandPool CommandRecorder::CreateCommandPool()
+{
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = devices_->GetQueueFamilyIndices().graphics_family;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VkCommandPool command_pool;
+	if (vkCreateCommandPool(devices_->GetLogicalDevice(), &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create command pool!");
+	}
+
+	return command_pool;
+}
@@ -0,0 +1,51 @@
+#ifndef _COMMAND_RECORDER_H_
+#define _COMMAND_RECORDER_H_
+
+#include "device.h"
+
+// number of frames that can have command buffers in flight at once
+#define FRAME_RESOURCE_COUNT 2
+
+// per frame command recording, secondary command buffers are recorded from job system workers into their own pools
+class CommandRecorder
+{
+public:
+	void Init(VulkanDevices* devices);
+	void Cleanup();
+
+	// waits for the frame slot's previous submission, resets its pools and begins its primary command buffer
+	VkCommandBuffer BeginFrame();
+	void SubmitFrame(VkQueue queue, VkSemaphore signal_semaphore);
+
+	// begins a secondary command buffer from the given worker's pool that continues the given render pass
+	// pipeline statistics must list the statistics of any query active in the primary buffer when it is executed
+	VkCommandBuffer BeginSecondary(uint32_t worker_index, VkRenderPass render_pass, VkFramebuffer framebuffer, VkQueryPipelineStatisticFlags pipeline_statistics = 0);
+	void EndSecondary(VkCommandBuffer command_buffer);
+
+protected:
+	struct WorkerPool
+	{
+		VkCommandPool command_pool;
+		std::vector<VkCommandBuffer> command_buffers;
+		uint32_t used_count;
+	};
+
+	struct FrameResources
+	{
+		// one pool per job system worker plus one for threads outside the pool
+		std::vector<WorkerPool> worker_pools;
+		VkCommandPool primary_command_pool;
+		VkCommandBuffer primary_command_buffer;
+		VkFence fence;
+	};
+
+	VkCommandPool CreateCommandPool();
+
+protected:
+	VulkanDevices* devices_;
+
+	FrameResources frames_[FRAME_RESOURCE_COUNT];
+	uint32_t frame_index_;
+};
+
+#endif
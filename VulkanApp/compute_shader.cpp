@@ -34,6 +34,25 @@ void VulkanComputeShader::LoadShader(std::string cs_filename)
 	}
 }
 
+void VulkanComputeShader::SetSpecializationConstant(uint32_t constant_id, int32_t value)
+{
+	VkSpecializationMapEntry map_entry = {};
+	map_entry.constantID = constant_id;
+	map_entry.offset = static_cast<uint32_t>(specialization_data_.size() * sizeof(int32_t));
+	map_entry.size = sizeof(int32_t);
+
+	specialization_entries_.push_back(map_entry);
+	specialization_data_.push_back(value);
+
+	// the vectors may have reallocated so the info is rebuilt each time
+	specialization_info_.mapEntryCount = static_cast<uint32_t>(specialization_entries_.size());
+	specialization_info_.pMapEntries = specialization_entries_.data();
+	specialization_info_.dataSize = specialization_data_.size() * sizeof(int32_t);
+	specialization_info_.pData = specialization_data_.data();
+
+	shader_stage_info_.pSpecializationInfo = &specialization_info_;
+}
+
 VkShaderModule VulkanComputeShader::CreateShaderModule(const std::vector<char>& code)
 {
 	VkShaderModuleCreateInfo create_info = {};
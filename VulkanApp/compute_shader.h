@@ -14,6 +14,9 @@ public:
 	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, std::string cs_filename);
 	virtual void Cleanup();
 
+	// must be set after Init and before any pipeline using the shader is created
+	void SetSpecializationConstant(uint32_t constant_id, int32_t value);
+
 	// getters
 	inline VkShaderModule GetComputeShader() { return compute_shader_module_; }
 	inline VkPipelineShaderStageCreateInfo GetShaderStageInfo() { return shader_stage_info_; }
@@ -31,6 +34,11 @@ protected:
 	// pipeline creation data
 	VkPipelineShaderStageCreateInfo shader_stage_info_;
 	VkShaderModule compute_shader_module_;
+
+	// specialization constants, each value is a 32 bit int
+	VkSpecializationInfo specialization_info_;
+	std::vector<VkSpecializationMapEntry> specialization_entries_;
+	std::vector<int32_t> specialization_data_;
 };
 
 #endif
\ No newline at end of file
@@ -1,11 +1,14 @@
 #include "device.h"
 #include "app.h"
 #include <iostream>
+#include <cstring>
 
 VulkanDevices::VulkanDevices(VkInstance instance, VkSurfaceKHR surface, VkPhysicalDeviceFeatures required_features, std::vector<const char*> required_extensions)
 {
 	physical_device_ = VK_NULL_HANDLE;
 	logical_device_ = VK_NULL_HANDLE;
+	job_system_ = nullptr;
+	uploaded_bytes_ = 0;
 
 	// initialize physical device
 	PickPhysicalDevice(instance, surface, required_features, required_extensions);
@@ -13,6 +16,20 @@ VulkanDevices::VulkanDevices(VkInstance instance, VkSurfaceKHR surface, VkPhysic
 
 VulkanDevices::~VulkanDevices()
 {
+	// stop the workers before their transfer contexts are released
+	if (job_system_)
+	{
+		job_system_->Shutdown();
+		delete job_system_;
+		job_system_ = nullptr;
+	}
+
+	DestroyTransferContexts();
+
+	for (auto& sampler : samplers_)
+		vkDestroySampler(logical_device_, sampler.second, nullptr);
+	samplers_.clear();
+
 	vkDestroyCommandPool(logical_device_, transient_command_pool_, nullptr);
 	vkDestroyDevice(logical_device_, nullptr);
 }
@@ -87,9 +104,18 @@ void VulkanDevices::CreateLogicalDevice(VkPhysicalDeviceFeatures required_featur
 		throw std::runtime_error("failed to create logical device!");
 	}
 
+	// store the enabled features so optional paths can check for them
+	enabled_features_ = required_features;
+
 	CreateCopyCommandPool();
 
 	vkGetDeviceQueue(logical_device_, queue_family_indices_.graphics_family, 0, &copy_queue_);
+
+	// start the job system and give each of its threads somewhere to record uploads
+	job_system_ = new JobSystem();
+	job_system_->Init();
+
+	CreateTransferContexts();
 }
 
 void VulkanDevices::CreateCopyCommandPool()
@@ -105,18 +131,166 @@ void VulkanDevices::CreateCopyCommandPool()
 	}
 }
 
-VkImageView VulkanDevices::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags)
+void VulkanDevices::CreateTransferContexts()
+{
+	// one context per worker plus one shared by threads outside the job system
+	transfer_contexts_.resize(job_system_->GetWorkerCount() + 1);
+
+	for (TransferContext& context : transfer_contexts_)
+	{
+		VkCommandPoolCreateInfo pool_info = {};
+		pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_info.queueFamilyIndex = queue_family_indices_.graphics_family;
+		pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		if (vkCreateCommandPool(logical_device_, &pool_info, nullptr, &context.command_pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create command pool!");
+		}
+
+		CreateCommandBuffers(context.command_pool, &context.command_buffer);
+
+		VkFenceCreateInfo fence_info = {};
+		fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(logical_device_, &fence_info, nullptr, &context.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create fence!");
+		}
+
+		// staging memory is allocated on first use
+		context.staging_buffer = VK_NULL_HANDLE;
+		context.staging_buffer_memory = VK_NULL_HANDLE;
+		context.staging_buffer_size = 0;
+		context.staging_data = nullptr;
+	}
+}
+
+void VulkanDevices::DestroyTransferContexts()
+{
+	for (TransferContext& context : transfer_contexts_)
+	{
+		if (context.staging_buffer != VK_NULL_HANDLE)
+		{
+			vkUnmapMemory(logical_device_, context.staging_buffer_memory);
+			vkDestroyBuffer(logical_device_, context.staging_buffer, nullptr);
+			vkFreeMemory(logical_device_, context.staging_buffer_memory, nullptr);
+		}
+
+		vkDestroyFence(logical_device_, context.fence, nullptr);
+		vkDestroyCommandPool(logical_device_, context.command_pool, nullptr);
+	}
+	transfer_contexts_.clear();
+}
+
+TransferContext* VulkanDevices::GetTransferContext()
+{
+	return &transfer_contexts_[job_system_->GetCurrentWorkerIndex()];
+}
+
+void* VulkanDevices::ReserveStagingMemory(TransferContext* context, VkDeviceSize size)
+{
+	if (size <= context->staging_buffer_size)
+		return context->staging_data;
+
+	// transfers wait on their fence so the old staging buffer is no longer in use
+	if (context->staging_buffer != VK_NULL_HANDLE)
+	{
+		vkUnmapMemory(logical_device_, context->staging_buffer_memory);
+		vkDestroyBuffer(logical_device_, context->staging_buffer, nullptr);
+		vkFreeMemory(logical_device_, context->staging_buffer_memory, nullptr);
+	}
+
+	// grow to the next power of two to avoid reallocating for every slightly larger upload
+	VkDeviceSize staging_size = 1024 * 1024;
+	while (staging_size < size)
+		staging_size *= 2;
+
+	CreateBuffer(staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, context->staging_buffer, context->staging_buffer_memory);
+	vkMapMemory(logical_device_, context->staging_buffer_memory, 0, staging_size, 0, &context->staging_data);
+	context->staging_buffer_size = staging_size;
+
+	return context->staging_data;
+}
+
+VkCommandBuffer VulkanDevices::BeginTransfer(TransferContext* context)
+{
+	vkResetCommandBuffer(context->command_buffer, 0);
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(context->command_buffer, &begin_info);
+
+	return context->command_buffer;
+}
+
+void VulkanDevices::EndTransfer(TransferContext* context)
+{
+	vkEndCommandBuffer(context->command_buffer);
+
+	SubmitTransfer(context->command_buffer, context->fence);
+
+	// wait on this context's own work rather than the whole queue
+	vkWaitForFences(logical_device_, 1, &context->fence, VK_TRUE, UINT64_MAX);
+	vkResetFences(logical_device_, 1, &context->fence);
+}
+
+void VulkanDevices::SubmitTransfer(VkCommandBuffer command_buffer, VkFence fence)
+{
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &command_buffer;
+
+	// only the submission itself needs to be serialized
+	std::unique_lock<std::mutex> queue_lock(queue_mutex_);
+	VkResult result = vkQueueSubmit(copy_queue_, 1, &submit_info, fence);
+	queue_lock.unlock();
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit transfer command buffer!");
+	}
+}
+
+VkSampler VulkanDevices::GetSampler(const VkSamplerCreateInfo& sampler_info)
+{
+	// a sampler with extension structures could differ from a cached one with the same state
+	if (sampler_info.pNext != nullptr)
+	{
+		throw std::runtime_error("failed to cache sampler with extension structures!");
+	}
+
+	std::unique_lock<std::mutex> sampler_lock(sampler_mutex_);
+
+	auto sampler_it = samplers_.find(sampler_info);
+	if (sampler_it != samplers_.end())
+		return sampler_it->second;
+
+	VkSampler sampler;
+	if (vkCreateSampler(logical_device_, &sampler_info, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create sampler!");
+	}
+
+	samplers_[sampler_info] = sampler;
+	return sampler;
+}
+
+VkImageView VulkanDevices::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, uint32_t base_mip_level, uint32_t mip_level_count, uint32_t base_array_layer, uint32_t array_layer_count, VkImageViewType view_type)
 {
 	VkImageViewCreateInfo view_info = {};
 	view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	view_info.image = image;
-	view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_info.viewType = view_type;
 	view_info.format = format;
 	view_info.subresourceRange.aspectMask = aspect_flags;
-	view_info.subresourceRange.baseMipLevel = 0;
-	view_info.subresourceRange.levelCount = 1;
-	view_info.subresourceRange.baseArrayLayer = 0;
-	view_info.subresourceRange.layerCount = 1;
+	view_info.subresourceRange.baseMipLevel = base_mip_level;
+	view_info.subresourceRange.levelCount = mip_level_count;
+	view_info.subresourceRange.baseArrayLayer = base_array_layer;
+	view_info.subresourceRange.layerCount = array_layer_count;
 
 	VkImageView image_view;
 	if (vkCreateImageView(logical_device_, &view_info, nullptr, &image_view) != VK_SUCCESS)
@@ -133,15 +307,14 @@ bool VulkanDevices::IsDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surfa
 	VkPhysicalDeviceProperties device_properties;
 	vkGetPhysicalDeviceProperties(device, &device_properties);
 
-	// get device features
-	VkPhysicalDeviceFeatures device_features;
-	vkGetPhysicalDeviceFeatures(device, &device_features);
-
 	// check the device supports required queues
 	QueueFamilyIndices indices = FindQueueFamilies(device, surface);
 
 	// check the device supports required extensions
 	bool extensions_supported = CheckDeviceExtensionSupport(device, required_extensions);
+
+	// check the device supports every required feature, vkCreateDevice fails on any it lacks
+	bool features_supported = CheckDeviceFeatureSupport(device, required_features);
 	
 	// check the device supports the correct swap chain features
 	bool swap_chain_adequate = false;
@@ -151,7 +324,7 @@ bool VulkanDevices::IsDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surfa
 		swap_chain_adequate = !swap_chain_support.formats.empty() && !swap_chain_support.present_modes.empty();
 	}
 
-	return indices.isComplete() && extensions_supported && swap_chain_adequate && device_features.samplerAnisotropy == required_features.samplerAnisotropy && device_features.shaderSampledImageArrayDynamicIndexing == required_features.shaderSampledImageArrayDynamicIndexing;
+	return indices.isComplete() && extensions_supported && features_supported && swap_chain_adequate;
 }
 
 SwapChainSupportDetails VulkanDevices::QuerySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface)
@@ -200,6 +373,25 @@ bool VulkanDevices::CheckDeviceExtensionSupport(VkPhysicalDevice device, std::ve
 	return extensions.empty();
 }
 
+bool VulkanDevices::CheckDeviceFeatureSupport(VkPhysicalDevice device, VkPhysicalDeviceFeatures required_features)
+{
+	VkPhysicalDeviceFeatures available_features;
+	vkGetPhysicalDeviceFeatures(device, &available_features);
+
+	// the features struct is nothing but VkBool32 members
+	const VkBool32* required = reinterpret_cast<const VkBool32*>(&required_features);
+	const VkBool32* available = reinterpret_cast<const VkBool32*>(&available_features);
+	uint32_t feature_count = sizeof(VkPhysicalDeviceFeatures) / sizeof(VkBool32);
+
+	for (uint32_t i = 0; i < feature_count; i++)
+	{
+		if (required[i] && !available[i])
+			return false;
+	}
+
+	return true;
+}
+
 uint32_t VulkanDevices::FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties, VkDeviceSize memory_size)
 {
 	VkPhysicalDeviceMemoryProperties mem_properties;
@@ -264,7 +456,7 @@ void VulkanDevices::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Vk
 	vkBindBufferMemory(logical_device_, buffer, buffer_memory, 0);
 }
 
-void VulkanDevices::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& image_memory)
+void VulkanDevices::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& image_memory, uint32_t mip_levels, uint32_t array_layers)
 {
 	VkImageCreateInfo image_info = {};
 	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -272,8 +464,8 @@ void VulkanDevices::CreateImage(uint32_t width, uint32_t height, VkFormat format
 	image_info.extent.width = static_cast<uint32_t>(width);
 	image_info.extent.height = static_cast<uint32_t>(height);
 	image_info.extent.depth = 1;
-	image_info.mipLevels = 1;
-	image_info.arrayLayers = 1;
+	image_info.mipLevels = mip_levels;
+	image_info.arrayLayers = array_layers;
 	image_info.format = format;
 	image_info.tiling = tiling;
 	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -306,7 +498,7 @@ void VulkanDevices::CreateImage(uint32_t width, uint32_t height, VkFormat format
 	vkBindImageMemory(logical_device_, image, image_memory, 0);
 }
 
-void VulkanDevices::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout)
+void VulkanDevices::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels, uint32_t array_layers)
 {
 	VkCommandBuffer command_buffer = BeginSingleTimeCommands();
 
@@ -319,9 +511,9 @@ void VulkanDevices::TransitionImageLayout(VkImage image, VkFormat format, VkImag
 	barrier.image = image;
 	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.levelCount = mip_levels;
 	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
+	barrier.subresourceRange.layerCount = array_layers;
 	
 	if (old_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL ||new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
 	{
@@ -478,9 +670,30 @@ void VulkanDevices::CopyDataToBuffer(VkDeviceMemory dst_buffer_memory, void* dat
 	vkMapMemory(logical_device_, dst_buffer_memory, offset, size, 0, &mapped_data);
 	memcpy(mapped_data, data, size);
 	vkUnmapMemory(logical_device_, dst_buffer_memory);
+
+	uploaded_bytes_ += size;
+}
+
+void VulkanDevices::UploadDataToBuffer(VkBuffer dst_buffer, const void* data, VkDeviceSize size, VkDeviceSize offset)
+{
+	// stage the data through the calling thread's transfer context
+	TransferContext* transfer_context = GetTransferContext();
+	void* staging_data = ReserveStagingMemory(transfer_context, size);
+	memcpy(staging_data, data, (size_t)size);
+	uploaded_bytes_ += size;
+
+	VkCommandBuffer command_buffer = BeginTransfer(transfer_context);
+
+	VkBufferCopy copy_region = {};
+	copy_region.srcOffset = 0;
+	copy_region.dstOffset = offset;
+	copy_region.size = size;
+	vkCmdCopyBuffer(command_buffer, transfer_context->staging_buffer, dst_buffer, 1, &copy_region);
+
+	EndTransfer(transfer_context);
 }
 
-void VulkanDevices::CopyImage(VkImage src, VkImage dst, VkOffset3D dim, VkOffset3D src_offset, VkOffset3D dst_offset)
+void VulkanDevices::CopyImage(VkImage src, VkImage dst, VkOffset3D dim, VkOffset3D src_offset, VkOffset3D dst_offset, uint32_t src_array_layer, uint32_t dst_array_layer)
 {
 	// start the copy command buffer
 	VkCommandBuffer blit_buffer = BeginSingleTimeCommands();
@@ -489,14 +702,14 @@ void VulkanDevices::CopyImage(VkImage src, VkImage dst, VkOffset3D dim, VkOffset
 	image_blit.srcOffsets[0] = src_offset;
 	image_blit.srcOffsets[1] = src_offset + dim;
 	image_blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	image_blit.srcSubresource.baseArrayLayer = 0;
+	image_blit.srcSubresource.baseArrayLayer = src_array_layer;
 	image_blit.srcSubresource.layerCount = 1;
 	image_blit.srcSubresource.mipLevel = 0;
 
 	image_blit.dstOffsets[0] = dst_offset;
 	image_blit.dstOffsets[1] = dst_offset + dim;
 	image_blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	image_blit.dstSubresource.baseArrayLayer = 0;
+	image_blit.dstSubresource.baseArrayLayer = dst_array_layer;
 	image_blit.dstSubresource.layerCount = 1;
 	image_blit.dstSubresource.mipLevel = 0;
 
@@ -558,8 +771,10 @@ void VulkanDevices::EndSingleTimeCommands(VkCommandBuffer command_buffer, VkSema
 		submit_info.pWaitDstStageMask = wait_stages;
 	}
 
+	std::unique_lock<std::mutex> queue_lock(queue_mutex_);
 	vkQueueSubmit(copy_queue_, 1, &submit_info, VK_NULL_HANDLE);
 	vkQueueWaitIdle(copy_queue_);
+	queue_lock.unlock();
 
 	vkFreeCommandBuffers(logical_device_, transient_command_pool_, 1, &command_buffer);
 }
@@ -703,4 +918,53 @@ void VulkanDevices::WriteDebugFile(const char* msg)
 VkOffset3D operator+(VkOffset3D& a, VkOffset3D& b)
 {
 	return VkOffset3D{ a.x + b.x, a.y + b.y, a.z + b.z };
-}
\ No newline at end of file
+}
+
+size_t SamplerInfoHash::operator()(const VkSamplerCreateInfo& info) const
+{
+	// fnv-1a over each field, floats are hashed by value so negative zero matches zero
+	uint64_t hash = 14695981039346656037ull;
+	auto combine = [&hash](uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= 1099511628211ull;
+		}
+	};
+	auto combine_float = [&combine](float value)
+	{
+		value += 0.0f;
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		combine(bits);
+	};
+
+	combine(info.flags);
+	combine(info.magFilter);
+	combine(info.minFilter);
+	combine(info.mipmapMode);
+	combine(info.addressModeU);
+	combine(info.addressModeV);
+	combine(info.addressModeW);
+	combine_float(info.mipLodBias);
+	combine(info.anisotropyEnable);
+	combine_float(info.maxAnisotropy);
+	combine(info.compareEnable);
+	combine(info.compareOp);
+	combine_float(info.minLod);
+	combine_float(info.maxLod);
+	combine(info.borderColor);
+	combine(info.unnormalizedCoordinates);
+
+	return static_cast<size_t>(hash);
+}
+
+bool SamplerInfoEqual::operator()(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b) const
+{
+	return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter && a.mipmapMode == b.mipmapMode &&
+		a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV && a.addressModeW == b.addressModeW &&
+		a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable && a.maxAnisotropy == b.maxAnisotropy &&
+		a.compareEnable == b.compareEnable && a.compareOp == b.compareOp && a.minLod == b.minLod && a.maxLod == b.maxLod &&
+		a.borderColor == b.borderColor && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
@@ -3,6 +3,10 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <mutex>
+#include <unordered_map>
+
+#include "job_system.h"
 
 typedef bool(*check_function)(void);
 
@@ -26,6 +30,30 @@ struct SwapChainSupportDetails
 	std::vector<VkPresentModeKHR> present_modes;
 };
 
+// hashes and compares the sampler state of a create info, extension structures are not part of it
+struct SamplerInfoHash
+{
+	size_t operator()(const VkSamplerCreateInfo& info) const;
+};
+
+struct SamplerInfoEqual
+{
+	bool operator()(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b) const;
+};
+
+// per thread command pool and staging memory so uploads can be recorded from job system workers
+struct TransferContext
+{
+	VkCommandPool command_pool;
+	VkCommandBuffer command_buffer;
+	VkFence fence;
+
+	VkBuffer staging_buffer;
+	VkDeviceMemory staging_buffer_memory;
+	VkDeviceSize staging_buffer_size;
+	void* staging_data;
+};
+
 class VulkanDevices
 {
 public:
@@ -35,25 +63,31 @@ public:
 	void CreateLogicalDevice(VkPhysicalDeviceFeatures, std::vector<VkDeviceQueueCreateInfo>, std::vector<const char*>, std::vector<const char*>);
 
 	void CreateBuffer(VkDeviceSize, VkBufferUsageFlags, VkMemoryPropertyFlags, VkBuffer&, VkDeviceMemory&);
-	void CreateImage(uint32_t, uint32_t, VkFormat, VkImageTiling, VkImageUsageFlags, VkMemoryPropertyFlags, VkImage&, VkDeviceMemory&);
-	VkImageView CreateImageView(VkImage, VkFormat, VkImageAspectFlags);
+	void CreateImage(uint32_t, uint32_t, VkFormat, VkImageTiling, VkImageUsageFlags, VkMemoryPropertyFlags, VkImage&, VkDeviceMemory&, uint32_t mip_levels = 1, uint32_t array_layers = 1);
+	// returns the sampler shared by every caller with the same create info, the samplers are destroyed with the device
+	VkSampler GetSampler(const VkSamplerCreateInfo& sampler_info);
+	VkImageView CreateImageView(VkImage, VkFormat, VkImageAspectFlags, uint32_t base_mip_level = 0, uint32_t mip_level_count = 1, uint32_t base_array_layer = 0, uint32_t array_layer_count = 1, VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D);
 	void CreateCommandBuffers(VkCommandPool command_pool, VkCommandBuffer* buffers, uint8_t count = 1);
 
 	void CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize offset = 0);
 	void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 	void CopyDataToBuffer(VkDeviceMemory dst_buffer_memory, void* data, VkDeviceSize size, VkDeviceSize offset = 0);
-	void CopyImage(VkImage src_image, VkImage dst_image, VkOffset3D dimensions, VkOffset3D src_offset = { 0, 0, 0 }, VkOffset3D dst_offset = { 0, 0, 0 });
+	void UploadDataToBuffer(VkBuffer dst_buffer, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+	void CopyImage(VkImage src_image, VkImage dst_image, VkOffset3D dimensions, VkOffset3D src_offset = { 0, 0, 0 }, VkOffset3D dst_offset = { 0, 0, 0 }, uint32_t src_array_layer = 0, uint32_t dst_array_layer = 0);
 	void ClearColorImage(VkImage image, VkImageLayout image_layout, VkClearColorValue color);
 
-	void TransitionImageLayout(VkImage, VkFormat, VkImageLayout, VkImageLayout);
+	void TransitionImageLayout(VkImage, VkFormat, VkImageLayout, VkImageLayout, uint32_t mip_levels = 1, uint32_t array_layers = 1);
 
 	VkPhysicalDevice GetPhysicalDevice() { return physical_device_; }
 	VkDevice GetLogicalDevice() { return logical_device_; }
 	QueueFamilyIndices GetQueueFamilyIndices() { return queue_family_indices_; }
+	const VkPhysicalDeviceFeatures& GetEnabledFeatures() { return enabled_features_; }
 
 	uint32_t FindMemoryType(uint32_t, VkMemoryPropertyFlags, VkDeviceSize);
 	VkFormat FindSupportedFormat(const std::vector<VkFormat>&, VkImageTiling, VkFormatFeatureFlags);
 	
+	bool HasStencilComponent(VkFormat format);
+
 	static QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice, VkSurfaceKHR);
 
 	SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice, VkSurfaceKHR);
@@ -61,24 +95,51 @@ public:
 	VkCommandBuffer BeginSingleTimeCommands();
 	void EndSingleTimeCommands(VkCommandBuffer, VkSemaphore = VK_NULL_HANDLE);
 
+	inline JobSystem* GetJobSystem() { return job_system_; }
+
+	// running total of bytes written to buffers from the host, used to measure per frame upload cost
+	inline uint64_t GetUploadedBytes() { return uploaded_bytes_; }
+
+	TransferContext* GetTransferContext();
+	void* ReserveStagingMemory(TransferContext* context, VkDeviceSize size);
+	VkCommandBuffer BeginTransfer(TransferContext* context);
+	void EndTransfer(TransferContext* context);
+
+	// submits recorded transfer commands to the copy queue without waiting, the fence is signalled once they complete
+	void SubmitTransfer(VkCommandBuffer command_buffer, VkFence fence);
+
 protected:
 	void CreateCopyCommandPool();
+	void CreateTransferContexts();
+	void DestroyTransferContexts();
 
-	bool HasStencilComponent(VkFormat format);
 
 	void PickPhysicalDevice(VkInstance, VkSurfaceKHR, VkPhysicalDeviceFeatures, std::vector<const char*>);
 	bool IsDeviceSuitable(VkPhysicalDevice, VkSurfaceKHR, VkPhysicalDeviceFeatures, std::vector<const char*>);
 	bool CheckDeviceExtensionSupport(VkPhysicalDevice, std::vector<const char*>);
+	bool CheckDeviceFeatureSupport(VkPhysicalDevice, VkPhysicalDeviceFeatures);
 
 
 protected:
 	VkPhysicalDevice physical_device_;
 	VkDevice logical_device_;
 	QueueFamilyIndices queue_family_indices_;
+	VkPhysicalDeviceFeatures enabled_features_;
 
 	VkCommandPool transient_command_pool_;
 	VkQueue copy_queue_;
 
+	// guards submissions to the copy queue made from multiple threads
+	std::mutex queue_mutex_;
+
+	JobSystem* job_system_;
+	std::vector<TransferContext> transfer_contexts_;
+
+	std::atomic<uint64_t> uploaded_bytes_;
+
+	std::mutex sampler_mutex_;
+	std::unordered_map<VkSamplerCreateInfo, VkSampler, SamplerInfoHash, SamplerInfoEqual> samplers_;
+
 public:
 	static std::vector<char> ReadFile(const std::string& filename);
 	static void WriteFile(const std::string& filename, const std::string& contents);
@@ -0,0 +1,123 @@
+#include "dynamic_resolution.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+// number of frames the gpu time is averaged over before the scale is adjusted
+static const uint32_t SCALE_ADJUST_INTERVAL = 8;
+
+// the scale is only raised once the frame time has dropped this far under budget, which stops it bouncing at the limit
+static const float SCALE_RAISE_FRACTION = 0.75f;
+
+// each adjustment aims a little under budget so one slow frame does not push it straight back over
+static const float SCALE_TARGET_FRACTION = 0.9f;
+
+// scales are snapped to this step so small timing noise does not change the render extent
+static const float SCALE_STEP = 0.05f;
+
+void DynamicResolution::Init(VulkanDevices* devices, float target_frame_time, float min_scale, float max_scale)
+{
+	devices_ = devices;
+	target_frame_time_ = target_frame_time;
+	min_scale_ = min_scale;
+	max_scale_ = max_scale;
+	scale_ = max_scale;
+
+	query_pool_ = VK_NULL_HANDLE;
+	total_frame_time_ = 0.0;
+	frame_count_ = 0;
+
+	VkPhysicalDeviceProperties device_properties;
+	vkGetPhysicalDeviceProperties(devices_->GetPhysicalDevice(), &device_properties);
+	timestamp_period_ = device_properties.limits.timestampPeriod;
+
+	// without timestamps there is nothing to drive the scale, so it stays at the maximum
+	if (!device_properties.limits.timestampComputeAndGraphics)
+	{
+		std::cout << "Dynamic resolution needs timestamp queries, which this device does not support" << std::endl;
+		return;
+	}
+
+	VkQueryPoolCreateInfo query_pool_info = {};
+	query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	query_pool_info.queryCount = 2;
+
+	if (vkCreateQueryPool(devices_->GetLogicalDevice(), &query_pool_info, nullptr, &query_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create dynamic resolution query pool!");
+	}
+}
+
+void DynamicResolution::Cleanup()
+{
+	if (query_pool_ != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(devices_->GetLogicalDevice(), query_pool_, nullptr);
+		query_pool_ = VK_NULL_HANDLE;
+	}
+}
+
+void DynamicResolution::Update()
+{
+	if (query_pool_ == VK_NULL_HANDLE)
+		return;
+
+	// not ready until the queries have been submitted once, the present has idled the queue since then
+	uint64_t timestamps[2];
+	if (vkGetQueryPoolResults(devices_->GetLogicalDevice(), query_pool_, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	// timestamps are in ticks of the timestamp period in nanoseconds
+	double frame_time = (timestamps[1] - timestamps[0]) * timestamp_period_ / 1000000.0;
+	total_frame_time_ += frame_time;
+	frame_count_++;
+
+	std::cout << "Render scale: " << scale_ << ", scene gpu time " << frame_time << " ms" << std::endl;
+
+	if (frame_count_ < SCALE_ADJUST_INTERVAL)
+		return;
+
+	double average_frame_time = total_frame_time_ / frame_count_;
+	total_frame_time_ = 0.0;
+	frame_count_ = 0;
+
+	if (average_frame_time <= target_frame_time_ && average_frame_time >= target_frame_time_ * SCALE_RAISE_FRACTION)
+		return;
+
+	// the gpu time follows the pixel count, which goes with the square of the scale
+	float target_scale = scale_ * (float)sqrt(target_frame_time_ * SCALE_TARGET_FRACTION / std::max(average_frame_time, 0.001));
+	target_scale = roundf(target_scale / SCALE_STEP) * SCALE_STEP;
+
+	scale_ = std::min(std::max(target_scale, min_scale_), max_scale_);
+}
+
+void DynamicResolution::RecordFrameStart(VkCommandBuffer command_buffer)
+{
+	if (query_pool_ == VK_NULL_HANDLE)
+		return;
+
+	vkCmdResetQueryPool(command_buffer, query_pool_, 0, 2);
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool_, 0);
+}
+
+void DynamicResolution::RecordFrameEnd(VkCommandBuffer command_buffer)
+{
+	if (query_pool_ == VK_NULL_HANDLE)
+		return;
+
+	// written once all of the frame's work before it has completed
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool_, 1);
+}
+
+VkExtent2D DynamicResolution::GetRenderExtent(VkExtent2D full_extent)
+{
+	if (scale_ >= 1.0f)
+		return full_extent;
+
+	VkExtent2D render_extent;
+	render_extent.width = std::min(std::max((uint32_t)(full_extent.width * scale_) & ~1u, 2u), full_extent.width);
+	render_extent.height = std::min(std::max((uint32_t)(full_extent.height * scale_) & ~1u, 2u), full_extent.height);
+
+	return render_extent;
+}
@@ -0,0 +1,40 @@
+#ifndef _DYNAMIC_RESOLUTION_H_
+#define _DYNAMIC_RESOLUTION_H_
+
+#include "device.h"
+
+// picks the scale the scene is rendered at from the gpu time of the previous frames, keeping it inside a frame time budget
+class DynamicResolution
+{
+public:
+	void Init(VulkanDevices* devices, float target_frame_time, float min_scale, float max_scale);
+	void Cleanup();
+
+	// reads back the last frame's gpu time and every few frames moves the scale towards the budget
+	void Update();
+
+	// timestamps around the passes that are scaled, recorded outside of any render pass
+	void RecordFrameStart(VkCommandBuffer command_buffer);
+	void RecordFrameEnd(VkCommandBuffer command_buffer);
+
+	// the scaled part of the full extent, kept even so it lines up with the half resolution hdr images
+	VkExtent2D GetRenderExtent(VkExtent2D full_extent);
+
+	inline float GetScale() { return scale_; }
+
+protected:
+	VulkanDevices* devices_;
+
+	VkQueryPool query_pool_;
+	float timestamp_period_;
+
+	// frame time budget in milliseconds and the bounds the scale is kept within
+	float target_frame_time_;
+	float min_scale_, max_scale_;
+	float scale_;
+
+	double total_frame_time_;
+	uint32_t frame_count_;
+};
+
+#endif
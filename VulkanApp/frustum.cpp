@@ -0,0 +1,110 @@
+#include "frustum.h"
+#include "camera.h"
+
+#ifdef FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+void AABBList::Resize(size_t count)
+{
+	min_x.resize(count);
+	min_y.resize(count);
+	min_z.resize(count);
+	max_x.resize(count);
+	max_y.resize(count);
+	max_z.resize(count);
+}
+
+void AABBList::Set(size_t index, const glm::vec3& min, const glm::vec3& max)
+{
+	min_x[index] = min.x;
+	min_y[index] = min.y;
+	min_z[index] = min.z;
+	max_x[index] = max.x;
+	max_y[index] = max.y;
+	max_z[index] = max.z;
+}
+
+Frustum::Frustum()
+{
+	// start with planes that accept everything
+	for (int i = 0; i < 6; i++)
+		planes_[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void Frustum::Update(const glm::mat4& view_projection)
+{
+	Camera::ExtractFrustumPlanes(view_projection, planes_);
+}
+
+bool Frustum::TestAABB(const glm::vec3& min, const glm::vec3& max) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		// test the corner furthest along the plane normal, if it is behind the plane the whole box is
+		const glm::vec4& plane = planes_[i];
+		glm::vec3 positive_vertex = glm::vec3(plane.x > 0.0f ? max.x : min.x, plane.y > 0.0f ? max.y : min.y, plane.z > 0.0f ? max.z : min.z);
+
+		if (glm::dot(glm::vec3(plane), positive_vertex) + plane.w < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+void Frustum::TestAABBs(const AABBList& boxes, std::vector<uint8_t>& visible) const
+{
+	size_t box_count = boxes.Size();
+	visible.resize(box_count);
+
+	size_t first_scalar = 0;
+
+#ifdef FRUSTUM_USE_SSE
+	// test four boxes per iteration, the positive vertex choice only depends on the plane so it is made once per plane
+	size_t simd_count = box_count & ~(size_t)3;
+	for (size_t i = 0; i < simd_count; i += 4)
+	{
+		// all lanes start inside
+		__m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4& plane = planes_[p];
+			const float* px = (plane.x > 0.0f) ? &boxes.max_x[i] : &boxes.min_x[i];
+			const float* py = (plane.y > 0.0f) ? &boxes.max_y[i] : &boxes.min_y[i];
+			const float* pz = (plane.z > 0.0f) ? &boxes.max_z[i] : &boxes.min_z[i];
+
+			__m128 distance = _mm_mul_ps(_mm_loadu_ps(px), _mm_set1_ps(plane.x));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(py), _mm_set1_ps(plane.y)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(pz), _mm_set1_ps(plane.z)));
+			distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		visible[i + 0] = (mask >> 0) & 1;
+		visible[i + 1] = (mask >> 1) & 1;
+		visible[i + 2] = (mask >> 2) & 1;
+		visible[i + 3] = (mask >> 3) & 1;
+	}
+
+	first_scalar = simd_count;
+#endif
+
+	// remaining boxes, or all of them without sse
+	if (first_scalar < box_count)
+		TestAABBsScalar(boxes, first_scalar, box_count - first_scalar, &visible[first_scalar]);
+}
+
+void Frustum::TestAABBsScalar(const AABBList& boxes, size_t first, size_t count, uint8_t* visible) const
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t box = first + i;
+		glm::vec3 min = glm::vec3(boxes.min_x[box], boxes.min_y[box], boxes.min_z[box]);
+		glm::vec3 max = glm::vec3(boxes.max_x[box], boxes.max_y[box], boxes.max_z[box]);
+
+		visible[i] = TestAABB(min, max) ? 1 : 0;
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef _FRUSTUM_H_
+#define _FRUSTUM_H_
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+// use the sse path wherever the compiler targets it
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define FRUSTUM_USE_SSE
+#endif
+
+// structure of arrays box list so several boxes can be tested at once
+struct AABBList
+{
+	std::vector<float> min_x, min_y, min_z;
+	std::vector<float> max_x, max_y, max_z;
+
+	void Resize(size_t count);
+	void Set(size_t index, const glm::vec3& min, const glm::vec3& max);
+
+	inline size_t Size() const { return min_x.size(); }
+};
+
+class Frustum
+{
+public:
+	Frustum();
+
+	void Update(const glm::mat4& view_projection);
+
+	bool TestAABB(const glm::vec3& min, const glm::vec3& max) const;
+
+	// writes 1 for each box that intersects the frustum and 0 for each culled box
+	void TestAABBs(const AABBList& boxes, std::vector<uint8_t>& visible) const;
+
+	inline const glm::vec4* GetPlanes() const { return planes_; }
+
+protected:
+	void TestAABBsScalar(const AABBList& boxes, size_t first, size_t count, uint8_t* visible) const;
+
+protected:
+	// left, right, bottom, top, near and far, normals point inwards
+	glm::vec4 planes_[6];
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include "hiz_pyramid.h"
+#include <algorithm>
+
+void HiZPyramid::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain)
+{
+	devices_ = devices;
+	swap_chain_ = swap_chain;
+
+	InitResources();
+	InitShaders();
+	InitPipelines();
+}
+
+void HiZPyramid::Cleanup()
+{
+	// clean up pipelines
+	for (HiZPipeline* pipeline : hiz_pipelines_)
+	{
+		pipeline->CleanUp();
+		delete pipeline;
+	}
+	hiz_pipelines_.clear();
+
+	// clean up shaders
+	depth_reduce_shader_->Cleanup();
+	delete depth_reduce_shader_;
+	depth_reduce_shader_ = nullptr;
+
+	downsample_shader_->Cleanup();
+	delete downsample_shader_;
+	downsample_shader_ = nullptr;
+
+	// clean up the pyramid image
+	for (VkImageView level_view : level_image_views_)
+	{
+		vkDestroyImageView(devices_->GetLogicalDevice(), level_view, nullptr);
+	}
+	level_image_views_.clear();
+
+	vkDestroyImageView(devices_->GetLogicalDevice(), hiz_image_view_, nullptr);
+	vkDestroyImage(devices_->GetLogicalDevice(), hiz_image_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), hiz_image_memory_, nullptr);
+}
+
+void HiZPyramid::InitResources()
+{
+	// level zero is half the depth buffer resolution, the levels continue down to a single texel
+	VkExtent2D depth_extent = swap_chain_->GetSwapChainExtent();
+	uint32_t width = std::max(depth_extent.width / 2, 1u);
+	uint32_t height = std::max(depth_extent.height / 2, 1u);
+
+	mip_count_ = 1;
+	level_widths_.push_back(width);
+	level_heights_.push_back(height);
+	while (width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+		level_widths_.push_back(width);
+		level_heights_.push_back(height);
+		mip_count_++;
+	}
+
+	devices_->CreateImage(level_widths_[0], level_heights_[0], VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, hiz_image_, hiz_image_memory_, mip_count_);
+
+	// the culling passes sample the whole chain, the build writes each level through its own view
+	hiz_image_view_ = devices_->CreateImageView(hiz_image_, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_count_);
+	for (uint32_t i = 0; i < mip_count_; i++)
+	{
+		level_image_views_.push_back(devices_->CreateImageView(hiz_image_, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, i, 1));
+	}
+
+	devices_->TransitionImageLayout(hiz_image_, VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mip_count_);
+
+	// levels are read with texelFetch, the sampler only has to cover every level
+	VkSamplerCreateInfo sampler_info = {};
+	sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_info.magFilter = VK_FILTER_NEAREST;
+	sampler_info.minFilter = VK_FILTER_NEAREST;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.anisotropyEnable = VK_FALSE;
+	sampler_info.maxAnisotropy = 1;
+	sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	sampler_info.unnormalizedCoordinates = VK_FALSE;
+	sampler_info.compareEnable = VK_FALSE;
+	sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+	sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_info.minLod = 0.0f;
+	sampler_info.maxLod = static_cast<float>(mip_count_);
+
+	hiz_sampler_ = devices_->GetSampler(sampler_info);
+}
+
+void HiZPyramid::InitShaders()
+{
+	depth_reduce_shader_ = new VulkanComputeShader();
+	depth_reduce_shader_->Init(devices_, swap_chain_, "../res/shaders/hiz_depth_reduce.comp.spv");
+
+	downsample_shader_ = new VulkanComputeShader();
+	downsample_shader_->Init(devices_, swap_chain_, "../res/shaders/hiz_downsample.comp.spv");
+}
+
+void HiZPyramid::InitPipelines()
+{
+	// level zero reads the depth buffer directly
+	HiZPipeline* depth_reduce_pipeline = new HiZPipeline();
+	depth_reduce_pipeline->SetShader(depth_reduce_shader_);
+	depth_reduce_pipeline->SetOutputSize(level_widths_[0], level_heights_[0]);
+	depth_reduce_pipeline->AddTexture(0, swap_chain_->GetDepthImageView());
+	depth_reduce_pipeline->AddSampler(1, hiz_sampler_);
+	depth_reduce_pipeline->AddStorageImage(2, level_image_views_[0]);
+	depth_reduce_pipeline->Init(devices_);
+	hiz_pipelines_.push_back(depth_reduce_pipeline);
+
+	// every other level reads the one below it
+	for (uint32_t i = 1; i < mip_count_; i++)
+	{
+		HiZPipeline* downsample_pipeline = new HiZPipeline();
+		downsample_pipeline->SetShader(downsample_shader_);
+		downsample_pipeline->SetOutputSize(level_widths_[i], level_heights_[i]);
+		downsample_pipeline->AddStorageImage(0, level_image_views_[i - 1]);
+		downsample_pipeline->AddStorageImage(1, level_image_views_[i]);
+		downsample_pipeline->Init(devices_);
+		hiz_pipelines_.push_back(downsample_pipeline);
+	}
+}
+
+void HiZPyramid::RecordBuildCommands(VkCommandBuffer command_buffer)
+{
+	VkImageAspectFlags depth_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (devices_->HasStencilComponent(swap_chain_->GetDepthFormat()))
+		depth_aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+	// let the depth writes land and read the depth buffer as a texture
+	VkImageMemoryBarrier depth_barrier = {};
+	depth_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	depth_barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depth_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	depth_barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depth_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	depth_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depth_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depth_barrier.image = swap_chain_->GetDepthImage();
+	depth_barrier.subresourceRange = { depth_aspect, 0, 1, 0, 1 };
+
+	// the previous contents are rebuilt entirely, so the old levels can be discarded once the culling reads are done
+	VkImageMemoryBarrier hiz_barrier = {};
+	hiz_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	hiz_barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	hiz_barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	hiz_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	hiz_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	hiz_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hiz_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hiz_barrier.image = hiz_image_;
+	hiz_barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_count_, 0, 1 };
+
+	VkImageMemoryBarrier start_barriers[] = { depth_barrier, hiz_barrier };
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 2, start_barriers);
+
+	// build the levels in order, each waits on the one below
+	for (uint32_t i = 0; i < mip_count_; i++)
+	{
+		if (i > 0)
+		{
+			VkImageMemoryBarrier level_barrier = hiz_barrier;
+			level_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			level_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			level_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+			level_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			level_barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1, 0, 1 };
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &level_barrier);
+		}
+
+		hiz_pipelines_[i]->RecordCommands(command_buffer);
+	}
+
+	// hand the pyramid to the culling pass and the depth buffer back to the render passes
+	hiz_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	hiz_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	hiz_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	hiz_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	depth_barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	depth_barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depth_barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	depth_barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &hiz_barrier);
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 0, nullptr, 0, nullptr, 1, &depth_barrier);
+}
@@ -0,0 +1,49 @@
+#ifndef _HIZ_PYRAMID_H_
+#define _HIZ_PYRAMID_H_
+
+#include <vector>
+#include <glm\glm.hpp>
+
+#include "device.h"
+#include "swap_chain.h"
+#include "compute_shader.h"
+#include "pipelines\hiz_pipeline.h"
+
+// hierarchical depth buffer built from the swap chain depth image, each level keeps the furthest depth of the 2x2 texels below it
+class HiZPyramid
+{
+public:
+	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain);
+	void Cleanup();
+
+	// records the build from the depth buffer, the depth image must be in the depth attachment layout and is returned to it
+	void RecordBuildCommands(VkCommandBuffer command_buffer);
+
+	// between builds every level is in the shader read only layout
+	inline VkImageView GetImageView() { return hiz_image_view_; }
+	inline VkSampler GetSampler() { return hiz_sampler_; }
+	inline glm::vec2 GetSize() { return glm::vec2(level_widths_[0], level_heights_[0]); }
+	inline uint32_t GetMipCount() { return mip_count_; }
+
+protected:
+	void InitResources();
+	void InitShaders();
+	void InitPipelines();
+
+protected:
+	VulkanDevices* devices_;
+	VulkanSwapChain* swap_chain_;
+
+	VkImage hiz_image_;
+	VkDeviceMemory hiz_image_memory_;
+	VkImageView hiz_image_view_;
+	std::vector<VkImageView> level_image_views_;
+	std::vector<uint32_t> level_widths_, level_heights_;
+	uint32_t mip_count_;
+	VkSampler hiz_sampler_;
+
+	VulkanComputeShader *depth_reduce_shader_, *downsample_shader_;
+	std::vector<HiZPipeline*> hiz_pipelines_;
+};
+
+#endif
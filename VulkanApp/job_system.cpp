@@ -0,0 +1,231 @@
+#include "job_system.h"
+#include <algorithm>
+#include <climits>
+
+// index of the pool worker running on this thread, UINT_MAX for threads outside the pool
+static thread_local uint32_t current_worker_index = UINT_MAX;
+
+JobSystem::JobSystem()
+{
+	worker_count_ = 0;
+	running_ = false;
+	queued_jobs_ = 0;
+}
+
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+void JobSystem::Init(uint32_t worker_count)
+{
+	if (running_)
+		return;
+
+	// leave a core for the main thread, which also runs jobs while it waits
+	if (worker_count == 0)
+	{
+		uint32_t hardware_threads = std::thread::hardware_concurrency();
+		worker_count = (hardware_threads > 1) ? hardware_threads - 1 : 1;
+	}
+
+	worker_count_ = worker_count;
+	running_ = true;
+
+	// create one queue per worker
+	for (uint32_t i = 0; i < worker_count_; i++)
+	{
+		WorkerQueue* queue = new WorkerQueue();
+		queue->pending_weight = 0;
+		queues_.push_back(queue);
+	}
+
+	// start the workers
+	for (uint32_t i = 0; i < worker_count_; i++)
+	{
+		workers_.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+void JobSystem::Shutdown()
+{
+	if (!running_)
+		return;
+
+	// wake every worker so they can see the pool is shutting down
+	{
+		std::unique_lock<std::mutex> wake_lock(wake_mutex_);
+		running_ = false;
+	}
+	wake_condition_.notify_all();
+
+	for (std::thread& worker : workers_)
+	{
+		worker.join();
+	}
+	workers_.clear();
+
+	for (WorkerQueue* queue : queues_)
+	{
+		delete queue;
+	}
+	queues_.clear();
+
+	worker_count_ = 0;
+	queued_jobs_ = 0;
+}
+
+uint32_t JobSystem::GetCurrentWorkerIndex()
+{
+	if (current_worker_index == UINT_MAX)
+		return worker_count_;
+
+	return current_worker_index;
+}
+
+void JobSystem::Submit(Job job, uint64_t weight, JobCounter* counter)
+{
+	if (counter)
+		counter->pending++;
+
+	// place the job on the queue with the least outstanding work
+	WorkerQueue* target_queue = queues_[0];
+	uint64_t target_weight = ULLONG_MAX;
+	for (WorkerQueue* queue : queues_)
+	{
+		std::unique_lock<std::mutex> queue_lock(queue->mutex);
+		if (queue->pending_weight < target_weight)
+		{
+			target_queue = queue;
+			target_weight = queue->pending_weight;
+		}
+	}
+
+	// count the job before it becomes visible so the queued total never underflows
+	{
+		std::unique_lock<std::mutex> wake_lock(wake_mutex_);
+		queued_jobs_++;
+	}
+
+	{
+		std::unique_lock<std::mutex> queue_lock(target_queue->mutex);
+		target_queue->jobs.push_back({ job, weight, counter });
+		target_queue->pending_weight += weight;
+	}
+
+	// wake a sleeping worker
+	wake_condition_.notify_one();
+}
+
+void JobSystem::Wait(JobCounter* counter)
+{
+	uint32_t worker_index = GetCurrentWorkerIndex();
+
+	// help out with queued work instead of blocking
+	while (counter->pending > 0)
+	{
+		JobEntry entry;
+		if (StealJob(worker_index, entry))
+		{
+			RunJob(entry, worker_index);
+			continue;
+		}
+
+		// nothing left to take, the remaining jobs are already running on workers
+		std::unique_lock<std::mutex> wake_lock(wake_mutex_);
+		done_condition_.wait(wake_lock, [&] { return counter->pending == 0 || queued_jobs_ > 0; });
+	}
+
+	if (counter->exception)
+	{
+		std::exception_ptr exception = counter->exception;
+		counter->exception = nullptr;
+		std::rethrow_exception(exception);
+	}
+}
+
+void JobSystem::WorkerLoop(uint32_t worker_index)
+{
+	current_worker_index = worker_index;
+
+	while (true)
+	{
+		JobEntry entry;
+		if (PopJob(worker_index, entry) || StealJob(worker_index, entry))
+		{
+			RunJob(entry, worker_index);
+			continue;
+		}
+
+		// sleep until more work is submitted
+		std::unique_lock<std::mutex> wake_lock(wake_mutex_);
+		wake_condition_.wait(wake_lock, [&] { return queued_jobs_ > 0 || !running_; });
+
+		if (!running_)
+			return;
+	}
+}
+
+bool JobSystem::PopJob(uint32_t worker_index, JobEntry& entry)
+{
+	WorkerQueue* queue = queues_[worker_index];
+	std::unique_lock<std::mutex> queue_lock(queue->mutex);
+
+	if (queue->jobs.empty())
+		return false;
+
+	// owners take the heaviest job first
+	entry = queue->jobs.front();
+	queue->jobs.pop_front();
+	queue->pending_weight -= entry.weight;
+	queued_jobs_--;
+
+	return true;
+}
+
+bool JobSystem::StealJob(uint32_t thief_index, JobEntry& entry)
+{
+	for (uint32_t i = 1; i <= worker_count_; i++)
+	{
+		WorkerQueue* queue = queues_[(thief_index + i) % worker_count_];
+		std::unique_lock<std::mutex> queue_lock(queue->mutex);
+
+		if (queue->jobs.empty())
+			continue;
+
+		// thieves take the lightest job so a late steal never becomes the straggler
+		entry = queue->jobs.back();
+		queue->jobs.pop_back();
+		queue->pending_weight -= entry.weight;
+		queued_jobs_--;
+
+		return true;
+	}
+
+	return false;
+}
+
+void JobSystem::RunJob(JobEntry& entry, uint32_t worker_index)
+{
+	try
+	{
+		entry.job(worker_index);
+	}
+	catch (...)
+	{
+		if (entry.counter)
+		{
+			std::unique_lock<std::mutex> exception_lock(entry.counter->exception_mutex);
+			if (!entry.counter->exception)
+				entry.counter->exception = std::current_exception();
+		}
+	}
+
+	if (entry.counter)
+	{
+		// let any waiters know the batch has finished
+		std::unique_lock<std::mutex> wake_lock(wake_mutex_);
+		entry.counter->pending--;
+		done_condition_.notify_all();
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef _JOB_SYSTEM_H_
+#define _JOB_SYSTEM_H_
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <exception>
+
+// tracks a batch of submitted jobs so the submitter can wait on just that batch
+struct JobCounter
+{
+	JobCounter() : pending(0) {}
+
+	std::atomic<uint32_t> pending;
+
+	// first exception thrown by a job in this batch, rethrown by JobSystem::Wait
+	std::mutex exception_mutex;
+	std::exception_ptr exception;
+};
+
+class JobSystem
+{
+public:
+	// jobs receive the index of the worker running them so they can use per worker resources
+	typedef std::function<void(uint32_t)> Job;
+
+	JobSystem();
+	~JobSystem();
+
+	void Init(uint32_t worker_count = 0);
+	void Shutdown();
+
+	void Submit(Job job, uint64_t weight = 1, JobCounter* counter = nullptr);
+	void Wait(JobCounter* counter);
+
+	inline uint32_t GetWorkerCount() { return worker_count_; }
+
+	// threads outside the pool share this index, only one of them may wait on jobs at a time
+	inline uint32_t GetExternalWorkerIndex() { return worker_count_; }
+	uint32_t GetCurrentWorkerIndex();
+
+protected:
+	struct JobEntry
+	{
+		Job job;
+		uint64_t weight;
+		JobCounter* counter;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<JobEntry> jobs;
+		uint64_t pending_weight;
+	};
+
+	void WorkerLoop(uint32_t worker_index);
+	bool PopJob(uint32_t worker_index, JobEntry& entry);
+	bool StealJob(uint32_t thief_index, JobEntry& entry);
+	void RunJob(JobEntry& entry, uint32_t worker_index);
+
+protected:
+	uint32_t worker_count_;
+	bool running_;
+
+	std::vector<std::thread> workers_;
+	std::vector<WorkerQueue*> queues_;
+
+	std::atomic<uint32_t> queued_jobs_;
+
+	std::mutex wake_mutex_;
+	std::condition_variable wake_condition_;
+	std::condition_variable done_condition_;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _KTX2_H_
+#define _KTX2_H_
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+
+// layout of the ktx2 container, shared by the texture loader and the offline texture compressor
+// the file is the header, one level index entry per mip level, the data format descriptor and then the levels, smallest first
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct KTX2Header
+{
+	uint8_t identifier[12];
+	uint32_t vk_format;
+	uint32_t type_size;
+	uint32_t pixel_width;
+	uint32_t pixel_height;
+	uint32_t pixel_depth;
+	uint32_t layer_count;
+	uint32_t face_count;
+	uint32_t level_count;
+	uint32_t supercompression_scheme;
+
+	uint32_t dfd_byte_offset;
+	uint32_t dfd_byte_length;
+	uint32_t kvd_byte_offset;
+	uint32_t kvd_byte_length;
+	uint64_t sgd_byte_offset;
+	uint64_t sgd_byte_length;
+};
+
+// level zero is the first entry, the byte offsets are from the start of the file
+struct KTX2LevelIndex
+{
+	uint64_t byte_offset;
+	uint64_t byte_length;
+	uint64_t uncompressed_byte_length;
+};
+
+static_assert(sizeof(KTX2Header) == 80, "ktx2 header must match the file layout");
+static_assert(sizeof(KTX2LevelIndex) == 24, "ktx2 level index must match the file layout");
+
+// bytes per 4x4 block of the block compressed formats the loader accepts, zero for any other format
+inline uint32_t KTX2BlockSize(uint32_t vk_format)
+{
+	switch (vk_format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		return 8;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+#endif
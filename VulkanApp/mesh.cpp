@@ -3,8 +3,11 @@
 #include <tiny_obj_loader.h>
 #include <unordered_map>
 #include <iostream>
-#include <thread>
+#include <numeric>
 #include "renderer.h"
+#include "camera.h"
+#include "compute_shader.h"
+#include "pipelines\meshlet_culling_pipeline.h"
 
 Mesh::Mesh()
 {
@@ -12,6 +15,19 @@ Mesh::Mesh()
 	vk_device_handle_ = VK_NULL_HANDLE;
 	min_vertex_ = glm::vec3(1e9f, 1e9f, 1e9f);
 	max_vertex_ = glm::vec3(-1e9f, -1e9f, -1e9f);
+	merged_ = false;
+	indirect_buffer_ = VK_NULL_HANDLE;
+	indirect_buffer_memory_ = VK_NULL_HANDLE;
+	meshlet_buffer_ = VK_NULL_HANDLE;
+	meshlet_buffer_memory_ = VK_NULL_HANDLE;
+	meshlet_draw_buffer_ = VK_NULL_HANDLE;
+	meshlet_draw_buffer_memory_ = VK_NULL_HANDLE;
+	meshlet_cull_buffer_ = VK_NULL_HANDLE;
+	meshlet_cull_buffer_memory_ = VK_NULL_HANDLE;
+	meshlet_cull_shader_ = nullptr;
+	meshlet_cull_pipeline_ = nullptr;
+	cone_culling_enabled_ = true;
+	devices_ = nullptr;
 }
 
 Mesh::~Mesh()
@@ -23,6 +39,47 @@ Mesh::~Mesh()
 		delete shape;
 	}
 	mesh_shapes_.clear();
+
+	// clean up the indirect draw buffer
+	if (indirect_buffer_ != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(vk_device_handle_, indirect_buffer_, nullptr);
+		vkFreeMemory(vk_device_handle_, indirect_buffer_memory_, nullptr);
+		indirect_buffer_ = VK_NULL_HANDLE;
+		indirect_buffer_memory_ = VK_NULL_HANDLE;
+	}
+
+	// clean up the meshlet culling resources
+	if (meshlet_cull_pipeline_)
+	{
+		meshlet_cull_pipeline_->CleanUp();
+		delete meshlet_cull_pipeline_;
+		meshlet_cull_pipeline_ = nullptr;
+	}
+
+	if (meshlet_cull_shader_)
+	{
+		meshlet_cull_shader_->Cleanup();
+		delete meshlet_cull_shader_;
+		meshlet_cull_shader_ = nullptr;
+	}
+
+	VkBuffer meshlet_buffers[] = { meshlet_buffer_, meshlet_draw_buffer_, meshlet_cull_buffer_ };
+	VkDeviceMemory meshlet_buffer_memorys[] = { meshlet_buffer_memory_, meshlet_draw_buffer_memory_, meshlet_cull_buffer_memory_ };
+	for (int i = 0; i < 3; i++)
+	{
+		if (meshlet_buffers[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(vk_device_handle_, meshlet_buffers[i], nullptr);
+			vkFreeMemory(vk_device_handle_, meshlet_buffer_memorys[i], nullptr);
+		}
+	}
+	meshlet_buffer_ = VK_NULL_HANDLE;
+	meshlet_buffer_memory_ = VK_NULL_HANDLE;
+	meshlet_draw_buffer_ = VK_NULL_HANDLE;
+	meshlet_draw_buffer_memory_ = VK_NULL_HANDLE;
+	meshlet_cull_buffer_ = VK_NULL_HANDLE;
+	meshlet_cull_buffer_memory_ = VK_NULL_HANDLE;
 	
 	vk_device_handle_ = VK_NULL_HANDLE;
 }
@@ -32,10 +89,14 @@ void Mesh::UpdateWorldMatrix(glm::mat4 world_matrix)
 	world_matrix_ = world_matrix;
 }
 
-void Mesh::CreateModelMesh(VulkanDevices* devices, std::string filename)
+void Mesh::CreateModelMesh(VulkanDevices* devices, std::string filename, bool merge_shapes, bool build_meshlets)
 {
+	devices_ = devices;
 	vk_device_handle_ = devices->GetLogicalDevice();
 
+	// meshlets are drawn out of a single merged buffer
+	merged_ = merge_shapes || build_meshlets;
+
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
@@ -69,49 +130,226 @@ void Mesh::CreateModelMesh(VulkanDevices* devices, std::string filename)
 
 	}
 
-	// multithread shape loading
-	const int thread_count = 10;
-	std::thread shape_threads[thread_count];
+	// schedule the heaviest shapes first so a large shape never starts last
+	std::vector<size_t> shape_order(shapes.size());
+	std::iota(shape_order.begin(), shape_order.end(), 0);
+	std::sort(shape_order.begin(), shape_order.end(), [&shapes](size_t a, size_t b)
+	{
+		return shapes[a].mesh.indices.size() > shapes[b].mesh.indices.size();
+	});
 
-	// determine how many shapes are calculated per thread
-	const int shapes_per_thread = shapes.size() / thread_count;
-	int leftover_shapes = shapes.size() % thread_count;
+	// load the shapes on the job system, weighting each job by its index count
+	JobSystem* job_system = devices->GetJobSystem();
+	JobCounter shape_counter;
+	std::vector<ShapeLoadResult> shape_results(shapes.size());
 
-	// create mutex for sending shape data to the renderer
-	std::mutex shape_mutex;
+	for (size_t shape_index : shape_order)
+	{
+		const tinyobj::shape_t* shape = &shapes[shape_index];
+		if (shape->mesh.indices.empty())
+			continue;
 
-	int shape_index = 0;
+		ShapeLoadResult* result = &shape_results[shape_index];
+		bool create_shape = !merged_;
+		job_system->Submit([this, devices, &attrib, shape, result, create_shape, build_meshlets](uint32_t worker_index)
+		{
+			LoadShape(devices, &attrib, shape, result, create_shape, build_meshlets);
+		}, shape->mesh.indices.size(), &shape_counter);
+	}
 
-	// send the shapes to the threads
-	for (int thread_index = 0; thread_index < thread_count; thread_index++)
+	try
 	{
-		std::vector<tinyobj::shape_t*> thread_shapes;
-
-		
-		// determine the shapes that will be sent to this thread
-		for (int i = 0; i < shapes_per_thread; i++)
+		job_system->Wait(&shape_counter);
+	}
+	catch (...)
+	{
+		// release any shapes that did finish before passing the error on
+		for (ShapeLoadResult& result : shape_results)
 		{
-			thread_shapes.push_back(&shapes[shape_index]);
-			shape_index++;
+			if (result.shape)
+			{
+				result.shape->CleanUp();
+				delete result.shape;
+				result.shape = nullptr;
+			}
 		}
+		throw;
+	}
+
+	// merge the per shape bounds
+	for (ShapeLoadResult& result : shape_results)
+	{
+		if (result.indices.empty() && !result.shape)
+			continue;
+
+		min_vertex_ = glm::min(min_vertex_, result.min_vertex);
+		max_vertex_ = glm::max(max_vertex_, result.max_vertex);
+	}
+
+	if (merged_)
+	{
+		MergeShapes(devices, shape_results);
+		return;
+	}
+
+	// keep the shapes in file order
+	for (ShapeLoadResult& result : shape_results)
+	{
+		if (result.shape)
+			mesh_shapes_.push_back(result.shape);
+	}
+}
+
+void Mesh::MergeShapes(VulkanDevices* devices, std::vector<ShapeLoadResult>& shape_results)
+{
+	// count the merged geometry so it can be reserved up front
+	size_t total_vertex_count = 0;
+	size_t total_index_count = 0;
+	for (const ShapeLoadResult& result : shape_results)
+	{
+		total_vertex_count += result.vertices.size();
+		total_index_count += result.indices.size();
+	}
+
+	if (total_index_count == 0)
+		return;
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	vertices.reserve(total_vertex_count);
+	indices.reserve(total_index_count);
+
+	// append each shape and record its range, indices stay local to the shape and are rebased by vertexOffset
+	for (ShapeLoadResult& result : shape_results)
+	{
+		if (result.indices.empty())
+			continue;
 
-		// if there are still leftover shapes add one to this vector
-		if (leftover_shapes > 0)
+		// rebase the shape's meshlets into the merged buffers
+		for (MeshletData meshlet : result.meshlets)
 		{
-			thread_shapes.push_back(&shapes[shape_index]);
-			shape_index++;
-			leftover_shapes--;
+			meshlet.first_index += static_cast<uint32_t>(indices.size());
+			meshlet.vertex_offset = static_cast<int32_t>(vertices.size());
+			meshlets_.push_back(meshlet);
 		}
+		std::vector<MeshletData>().swap(result.meshlets);
+
+		VkDrawIndexedIndirectCommand draw_command = {};
+		draw_command.indexCount = static_cast<uint32_t>(result.indices.size());
+		draw_command.instanceCount = 1;
+		draw_command.firstIndex = static_cast<uint32_t>(indices.size());
+		draw_command.vertexOffset = static_cast<int32_t>(vertices.size());
+		draw_command.firstInstance = 0;
+		draw_commands_.push_back(draw_command);
+
+		vertices.insert(vertices.end(), result.vertices.begin(), result.vertices.end());
+		indices.insert(indices.end(), result.indices.begin(), result.indices.end());
+
+		// free the shape's copy now that it has been merged
+		std::vector<Vertex>().swap(result.vertices);
+		std::vector<uint32_t>().swap(result.indices);
+	}
+
+	// one shape owns the merged vertex and index buffers
+	Shape* merged_shape = new Shape();
+	merged_shape->InitShape(devices, vertices, indices);
+	mesh_shapes_.push_back(merged_shape);
 
-		// start the thread for this set of shapes
-		shape_threads[thread_index] = std::thread(&Mesh::LoadShapeThreaded, this, &shape_mutex, devices, &attrib, &materials, thread_shapes);
+	// meshlet meshes draw from the culled command buffer instead of the per shape ranges
+	if (!meshlets_.empty())
+	{
+		InitMeshletCulling(devices);
+		return;
 	}
 
-	for (int i = 0; i < thread_count; i++)
+	// build the indirect command array once, it never changes after load
+	VkDeviceSize indirect_buffer_size = sizeof(VkDrawIndexedIndirectCommand) * draw_commands_.size();
+	devices->CreateBuffer(indirect_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indirect_buffer_, indirect_buffer_memory_);
+	devices->UploadDataToBuffer(indirect_buffer_, draw_commands_.data(), indirect_buffer_size);
+}
+
+void Mesh::InitMeshletCulling(VulkanDevices* devices)
+{
+	// upload the meshlet bounds for the cull shader
+	VkDeviceSize meshlet_buffer_size = sizeof(MeshletData) * meshlets_.size();
+	devices->CreateBuffer(meshlet_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshlet_buffer_, meshlet_buffer_memory_);
+	devices->UploadDataToBuffer(meshlet_buffer_, meshlets_.data(), meshlet_buffer_size);
+
+	// one draw per meshlet, initially all visible so the mesh still draws if culling is never recorded
+	std::vector<VkDrawIndexedIndirectCommand> meshlet_draws(meshlets_.size());
+	for (size_t i = 0; i < meshlets_.size(); i++)
 	{
-		shape_threads[i].join();
+		meshlet_draws[i].indexCount = meshlets_[i].index_count;
+		meshlet_draws[i].instanceCount = 1;
+		meshlet_draws[i].firstIndex = meshlets_[i].first_index;
+		meshlet_draws[i].vertexOffset = meshlets_[i].vertex_offset;
+		meshlet_draws[i].firstInstance = 0;
 	}
 
+	VkDeviceSize draw_buffer_size = sizeof(VkDrawIndexedIndirectCommand) * meshlet_draws.size();
+	devices->CreateBuffer(draw_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshlet_draw_buffer_, meshlet_draw_buffer_memory_);
+	devices->UploadDataToBuffer(meshlet_draw_buffer_, meshlet_draws.data(), draw_buffer_size);
+
+	// create the cull data buffer
+	devices->CreateBuffer(sizeof(MeshletCullData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, meshlet_cull_buffer_, meshlet_cull_buffer_memory_);
+
+	// create the cull shader, compute shaders do not use the swap chain
+	meshlet_cull_shader_ = new VulkanComputeShader();
+	meshlet_cull_shader_->Init(devices, nullptr, "../res/shaders/meshlet_cull.comp.spv");
+
+	// create the cull pipeline
+	meshlet_cull_pipeline_ = new MeshletCullingPipeline();
+	meshlet_cull_pipeline_->SetShader(meshlet_cull_shader_);
+	meshlet_cull_pipeline_->SetMeshletCount(static_cast<uint32_t>(meshlets_.size()));
+	meshlet_cull_pipeline_->AddStorageBuffer(0, meshlet_buffer_, meshlet_buffer_size);
+	meshlet_cull_pipeline_->AddStorageBuffer(1, meshlet_draw_buffer_, draw_buffer_size);
+	meshlet_cull_pipeline_->AddUniformBuffer(2, meshlet_cull_buffer_, sizeof(MeshletCullData));
+	meshlet_cull_pipeline_->Init(devices);
+}
+
+void Mesh::UpdateMeshletCulling(Camera* camera)
+{
+	if (meshlets_.empty())
+		return;
+
+	MeshletCullData cull_data = {};
+	cull_data.world = world_matrix_;
+	camera->GetFrustumPlanes(cull_data.frustum_planes);
+	cull_data.camera_position = glm::vec4(camera->GetPosition(), 1.0f);
+	cull_data.meshlet_count = static_cast<uint32_t>(meshlets_.size());
+	cull_data.cone_culling = cone_culling_enabled_ ? 1 : 0;
+
+	// bounding radii scale with the largest axis of the world matrix
+	cull_data.world_scale = glm::max(glm::length(glm::vec3(world_matrix_[0])), glm::max(glm::length(glm::vec3(world_matrix_[1])), glm::length(glm::vec3(world_matrix_[2]))));
+
+	devices_->CopyDataToBuffer(meshlet_cull_buffer_memory_, &cull_data, sizeof(MeshletCullData));
+}
+
+void Mesh::RecordMeshletCullCommands(VkCommandBuffer& command_buffer)
+{
+	if (meshlets_.empty())
+		return;
+
+	// the previous frame's draws must finish reading the commands before they are rewritten
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = meshlet_draw_buffer_;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	meshlet_cull_pipeline_->RecordCommands(command_buffer);
+
+	// make the culled commands visible to the indirect draw
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 }
 
 void Mesh::CreateTerrainMesh(VulkanDevices* devices, int terrain_size)
@@ -259,100 +497,113 @@ void Mesh::CreateTessellatedTerrainMesh(VulkanDevices* devices, int terrain_size
 	mesh_shapes_.push_back(terrain_shape);
 }
 
-void Mesh::LoadShapeThreaded(std::mutex* shape_mutex, VulkanDevices* devices, tinyobj::attrib_t* attrib, std::vector<tinyobj::material_t>* materials, std::vector<tinyobj::shape_t*> shapes)
+void Mesh::LoadShape(VulkanDevices* devices, const tinyobj::attrib_t* attrib, const tinyobj::shape_t* shape, ShapeLoadResult* result, bool create_shape, bool build_meshlets)
 {
-	for (const auto& shape : shapes)
-	{
-		std::unordered_map<Vertex, uint32_t> unique_vertices = {};
-		std::vector<Vertex> vertices;
-		std::vector<uint32_t> indices;
+	std::unordered_map<Vertex, uint32_t> unique_vertices = {};
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
 
-		Shape* mesh_shape = new Shape();
+	// bounds local to this shape so jobs never touch shared state
+	glm::vec3 min_vertex = glm::vec3(1e9f, 1e9f, 1e9f);
+	glm::vec3 max_vertex = glm::vec3(-1e9f, -1e9f, -1e9f);
 
-		int face_index = 0;
+	for (const auto& index : shape->mesh.indices)
+	{
+		Vertex vertex = {};
 
-		for (const auto& index : shape->mesh.indices)
+		if (index.vertex_index >= 0)
+		{
+			vertex.pos = {
+				attrib->vertices[3 * index.vertex_index + 0],
+				attrib->vertices[3 * index.vertex_index + 2],
+				attrib->vertices[3 * index.vertex_index + 1]
+			};
+		}
+		else
 		{
-			Vertex vertex = {};
+			vertex.pos = { 0.0f, 0.0f, 0.0f };
+		}
 
-			if (index.vertex_index >= 0)
-			{
-				vertex.pos = {
-					attrib->vertices[3 * index.vertex_index + 0],
-					attrib->vertices[3 * index.vertex_index + 2],
-					attrib->vertices[3 * index.vertex_index + 1]
-				};
-			}
-			else
-			{
-				vertex.pos = { 0.0f, 0.0f, 0.0f };
-			}
+		if (index.texcoord_index >= 0)
+		{
+			vertex.tex_coord = {
+				attrib->texcoords[2 * index.texcoord_index + 0],
+				1.0f - attrib->texcoords[2 * index.texcoord_index + 1]
+			};
+		}
+		else
+		{
+			vertex.tex_coord = { 0.0f, 0.0f };
+		}
 
-			if (index.texcoord_index >= 0)
-			{
-				vertex.tex_coord = {
-					attrib->texcoords[2 * index.texcoord_index + 0],
-					1.0f - attrib->texcoords[2 * index.texcoord_index + 1]
-				};
-			}
-			else
-			{
-				vertex.tex_coord = { 0.0f, 0.0f };
-			}
+		if (index.normal_index >= 0)
+		{
+			vertex.normal = {
+				-attrib->normals[3 * index.normal_index + 0],
+				attrib->normals[3 * index.normal_index + 2],
+				attrib->normals[3 * index.normal_index + 1]
+			};
+		}
+		else
+		{
+			vertex.normal = glm::vec3(0.0f, 0.0f, 0.0f);
+		}
 
-			if (index.normal_index >= 0)
-			{
-				vertex.normal = {
-					-attrib->normals[3 * index.normal_index + 0],
-					attrib->normals[3 * index.normal_index + 2],
-					attrib->normals[3 * index.normal_index + 1]
-				};
-			}
-			else
-			{
-				vertex.normal = glm::vec3(0.0f, 0.0f, 0.0f);
-			}
+		// material index
+		vertex.mat_index = 0;
+		
+		if (unique_vertices.count(vertex) == 0)
+		{
+			unique_vertices[vertex] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(vertex);
 
-			// material index
-			vertex.mat_index = 0;
-			
-			if (unique_vertices.count(vertex) == 0)
-			{
-				unique_vertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-
-				// test to see if this vertex is outside the current bounds
-				if (vertex.pos.x < min_vertex_.x)
-					min_vertex_.x = vertex.pos.x;
-				else if (vertex.pos.x > max_vertex_.x)
-					max_vertex_.x = vertex.pos.x;
-
-				if (vertex.pos.y < min_vertex_.y)
-					min_vertex_.y = vertex.pos.y;
-				else if (vertex.pos.y > max_vertex_.y)
-					max_vertex_.y = vertex.pos.y;
-
-				if (vertex.pos.z < min_vertex_.z)
-					min_vertex_.z = vertex.pos.z;
-				else if (vertex.pos.z > max_vertex_.z)
-					max_vertex_.z = vertex.pos.z;
-			}
+			// test to see if this vertex is outside the current bounds
+			min_vertex = glm::min(min_vertex, vertex.pos);
+			max_vertex = glm::max(max_vertex, vertex.pos);
+		}
+
+		indices.push_back(unique_vertices[vertex]);
+	}
 
-			indices.push_back(unique_vertices[vertex]);
+	result->min_vertex = min_vertex;
+	result->max_vertex = max_vertex;
 
-			if (indices.size() % 3 == 0)
-				face_index++;
-		}
+	// split the shape into meshlets here so the build runs on the worker
+	if (build_meshlets)
+	{
+		std::vector<uint32_t> meshlet_indices;
+		meshlet_indices.reserve(indices.size());
+		MeshletBuilder::BuildMeshlets(vertices, indices, meshlet_indices, result->meshlets);
+		indices.swap(meshlet_indices);
+	}
 
-		std::unique_lock<std::mutex> shape_lock(*shape_mutex);
-		mesh_shape->InitShape(devices, vertices, indices);
-		mesh_shapes_.push_back(mesh_shape);
-		shape_lock.unlock();
+	// merged meshes upload once every shape has been loaded
+	if (!create_shape)
+	{
+		result->vertices.swap(vertices);
+		result->indices.swap(indices);
+		return;
 	}
+
+	// upload through this worker's own transfer context
+	Shape* mesh_shape = new Shape();
+	mesh_shape->InitShape(devices, vertices, indices);
+
+	result->shape = mesh_shape;
 }
 
 void Mesh::RecordRenderCommands(VkCommandBuffer& command_buffer)
 {
+	// merged meshes bind once and draw every range from the indirect buffer
+	if (merged_)
+	{
+		if (!mesh_shapes_.empty() && !meshlets_.empty())
+			mesh_shapes_[0]->RecordIndirectRenderCommands(command_buffer, meshlet_draw_buffer_, static_cast<uint32_t>(meshlets_.size()));
+		else if (!mesh_shapes_.empty())
+			mesh_shapes_[0]->RecordIndirectRenderCommands(command_buffer, indirect_buffer_, static_cast<uint32_t>(draw_commands_.size()));
+		return;
+	}
+
 	for (Shape* shape : mesh_shapes_)
 	{
 		shape->RecordRenderCommands(command_buffer);
@@ -365,4 +616,23 @@ void Mesh::RecordTerrainRenderCommands(VkCommandBuffer& command_buffer, int inst
 	{
 		shape->RecordTerrainRenderCommands(command_buffer, instance_index);
 	}
+}
+
+void Mesh::RecordTerrainInstancedRenderCommands(VkCommandBuffer& command_buffer, VkBuffer instance_buffer, VkBuffer indirect_buffer)
+{
+	for (Shape* shape : mesh_shapes_)
+	{
+		shape->RecordInstancedIndirectRenderCommands(command_buffer, instance_buffer, indirect_buffer);
+	}
+}
+
+uint32_t Mesh::GetIndexCount()
+{
+	uint32_t index_count = 0;
+	for (Shape* shape : mesh_shapes_)
+	{
+		index_count += shape->GetIndexCount();
+	}
+
+	return index_count;
 }
\ No newline at end of file
@@ -10,11 +10,15 @@
 #include <array>
 #include <string>
 #include <map>
-#include <mutex>
 #include <algorithm>
 
 #include "device.h"
 #include "shape.h"
+#include "meshlet.h"
+
+class Camera;
+class VulkanComputeShader;
+class MeshletCullingPipeline;
 
 using std::min;
 using std::max;
@@ -91,20 +95,48 @@ public:
 	Mesh();
 	~Mesh();
 	
-	void CreateModelMesh(VulkanDevices* devices, std::string filename);
+	void CreateModelMesh(VulkanDevices* devices, std::string filename, bool merge_shapes = false, bool build_meshlets = false);
 	void CreateTessellatedTerrainMesh(VulkanDevices* devices, int terrain_size);
 	void CreateTerrainMesh(VulkanDevices* devices, int terrain_size);
 
 	void UpdateWorldMatrix(glm::mat4 world_matrix);
 	
 	void RecordRenderCommands(VkCommandBuffer& command_buffer);
+
+	// meshlet culling, the cull commands must be recorded outside of a render pass before the draw
+	void UpdateMeshletCulling(Camera* camera);
+	void RecordMeshletCullCommands(VkCommandBuffer& command_buffer);
 	void RecordTerrainRenderCommands(VkCommandBuffer& command_buffer, int instance_index);
+	void RecordTerrainInstancedRenderCommands(VkCommandBuffer& command_buffer, VkBuffer instance_buffer, VkBuffer indirect_buffer);
 
 	inline glm::vec3 GetMinVertex() { return min_vertex_; }
 	inline glm::vec3 GetMaxVertex() { return max_vertex_;}
+	inline bool IsMerged() { return merged_; }
+	uint32_t GetIndexCount();
+	inline bool HasMeshlets() { return !meshlets_.empty(); }
+	inline void SetConeCullingEnabled(bool enabled) { cone_culling_enabled_ = enabled; }
 
 protected:
-	void LoadShapeThreaded(std::mutex* shape_mutex, VulkanDevices* devices, tinyobj::attrib_t* attrib, std::vector<tinyobj::material_t>* materials, std::vector<tinyobj::shape_t*> shapes);
+	// output of a single shape load job, bounds are reduced per job and merged once all jobs finish
+	struct ShapeLoadResult
+	{
+		ShapeLoadResult() : shape(nullptr) {}
+
+		Shape* shape;
+		glm::vec3 min_vertex;
+		glm::vec3 max_vertex;
+
+		// geometry is kept on the cpu when the shapes are merged after loading
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+
+		// meshlets index into this shape's indices, which are reordered to match
+		std::vector<MeshletData> meshlets;
+	};
+
+	void LoadShape(VulkanDevices* devices, const tinyobj::attrib_t* attrib, const tinyobj::shape_t* shape, ShapeLoadResult* result, bool create_shape, bool build_meshlets);
+	void MergeShapes(VulkanDevices* devices, std::vector<ShapeLoadResult>& shape_results);
+	void InitMeshletCulling(VulkanDevices* devices);
 
 protected:
 	VkDevice vk_device_handle_;
@@ -115,5 +147,25 @@ protected:
 	glm::vec3 max_vertex_;
 
 	std::vector<Shape*> mesh_shapes_;
+
+	// merged mode, a single shape holds every range and is drawn indirectly
+	bool merged_;
+	std::vector<VkDrawIndexedIndirectCommand> draw_commands_;
+	VkBuffer indirect_buffer_;
+	VkDeviceMemory indirect_buffer_memory_;
+
+	// meshlet mode, the merged shape is drawn one meshlet per indirect command and culled on the gpu
+	std::vector<MeshletData> meshlets_;
+	VkBuffer meshlet_buffer_;
+	VkDeviceMemory meshlet_buffer_memory_;
+	VkBuffer meshlet_draw_buffer_;
+	VkDeviceMemory meshlet_draw_buffer_memory_;
+	VkBuffer meshlet_cull_buffer_;
+	VkDeviceMemory meshlet_cull_buffer_memory_;
+	VulkanComputeShader* meshlet_cull_shader_;
+	MeshletCullingPipeline* meshlet_cull_pipeline_;
+	bool cone_culling_enabled_;
+
+	VulkanDevices* devices_;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "meshlet.h"
+#include "mesh.h"
+#include <climits>
+
+void MeshletBuilder::BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<uint32_t>& meshlet_indices, std::vector<MeshletData>& meshlets)
+{
+	const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+	if (triangle_count == 0)
+		return;
+
+	// build the vertex to triangle adjacency so meshlets grow through connected triangles
+	std::vector<uint32_t> adjacency_offsets(vertices.size() + 1, 0);
+	for (uint32_t index : indices)
+		adjacency_offsets[index + 1]++;
+
+	for (size_t i = 1; i < adjacency_offsets.size(); i++)
+		adjacency_offsets[i] += adjacency_offsets[i - 1];
+
+	std::vector<uint32_t> adjacency(triangle_count * 3);
+	std::vector<uint32_t> adjacency_fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	for (uint32_t triangle = 0; triangle < triangle_count; triangle++)
+	{
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			adjacency[adjacency_fill[vertex]++] = triangle;
+		}
+	}
+
+	std::vector<bool> triangle_used(triangle_count, false);
+
+	// id of the last meshlet each vertex was added to, used to count new vertices without a set
+	std::vector<uint32_t> vertex_meshlet(vertices.size(), UINT_MAX);
+
+	std::vector<uint32_t> meshlet_vertices;
+	std::vector<uint32_t> meshlet_triangles;
+	std::vector<uint32_t> candidates;
+
+	uint32_t next_seed = 0;
+	uint32_t meshlet_id = 0;
+
+	// counts the vertices a triangle would add to the current meshlet
+	auto new_vertex_count = [&](uint32_t triangle)
+	{
+		uint32_t count = 0;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			if (vertex_meshlet[indices[triangle * 3 + corner]] != meshlet_id)
+				count++;
+		}
+		return count;
+	};
+
+	// adds a triangle to the current meshlet and queues its neighbours as candidates
+	auto add_triangle = [&](uint32_t triangle)
+	{
+		triangle_used[triangle] = true;
+		meshlet_triangles.push_back(triangle);
+
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			if (vertex_meshlet[vertex] != meshlet_id)
+			{
+				vertex_meshlet[vertex] = meshlet_id;
+				meshlet_vertices.push_back(vertex);
+			}
+
+			for (uint32_t i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1]; i++)
+			{
+				if (!triangle_used[adjacency[i]])
+					candidates.push_back(adjacency[i]);
+			}
+		}
+	};
+
+	while (next_seed < triangle_count)
+	{
+		// seed each meshlet with the first unused triangle in file order
+		while (next_seed < triangle_count && triangle_used[next_seed])
+			next_seed++;
+
+		if (next_seed == triangle_count)
+			break;
+
+		meshlet_vertices.clear();
+		meshlet_triangles.clear();
+		candidates.clear();
+
+		add_triangle(next_seed);
+
+		while (meshlet_triangles.size() < MESHLET_MAX_TRIANGLES)
+		{
+			// pick the connected triangle that adds the fewest vertices
+			int best_candidate = -1;
+			uint32_t best_cost = 4;
+			for (size_t i = 0; i < candidates.size();)
+			{
+				uint32_t triangle = candidates[i];
+				if (triangle_used[triangle])
+				{
+					candidates[i] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+
+				uint32_t cost = new_vertex_count(triangle);
+				if (cost < best_cost && meshlet_vertices.size() + cost <= MESHLET_MAX_VERTICES)
+				{
+					best_candidate = static_cast<int>(triangle);
+					best_cost = cost;
+
+					if (cost == 0)
+						break;
+				}
+				i++;
+			}
+
+			// fall back to file order when the meshlet has no connected triangles left, which keeps unwelded meshes dense
+			if (best_candidate < 0)
+			{
+				while (next_seed < triangle_count && triangle_used[next_seed])
+					next_seed++;
+
+				if (next_seed == triangle_count || meshlet_vertices.size() + new_vertex_count(next_seed) > MESHLET_MAX_VERTICES)
+					break;
+
+				best_candidate = static_cast<int>(next_seed);
+			}
+
+			add_triangle(static_cast<uint32_t>(best_candidate));
+		}
+
+		// emit the meshlet's triangles contiguously so it can be drawn as a single index range
+		MeshletData meshlet = ComputeMeshletBounds(vertices, indices, meshlet_vertices, meshlet_triangles);
+		meshlet.first_index = static_cast<uint32_t>(meshlet_indices.size());
+		meshlet.index_count = static_cast<uint32_t>(meshlet_triangles.size() * 3);
+		meshlet.vertex_offset = 0;
+		meshlet.padding = 0;
+
+		for (uint32_t triangle : meshlet_triangles)
+		{
+			meshlet_indices.push_back(indices[triangle * 3 + 0]);
+			meshlet_indices.push_back(indices[triangle * 3 + 1]);
+			meshlet_indices.push_back(indices[triangle * 3 + 2]);
+		}
+
+		meshlets.push_back(meshlet);
+		meshlet_id++;
+	}
+}
+
+MeshletData MeshletBuilder::ComputeMeshletBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& meshlet_vertices, const std::vector<uint32_t>& meshlet_triangles)
+{
+	MeshletData meshlet = {};
+
+	// bounding sphere around the centre of the meshlet's bounding box
+	glm::vec3 min_pos = vertices[meshlet_vertices[0]].pos;
+	glm::vec3 max_pos = min_pos;
+	for (uint32_t vertex : meshlet_vertices)
+	{
+		min_pos = glm::min(min_pos, vertices[vertex].pos);
+		max_pos = glm::max(max_pos, vertices[vertex].pos);
+	}
+
+	glm::vec3 centre = (min_pos + max_pos) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t vertex : meshlet_vertices)
+	{
+		radius = glm::max(radius, glm::length(vertices[vertex].pos - centre));
+	}
+
+	meshlet.bounding_sphere = glm::vec4(centre, radius);
+
+	// face normals oriented to agree with the vertex normals so the cone does not depend on winding
+	std::vector<glm::vec3> face_normals;
+	face_normals.reserve(meshlet_triangles.size());
+
+	glm::vec3 axis = glm::vec3(0.0f);
+	for (uint32_t triangle : meshlet_triangles)
+	{
+		const Vertex& v0 = vertices[indices[triangle * 3 + 0]];
+		const Vertex& v1 = vertices[indices[triangle * 3 + 1]];
+		const Vertex& v2 = vertices[indices[triangle * 3 + 2]];
+
+		glm::vec3 normal = glm::cross(v1.pos - v0.pos, v2.pos - v0.pos);
+		float area = glm::length(normal);
+		if (area <= 1e-12f)
+		{
+			face_normals.push_back(glm::vec3(0.0f));
+			continue;
+		}
+
+		normal /= area;
+		if (glm::dot(normal, v0.normal + v1.normal + v2.normal) < 0.0f)
+			normal = -normal;
+
+		face_normals.push_back(normal);
+		axis += normal;
+	}
+
+	// disable the cone by default, it is only enabled when every face lies within it
+	meshlet.cone_apex = glm::vec4(centre, 0.0f);
+	meshlet.cone_axis = glm::vec4(0.0f, 0.0f, 1.0f, 2.0f);
+
+	float axis_length = glm::length(axis);
+	if (axis_length <= 1e-6f)
+		return meshlet;
+
+	axis /= axis_length;
+
+	float min_dot = 1.0f;
+	for (const glm::vec3& normal : face_normals)
+	{
+		if (normal != glm::vec3(0.0f))
+			min_dot = glm::min(min_dot, glm::dot(normal, axis));
+	}
+
+	// cones wider than ~84 degrees almost never cull anything
+	if (min_dot <= 0.1f)
+		return meshlet;
+
+	// move the apex back along the axis until every face plane lies in front of it
+	float max_t = 0.0f;
+	for (size_t i = 0; i < meshlet_triangles.size(); i++)
+	{
+		const glm::vec3& normal = face_normals[i];
+		if (normal == glm::vec3(0.0f))
+			continue;
+
+		const glm::vec3& p0 = vertices[indices[meshlet_triangles[i] * 3]].pos;
+		float t = glm::dot(centre - p0, normal) / glm::dot(axis, normal);
+		max_t = glm::max(max_t, t);
+	}
+
+	meshlet.cone_apex = glm::vec4(centre - axis * max_t, 0.0f);
+	meshlet.cone_axis = glm::vec4(axis, sqrtf(1.0f - min_dot * min_dot));
+
+	return meshlet;
+}
@@ -0,0 +1,34 @@
+#ifndef _MESHLET_H_
+#define _MESHLET_H_
+
+#include <glm/glm.hpp>
+#include <vector>
+
+struct Vertex;
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// gpu layout of a meshlet, must match the Meshlet struct in meshlet_cull.comp
+struct MeshletData
+{
+	glm::vec4 bounding_sphere;	// xyz centre, w radius
+	glm::vec4 cone_apex;		// xyz apex of the normal cone
+	glm::vec4 cone_axis;		// xyz axis, w cutoff, a cutoff above one disables cone culling
+	uint32_t first_index;
+	uint32_t index_count;
+	int32_t vertex_offset;
+	uint32_t padding;
+};
+
+class MeshletBuilder
+{
+public:
+	// splits an indexed triangle list into meshlets, writing the triangles back out in meshlet order
+	static void BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<uint32_t>& meshlet_indices, std::vector<MeshletData>& meshlets);
+
+protected:
+	static MeshletData ComputeMeshletBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& meshlet_vertices, const std::vector<uint32_t>& meshlet_triangles);
+};
+
+#endif
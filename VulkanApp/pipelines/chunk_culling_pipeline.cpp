@@ -0,0 +1,13 @@
+#include "chunk_culling_pipeline.h"
+
+void ChunkCullingPipeline::RecordCommands(VkCommandBuffer& command_buffer)
+{
+	// bind the pipeline
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+
+	// bind the descriptor sets
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &descriptor_set_, 0, nullptr);
+
+	// a single workgroup culls every chunk so the output can be compacted with a shared counter
+	vkCmdDispatch(command_buffer, 1, 1, 1);
+}
@@ -0,0 +1,40 @@
+#ifndef _CHUNK_CULLING_PIPELINE_H_
+#define _CHUNK_CULLING_PIPELINE_H_
+
+#include <glm\glm.hpp>
+
+#include "compute_pipeline.h"
+
+// must match MAX_CHUNKS in chunk_cull.comp
+const int CHUNK_CULL_MAX_CHUNKS = 64;
+
+struct ChunkCullData
+{
+	glm::mat4 previous_view_projection;
+	glm::vec4 frustum_planes[6];
+	glm::vec4 chunk_min[CHUNK_CULL_MAX_CHUNKS];
+	glm::vec4 chunk_max[CHUNK_CULL_MAX_CHUNKS];
+	uint32_t chunk_count;
+	uint32_t index_count;
+	uint32_t occlusion_enabled;
+	uint32_t hiz_mip_count;
+	glm::vec2 hiz_size;
+	glm::vec2 hiz_uv_scale;		// fraction of the depth buffer last frame was drawn into
+};
+
+// written by the cull pass each frame, read back to report how much each test removes
+struct ChunkCullStats
+{
+	uint32_t tested_count;
+	uint32_t frustum_culled_count;
+	uint32_t occlusion_culled_count;
+	uint32_t padding;
+};
+
+class ChunkCullingPipeline : public VulkanComputePipeline
+{
+public:
+	void RecordCommands(VkCommandBuffer& command_buffer);
+};
+
+#endif
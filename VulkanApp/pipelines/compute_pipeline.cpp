@@ -124,6 +124,18 @@ void VulkanComputePipeline::CreatePipeline()
 	pipeline_layout_info.pushConstantRangeCount = 0;
 	pipeline_layout_info.pPushConstantRanges = 0;
 
+	// add a push constant range if the pipeline has any
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	push_constant_range.offset = 0;
+	push_constant_range.size = static_cast<uint32_t>(push_constants_.size());
+
+	if (!push_constants_.empty())
+	{
+		pipeline_layout_info.pushConstantRangeCount = 1;
+		pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+	}
+
 	// create the pipeline layout
 	if (vkCreatePipelineLayout(devices_->GetLogicalDevice(), &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS)
 	{
@@ -145,6 +157,20 @@ void VulkanComputePipeline::CreatePipeline()
 	}
 }
 
+void VulkanComputePipeline::RecordPushConstants(VkCommandBuffer& command_buffer)
+{
+	if (push_constants_.empty())
+		return;
+
+	vkCmdPushConstants(command_buffer, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, static_cast<uint32_t>(push_constants_.size()), push_constants_.data());
+}
+
+void VulkanComputePipeline::SetPushConstants(const void* data, uint32_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	push_constants_.assign(bytes, bytes + size);
+}
+
 void VulkanComputePipeline::AddTexture(uint32_t binding_location, Texture* texture)
 {
 	Descriptor texture_descriptor = {};
@@ -166,13 +192,13 @@ void VulkanComputePipeline::AddTexture(uint32_t binding_location, Texture* textu
 	descriptor_infos_.push_back(texture_descriptor);
 }
 
-void VulkanComputePipeline::AddTexture(uint32_t binding_location, VkImageView image)
+void VulkanComputePipeline::AddTexture(uint32_t binding_location, VkImageView image, VkImageLayout image_layout)
 {
 	Descriptor texture_descriptor = {};
 
 	// setup image info
 	VkDescriptorImageInfo image_info = {};
-	image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	image_info.imageLayout = image_layout;
 	image_info.imageView = image;
 	image_info.sampler = nullptr;
 	texture_descriptor.image_infos.push_back(image_info);
@@ -278,14 +304,14 @@ void VulkanComputePipeline::AddUniformBuffer(uint32_t binding_location, VkBuffer
 	descriptor_infos_.push_back(buffer_descriptor);
 }
 
-void VulkanComputePipeline::AddStorageBuffer(uint32_t binding_location, VkBuffer buffer, VkDeviceSize buffer_size)
+void VulkanComputePipeline::AddStorageBuffer(uint32_t binding_location, VkBuffer buffer, VkDeviceSize buffer_size, VkDeviceSize buffer_offset)
 {
 	Descriptor buffer_descriptor = {};
 
 	// setup buffer info
 	VkDescriptorBufferInfo buffer_info = {};
 	buffer_info.buffer = buffer;
-	buffer_info.offset = 0;
+	buffer_info.offset = buffer_offset;
 	buffer_info.range = buffer_size;
 	buffer_descriptor.buffer_infos.push_back(buffer_info);
 
@@ -22,20 +22,24 @@ public:
 	inline void SetShader(VulkanComputeShader* shader) { shader_ = shader; }
 
 	void AddTexture(uint32_t binding_location, Texture* texture);
-	void AddTexture(uint32_t binding_location, VkImageView image);
+	void AddTexture(uint32_t binding_location, VkImageView image, VkImageLayout image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	void AddTextureArray(uint32_t binding_location, std::vector<Texture*>& textures);
 	void AddTextureArray(uint32_t binding_location, std::vector<VkImageView>& textures);
 	void AddSampler(uint32_t binding_location, VkSampler sampler);
 	void AddUniformBuffer(uint32_t binding_location, VkBuffer buffer, VkDeviceSize buffer_size);
-	void AddStorageBuffer(uint32_t binding_location, VkBuffer buffer, VkDeviceSize buffer_size);
+	void AddStorageBuffer(uint32_t binding_location, VkBuffer buffer, VkDeviceSize buffer_size, VkDeviceSize buffer_offset = 0);
 	void AddStorageImage(uint32_t binding_location, VkImageView image);
 	void AddStorageImageArray(uint32_t binding_location, std::vector<VkImageView>& images);
 
+	// stored with the pipeline and recorded with its dispatch, so pipelines sharing a shader can differ without a uniform buffer
+	void SetPushConstants(const void* data, uint32_t size);
+
 	virtual void RecordCommands(VkCommandBuffer& command_buffer) = 0;
 
 protected:
 	void CreateDescriptorSet();
 	virtual void CreatePipeline();
+	void RecordPushConstants(VkCommandBuffer& command_buffer);
 
 protected:
 	VulkanDevices* devices_;
@@ -49,5 +53,6 @@ protected:
 	VkDescriptorSetLayout descriptor_set_layout_;
 	VkDescriptorSet descriptor_set_;
 	std::vector<Descriptor> descriptor_infos_;	// info used in the creation of the pipeline
+	std::vector<char> push_constants_;
 };
 #endif
\ No newline at end of file
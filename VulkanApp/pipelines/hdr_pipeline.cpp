@@ -0,0 +1,24 @@
+#include "hdr_pipeline.h"
+
+HDRPipeline::HDRPipeline()
+{
+	output_width_ = 0;
+	output_height_ = 0;
+	workgroup_width_ = HDR_WORKGROUP_SIZE;
+	workgroup_height_ = HDR_WORKGROUP_SIZE;
+}
+
+void HDRPipeline::RecordCommands(VkCommandBuffer& command_buffer)
+{
+	// bind the pipeline
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+
+	// bind the descriptor sets
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &descriptor_set_, 0, nullptr);
+
+	RecordPushConstants(command_buffer);
+
+	uint32_t group_count_x = (output_width_ + workgroup_width_ - 1) / workgroup_width_;
+	uint32_t group_count_y = (output_height_ + workgroup_height_ - 1) / workgroup_height_;
+	vkCmdDispatch(command_buffer, group_count_x, group_count_y, 1);
+}
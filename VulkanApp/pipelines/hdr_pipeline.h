@@ -0,0 +1,33 @@
+#ifndef _HDR_PIPELINE_H_
+#define _HDR_PIPELINE_H_
+
+#include "compute_pipeline.h"
+
+// must match WORKGROUP_SIZE in ldr_suppress.comp, gaussian_blur.comp and tonemap.comp
+const int HDR_WORKGROUP_SIZE = 16;
+
+// must match TILE_SIZE in gaussian_blur_shared.comp
+const int BLUR_TILE_SIZE = 128;
+
+// one stage of the compute hdr chain, each invocation writes a single texel of the stage's output image
+class HDRPipeline : public VulkanComputePipeline
+{
+public:
+	HDRPipeline();
+
+	void RecordCommands(VkCommandBuffer& command_buffer);
+
+	// defaults to square HDR_WORKGROUP_SIZE workgroups
+	inline void SetWorkgroupSize(uint32_t width, uint32_t height) { workgroup_width_ = width; workgroup_height_ = height; }
+
+	// sets the size of the image being written, the dispatch covers it with whole workgroups
+	inline void SetOutputSize(uint32_t width, uint32_t height) { output_width_ = width; output_height_ = height; }
+
+protected:
+	uint32_t output_width_;
+	uint32_t output_height_;
+	uint32_t workgroup_width_;
+	uint32_t workgroup_height_;
+};
+
+#endif
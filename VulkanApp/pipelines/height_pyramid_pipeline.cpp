@@ -0,0 +1,29 @@
+#include "height_pyramid_pipeline.h"
+
+void HeightPyramidPipeline::RecordCommands(VkCommandBuffer& command_buffer)
+{
+	// bind the pipeline
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+
+	// bind the descriptor sets
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &descriptor_set_, 0, nullptr);
+
+	vkCmdDispatch(command_buffer, workgroup_count_x_, workgroup_count_y_, 1);
+}
+
+uint32_t HeightPyramidPipeline::GetLevelOffset(int level)
+{
+	uint32_t offset = 0;
+	for (int i = 0; i < level; i++)
+	{
+		uint32_t size = GetLevelSize(i);
+		offset += size * size;
+	}
+
+	return offset;
+}
+
+uint32_t HeightPyramidPipeline::GetLevelSize(int level)
+{
+	return HEIGHT_PYRAMID_BASE_SIZE >> level;
+}
@@ -0,0 +1,38 @@
+#ifndef _HEIGHT_PYRAMID_PIPELINE_H_
+#define _HEIGHT_PYRAMID_PIPELINE_H_
+
+#include <glm\glm.hpp>
+
+#include "compute_pipeline.h"
+
+// level zero holds one tile per 32x32 texels, each level above halves the resolution down to a single tile
+const int HEIGHT_PYRAMID_BASE_SIZE = 32;
+const int HEIGHT_PYRAMID_LEVEL_COUNT = 6;
+const int HEIGHT_PYRAMID_TILE_COUNT = 1365;
+
+// matches the tiles in height_pyramid_reduce.comp and height_pyramid_levels.comp
+struct HeightPyramidTile
+{
+	float min_height;
+	float max_height;
+	float mean_height;
+	float mean_square_height;
+};
+
+// runs either pyramid pass, the reduce pass dispatches one workgroup per level zero tile and the levels pass a single workgroup
+class HeightPyramidPipeline : public VulkanComputePipeline
+{
+public:
+	void RecordCommands(VkCommandBuffer& command_buffer);
+
+	inline void SetWorkgroupCount(uint32_t x, uint32_t y) { workgroup_count_x_ = x; workgroup_count_y_ = y; }
+
+	static uint32_t GetLevelOffset(int level);
+	static uint32_t GetLevelSize(int level);
+
+protected:
+	uint32_t workgroup_count_x_;
+	uint32_t workgroup_count_y_;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#include "hiz_pipeline.h"
+
+void HiZPipeline::RecordCommands(VkCommandBuffer& command_buffer)
+{
+	// bind the pipeline
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+
+	// bind the descriptor sets
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &descriptor_set_, 0, nullptr);
+
+	uint32_t group_count_x = (output_width_ + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE;
+	uint32_t group_count_y = (output_height_ + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE;
+	vkCmdDispatch(command_buffer, group_count_x, group_count_y, 1);
+}
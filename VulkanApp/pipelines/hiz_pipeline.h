@@ -0,0 +1,23 @@
+#ifndef _HIZ_PIPELINE_H_
+#define _HIZ_PIPELINE_H_
+
+#include "compute_pipeline.h"
+
+// must match WORKGROUP_SIZE in hiz_depth_reduce.comp and hiz_downsample.comp
+const int HIZ_WORKGROUP_SIZE = 16;
+
+// builds one level of the hierarchical depth buffer, either from the depth buffer or from the level below
+class HiZPipeline : public VulkanComputePipeline
+{
+public:
+	void RecordCommands(VkCommandBuffer& command_buffer);
+
+	// sets the size of the level being written, the dispatch covers it with whole workgroups
+	inline void SetOutputSize(uint32_t width, uint32_t height) { output_width_ = width; output_height_ = height; }
+
+protected:
+	uint32_t output_width_;
+	uint32_t output_height_;
+};
+
+#endif
@@ -1,172 +0,0 @@
-#include "ldr_suppress_pipeline.h"
-#include <array>
-
-void LDRSuppressPipeline::RecordCommands(VkCommandBuffer& command_buffer, uint32_t buffer_index)
-{
-	VkRenderPassBeginInfo render_pass_info = {};
-	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	render_pass_info.renderPass = render_pass_;
-	render_pass_info.framebuffer = framebuffers_[0];
-	render_pass_info.renderArea.offset = { 0, 0 };
-	render_pass_info.renderArea.extent = { output_width_, output_height_ };
-	render_pass_info.clearValueCount = 0;
-	render_pass_info.pClearValues = nullptr;
-
-	// create pipleine commands
-	vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
-
-	// set the dynamic viewport data
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)output_width_;
-	viewport.height = (float)output_height_;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(command_buffer, 0, 1, &viewport);
-
-	// set the dynamic scissor data
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swap_chain_->GetSwapChainExtent();
-	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
-
-	// bind the descriptor set to the pipeline
-	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, &descriptor_set_, 0, nullptr);
-
-	// draw the full screen quad
-	vkCmdDraw(command_buffer, 6, 1, 0, 0);
-}
-
-
-void LDRSuppressPipeline::CreatePipeline()
-{
-	// setup pipeline layout creation info
-	VkPipelineLayoutCreateInfo pipeline_layout_info = {};
-	pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipeline_layout_info.setLayoutCount = 1;
-	pipeline_layout_info.pSetLayouts = &descriptor_set_layout_;
-	pipeline_layout_info.pushConstantRangeCount = 0;
-	pipeline_layout_info.pPushConstantRanges = 0;
-
-	// create the pipeline layout
-	if (vkCreatePipelineLayout(devices_->GetLogicalDevice(), &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create pipeline layout!");
-	}
-
-	VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
-	vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertex_input_info.vertexBindingDescriptionCount = 0;
-	vertex_input_info.pVertexBindingDescriptions = nullptr;
-	vertex_input_info.vertexAttributeDescriptionCount = 0;
-	vertex_input_info.pVertexAttributeDescriptions = nullptr;
-
-	// setup pipeline creation info
-	VkGraphicsPipelineCreateInfo pipeline_info = {};
-	pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipeline_info.stageCount = shader_->GetShaderStageCount();
-	pipeline_info.pStages = shader_->GetShaderStageInfo().data();
-	pipeline_info.pVertexInputState = &vertex_input_info;
-	pipeline_info.pInputAssemblyState = &shader_->GetInputAssemblyDescription();
-	pipeline_info.pViewportState = &shader_->GetViewportStateDescription();
-	pipeline_info.pRasterizationState = &shader_->GetRasterizerStateDescription();
-	pipeline_info.pMultisampleState = &shader_->GetMultisampleStateDescription();
-	pipeline_info.pDepthStencilState = nullptr;
-	pipeline_info.pColorBlendState = &shader_->GetBlendStateDescription();
-	pipeline_info.pDynamicState = &shader_->GetDynamicStateDescription();
-	pipeline_info.layout = pipeline_layout_;
-	pipeline_info.renderPass = render_pass_;
-	pipeline_info.subpass = 0;
-	pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
-	pipeline_info.basePipelineIndex = -1;
-	pipeline_info.flags = 0;
-
-	if (vkCreateGraphicsPipelines(devices_->GetLogicalDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline_) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create deferred pipeline!");
-	}
-}
-
-
-void LDRSuppressPipeline::CreateFramebuffers()
-{
-	framebuffers_.resize(1);
-
-	std::array<VkImageView, 1> attachments = { output_image_view_ };
-
-	VkFramebufferCreateInfo framebuffer_info = {};
-	framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-	framebuffer_info.renderPass = render_pass_;
-	framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
-	framebuffer_info.pAttachments = attachments.data();
-	framebuffer_info.width = output_width_;
-	framebuffer_info.height = output_height_;
-	framebuffer_info.layers = 1;
-
-	if (vkCreateFramebuffer(devices_->GetLogicalDevice(), &framebuffer_info, nullptr, &framebuffers_[0]) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create framebuffer!");
-	}
-}
-
-void LDRSuppressPipeline::CreateRenderPass()
-{
-	// setup the color buffer attachment
-	VkAttachmentDescription color_attachment = {};
-	color_attachment.format = output_image_format_;
-	color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	color_attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// setup the subpass attachment description
-	VkAttachmentReference color_attachment_ref = {};
-	color_attachment_ref.attachment = 0;
-	color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// setup the subpass description
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &color_attachment_ref;
-	subpass.pDepthStencilAttachment = nullptr;
-
-	// setup the render pass dependancy description
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	// setup the render pass description
-	std::array<VkAttachmentDescription, 1> attachments = { color_attachment };
-
-	VkRenderPassCreateInfo render_pass_info = {};
-	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
-	render_pass_info.pAttachments = attachments.data();
-	render_pass_info.subpassCount = 1;
-	render_pass_info.pSubpasses = &subpass;
-	render_pass_info.dependencyCount = 1;
-	render_pass_info.pDependencies = &dependency;
-
-	if (vkCreateRenderPass(devices_->GetLogicalDevice(), &render_pass_info, nullptr, &render_pass_) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create render pass!");
-	}
-}
-
-void LDRSuppressPipeline::SetOutputImage(VkImageView output_image_view, VkFormat output_image_format, uint32_t output_width, uint32_t output_height)
-{
-	output_image_view_ = output_image_view;
-	output_image_format_ = output_image_format;
-	output_width_ = output_width;
-	output_height_ = output_height;
-}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#include "meshlet_culling_pipeline.h"
+
+void MeshletCullingPipeline::RecordCommands(VkCommandBuffer& command_buffer)
+{
+	// bind the pipeline
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+
+	// bind the descriptor sets
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &descriptor_set_, 0, nullptr);
+
+	// one invocation per meshlet
+	uint32_t workgroup_count = meshlet_count_ / MESHLET_CULL_WORKGROUP_SIZE;
+	if (meshlet_count_ % MESHLET_CULL_WORKGROUP_SIZE > 0)
+		workgroup_count++;
+
+	vkCmdDispatch(command_buffer, workgroup_count, 1, 1);
+}
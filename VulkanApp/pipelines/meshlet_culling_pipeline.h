@@ -0,0 +1,32 @@
+#ifndef _MESHLET_CULLING_PIPELINE_H_
+#define _MESHLET_CULLING_PIPELINE_H_
+
+#include <glm\glm.hpp>
+
+#include "compute_pipeline.h"
+
+#define MESHLET_CULL_WORKGROUP_SIZE 64
+
+struct MeshletCullData
+{
+	glm::mat4 world;
+	glm::vec4 frustum_planes[6];
+	glm::vec4 camera_position;
+	uint32_t meshlet_count;
+	uint32_t cone_culling;
+	float world_scale;
+	float padding;
+};
+
+class MeshletCullingPipeline : public VulkanComputePipeline
+{
+public:
+	void RecordCommands(VkCommandBuffer& command_buffer);
+
+	inline void SetMeshletCount(uint32_t meshlet_count) { meshlet_count_ = meshlet_count; }
+
+protected:
+	uint32_t meshlet_count_;
+};
+
+#endif
@@ -302,6 +302,53 @@ void VulkanPipeline::AddTexture(VkShaderStageFlags stage_flags, uint32_t binding
 	descriptor_infos_.push_back(texture_descriptor);
 }
 
+void VulkanPipeline::AddTexture(VkShaderStageFlags stage_flags, uint32_t binding_location, TextureArray* texture_array)
+{
+	Descriptor texture_descriptor = {};
+
+	// setup image info, every layer is sampled through the array's one sampler
+	VkDescriptorImageInfo image_info = {};
+	image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	image_info.imageView = texture_array->GetImageView();
+	image_info.sampler = texture_array->GetSampler();
+	texture_descriptor.image_infos.push_back(image_info);
+
+	// setup descriptor layout info
+	texture_descriptor.layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	texture_descriptor.layout_binding.descriptorCount = 1;
+	texture_descriptor.layout_binding.binding = binding_location;
+	texture_descriptor.layout_binding.stageFlags = stage_flags;
+	texture_descriptor.layout_binding.pImmutableSamplers = nullptr;
+
+	descriptor_infos_.push_back(texture_descriptor);
+}
+
+void VulkanPipeline::UpdateTexture(uint32_t binding_location, Texture* texture)
+{
+	for (Descriptor& descriptor : descriptor_infos_)
+	{
+		if (descriptor.layout_binding.binding != binding_location)
+			continue;
+
+		descriptor.image_infos[0].imageView = texture->GetImageView();
+		descriptor.image_infos[0].sampler = texture->GetSampler();
+
+		VkWriteDescriptorSet descriptor_write = {};
+		descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptor_write.dstSet = descriptor_set_;
+		descriptor_write.dstBinding = binding_location;
+		descriptor_write.dstArrayElement = 0;
+		descriptor_write.descriptorType = descriptor.layout_binding.descriptorType;
+		descriptor_write.descriptorCount = 1;
+		descriptor_write.pImageInfo = descriptor.image_infos.data();
+
+		vkUpdateDescriptorSets(devices_->GetLogicalDevice(), 1, &descriptor_write, 0, nullptr);
+		return;
+	}
+
+	throw std::runtime_error("failed to find pipeline texture binding!");
+}
+
 void VulkanPipeline::AddTexture(VkShaderStageFlags stage_flags, uint32_t binding_location, VkImageView image)
 {
 	Descriptor texture_descriptor = {};
@@ -480,26 +527,36 @@ void VulkanPipeline::AddStorageImageArray(VkShaderStageFlags stage_flags, uint32
 }
 
 void VulkanPipeline::RecordCommands(VkCommandBuffer& command_buffer, uint32_t buffer_index)
+{
+	// create pipleine commands
+	BeginRenderPass(command_buffer, buffer_index, VK_SUBPASS_CONTENTS_INLINE);
+	RecordBindCommands(command_buffer);
+}
+
+void VulkanPipeline::BeginRenderPass(VkCommandBuffer& command_buffer, uint32_t buffer_index, VkSubpassContents contents)
 {
 	VkRenderPassBeginInfo render_pass_info = {};
 	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	render_pass_info.renderPass = render_pass_;
 	render_pass_info.framebuffer = framebuffers_[buffer_index];
 	render_pass_info.renderArea.offset = { 0, 0 };
-	render_pass_info.renderArea.extent = swap_chain_->GetSwapChainExtent();
+	render_pass_info.renderArea.extent = swap_chain_->GetRenderExtent();
 	render_pass_info.clearValueCount = 0;
 	render_pass_info.pClearValues = nullptr;
-	
-	// create pipleine commands
-	vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+	vkCmdBeginRenderPass(command_buffer, &render_pass_info, contents);
+}
+
+void VulkanPipeline::RecordBindCommands(VkCommandBuffer& command_buffer)
+{
 	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
 	
-	// set the dynamic viewport data
+	// set the dynamic viewport data, the scene only covers the render extent of the intermediate image
 	VkViewport viewport = {};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = (float)(swap_chain_->GetSwapChainExtent().width);
-	viewport.height = (float)(swap_chain_->GetSwapChainExtent().height);
+	viewport.width = (float)(swap_chain_->GetRenderExtent().width);
+	viewport.height = (float)(swap_chain_->GetRenderExtent().height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(command_buffer, 0, 1, &viewport);
@@ -507,9 +564,9 @@ void VulkanPipeline::RecordCommands(VkCommandBuffer& command_buffer, uint32_t bu
 	// set the dynamic scissor data
 	VkRect2D scissor = {};
 	scissor.offset = { 0, 0 };
-	scissor.extent = swap_chain_->GetSwapChainExtent();
+	scissor.extent = swap_chain_->GetRenderExtent();
 	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
 	// bind the descriptor set to the pipeline
 	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, &descriptor_set_, 0, nullptr);
-}
\ No newline at end of file
+}
@@ -4,6 +4,7 @@
 #include "../device.h"
 #include "../swap_chain.h"
 #include "../texture.h"
+#include "../texture_array.h"
 #include "../shader.h"
 
 class VulkanPipeline
@@ -27,6 +28,7 @@ public:
 
 	void AddTexture(VkShaderStageFlags stage_flags, uint32_t binding_location, Texture* texture);
 	void AddTexture(VkShaderStageFlags stage_flags, uint32_t binding_location, VkImageView image);
+	void AddTexture(VkShaderStageFlags stage_flags, uint32_t binding_location, TextureArray* texture_array);
 	void AddTextureArray(VkShaderStageFlags stage_flags, uint32_t binding_location, std::vector<Texture*>& textures);
 	void AddTextureArray(VkShaderStageFlags stage_flags, uint32_t binding_location, std::vector<VkImageView>& textures);
 	void AddSampler(VkShaderStageFlags stage_flags, uint32_t binding_location, VkSampler sampler);
@@ -34,8 +36,18 @@ public:
 	void AddStorageBuffer(VkShaderStageFlags stage_flags, uint32_t binding_location, VkBuffer buffer, VkDeviceSize buffer_size);
 	void AddStorageImage(VkShaderStageFlags stage_flags, uint32_t binding_location, VkImageView image);
 	void AddStorageImageArray(VkShaderStageFlags stage_flags, uint32_t binding_location, std::vector<VkImageView>& images);
+
+	// rewrites a texture bound by AddTexture after Init, the descriptor set must not be in use by any pending command buffer
+	void UpdateTexture(uint32_t binding_location, Texture* texture);
 	virtual void RecordCommands(VkCommandBuffer& command_buffer, uint32_t buffer_index);
 
+	// split recording for passes whose draws are recorded into secondary command buffers
+	void BeginRenderPass(VkCommandBuffer& command_buffer, uint32_t buffer_index, VkSubpassContents contents);
+	void RecordBindCommands(VkCommandBuffer& command_buffer);
+
+	inline VkRenderPass GetRenderPass() { return render_pass_; }
+	inline VkFramebuffer GetFramebuffer(uint32_t buffer_index) { return framebuffers_[buffer_index]; }
+
 protected:
 
 	void CreateDescriptorSet();
@@ -0,0 +1,14 @@
+#ifndef _TERRAIN_DEPTH_PIPELINE_H_
+#define _TERRAIN_DEPTH_PIPELINE_H_
+
+#include "terrain_rendering_pipeline.h"
+
+// depth only terrain pass, lays down the nearest terrain depth so the shaded pass only runs once per pixel
+class TerrainDepthPipeline : public TerrainRenderingPipeline
+{
+protected:
+	void CreateFramebuffers();
+	void CreateRenderPass();
+};
+
+#endif
@@ -120,7 +120,7 @@ void TerrainRenderingPipeline::CreateRenderPass()
 	color_attachment_ref.attachment = 0;
 	color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-	// setup the depth buffer attachment
+	// setup the depth buffer attachment, loaded so the depth pre-pass results are kept
 	VkAttachmentDescription depth_attachment = {};
 	depth_attachment.format = swap_chain_->FindDepthFormat();
 	depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -128,7 +128,7 @@ void TerrainRenderingPipeline::CreateRenderPass()
 	depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depth_attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 	depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	// setup the subpass attachment description
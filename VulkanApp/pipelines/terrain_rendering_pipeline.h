@@ -7,7 +7,7 @@
 struct TerrainRenderData
 {
 	float terrain_size;
-	glm::vec3 camera_pos;
+	glm::vec3 padding;
 	glm::vec4 water_size;
 };
 
@@ -22,8 +22,7 @@ struct FogFactors
 {
 	float extinction_factor;
 	float in_scattering_factor;
-	float camera_height;
-	float padding;
+	float padding[2];
 };
 
 class TerrainRenderingPipeline : public VulkanPipeline
@@ -4,13 +4,6 @@
 #include "pipeline.h"
 #include <glm/glm.hpp>
 
-struct WaterMatrixData
-{
-	glm::mat4 world;
-	glm::mat4 view;
-	glm::mat4 proj;
-};
-
 struct WaterRenderData
 {
 	glm::vec3 camera_pos;
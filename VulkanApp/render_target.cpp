@@ -1,6 +1,6 @@
 #include "render_target.h"
 
-void VulkanRenderTarget::Init(VulkanDevices* devices, VkFormat format, uint32_t width, uint32_t height, uint32_t count, bool depth_enabled)
+void VulkanRenderTarget::Init(VulkanDevices* devices, VkFormat format, uint32_t width, uint32_t height, uint32_t count, bool depth_enabled, VkImageUsageFlags additional_usage)
 {
 	devices_ = devices;
 
@@ -12,7 +12,7 @@ void VulkanRenderTarget::Init(VulkanDevices* devices, VkFormat format, uint32_t
 	// create render targets
 	for (int i = 0; i < count; i++)
 	{
-		devices->CreateImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, render_target_images_[i], render_target_image_memories_[i]);
+		devices->CreateImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | additional_usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, render_target_images_[i], render_target_image_memories_[i]);
 		render_target_image_views_[i] = devices->CreateImageView(render_target_images_[i], format, VK_IMAGE_ASPECT_COLOR_BIT);
 		devices->TransitionImageLayout(render_target_images_[i], format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	}
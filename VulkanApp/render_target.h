@@ -9,7 +9,8 @@
 class VulkanRenderTarget
 {
 public:
-	void Init(VulkanDevices* devices, VkFormat format, uint32_t width, uint32_t height, uint32_t count, bool depth_enabled);
+	// additional usage is added to the color targets, e.g. storage for targets written by compute passes
+	void Init(VulkanDevices* devices, VkFormat format, uint32_t width, uint32_t height, uint32_t count, bool depth_enabled, VkImageUsageFlags additional_usage = 0);
 	void Cleanup();
 	
 	void ClearImage(VkClearColorValue clear_color = { 0.0f, 0.0f, 0.0f, 0.0f }, int image_index = -1);
@@ -1,12 +1,74 @@
 #include "renderer.h"
 #include <array>
 #include <map>
+#include <iostream>
+#include <cstring>
+#include <cstddef>
+
+// cull the terrain chunks in a compute pass, comment out to run the frustum tests on the cpu instead
+#define TERRAIN_GPU_CULLING
+
+// average the gpu cull pass's frustum and occlusion rejections over a few hundred frames and print them
+//#define TERRAIN_CULL_STATS
+
+// record the scene passes every frame on the job system, comment out to reuse the command buffers recorded at init
+#define PER_FRAME_RECORDING
+
+// draw the terrain depth first so the shaded terrain pass only runs once per pixel, comment out to shade in a single pass
+#define TERRAIN_DEPTH_PREPASS
+
+// count the fragments the shaded terrain pass runs with a pipeline statistics query and print them per pixel
+// the pass is timed alongside, its time per fragment shows how well the terrain textures' samples hit the texture cache
+//#define TERRAIN_OVERDRAW_STATS
+
+// average the bytes written to the gpu from the host over a few hundred frames and print them
+//#define UPLOAD_STATS
+
+// scale the scene resolution with its gpu time to hold the frame budget, needs per frame recording
+//#define DYNAMIC_RESOLUTION
+
+// decode and upload the terrain textures on the job system while the first frames draw the default texture, comment out to load them before the first frame
+#define ASYNC_TEXTURE_LOADING
+
+// pack the terrain materials into the layers of one array image sampled through a single descriptor, the layers are loaded before the first frame
+//#define TERRAIN_MATERIAL_ARRAY
+
+// time the cpu area downscale used for oversized textures on the job system and print its throughput per core before loading
+//#define TEXTURE_DOWNSCALE_BENCHMARK
+
+// the chunk cull shader handles a fixed number of chunks
+static_assert(TERRAIN_CHUNK_COUNT <= CHUNK_CULL_MAX_CHUNKS, "too many terrain chunks for chunk_cull.comp");
+
+// a camera that jumps or turns further than this in one frame is treated as a cut, last frame's depth no longer describes the view
+static const float HIZ_CUT_DISTANCE = TERRAIN_SIZE / 8.0f;
+static const float HIZ_CUT_MIN_VIEW_DOT = 0.866f;
+
+// number of frames the chunk cull statistics are averaged over before they are printed
+static const uint32_t CULL_STATS_REPORT_INTERVAL = 600;
+
+// number of frames the host upload total is averaged over before it is printed
+static const uint32_t UPLOAD_STATS_REPORT_INTERVAL = 600;
+
+// number of frames the terrain fragment counts are averaged over before they are printed
+static const uint32_t OVERDRAW_STATS_REPORT_INTERVAL = 600;
+
+// width and height every terrain material is resampled to in the material array
+static const uint32_t TERRAIN_MATERIAL_SIZE = 1024;
+
+// gpu time budget of the scene passes in milliseconds and the range the render scale is kept within
+static const float DYNAMIC_RESOLUTION_FRAME_TIME = 12.0f;
+static const float DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+static const float DYNAMIC_RESOLUTION_MAX_SCALE = 1.0f;
 
 void VulkanRenderer::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain)
 {
 	devices_ = devices;
 	swap_chain_ = swap_chain;
 
+#ifdef TEXTURE_DOWNSCALE_BENCHMARK
+	Texture::BenchmarkDownsampleArea(devices->GetJobSystem());
+#endif
+
 	// load a default texture
 	default_texture_ = new Texture();
 	default_texture_->Init(devices, "../res/textures/default.png");
@@ -14,14 +76,100 @@ void VulkanRenderer::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain)
 	// create the texture cache
 	texture_cache_ = new VulkanTextureCache(devices);
 
-	// load the terrain textures
-	mountain_texture_ = texture_cache_->LoadTexture("../res/textures/mountain.png");
-	sand_texture_ = texture_cache_->LoadTexture("../res/textures/beach_sand.png");
-	grass_texture_ = texture_cache_->LoadTexture("../res/textures/grass01.png");
+#ifdef TERRAIN_MATERIAL_ARRAY
+	terrain_material_array_ = true;
+#else
+	terrain_material_array_ = false;
+#endif
+	terrain_materials_ = nullptr;
+	mountain_texture_ = nullptr;
+	sand_texture_ = nullptr;
+	grass_texture_ = nullptr;
+
+	if (terrain_material_array_)
+	{
+		// the layers are in the order of the material indices in terrain_materials.frag
+		std::vector<std::string> material_files = { "../res/textures/mountain.png", "../res/textures/beach_sand.png", "../res/textures/grass01.png" };
+
+		terrain_materials_ = new TextureArray();
+		terrain_materials_->Init(devices, material_files, TERRAIN_MATERIAL_SIZE);
+	}
+	else
+	{
+		// load the terrain textures in parallel, they resolve to the default texture until they are resident
+		mountain_texture_ = texture_cache_->LoadTextureAsync("../res/textures/mountain.png", default_texture_);
+		sand_texture_ = texture_cache_->LoadTextureAsync("../res/textures/beach_sand.png", default_texture_);
+		grass_texture_ = texture_cache_->LoadTextureAsync("../res/textures/grass01.png", default_texture_);
+
+#ifndef ASYNC_TEXTURE_LOADING
+		texture_cache_->WaitForLoads();
+#endif
+	}
 
 	current_chunk_x_ = 0;
 	current_chunk_y_ = 0;
 
+#ifdef TERRAIN_GPU_CULLING
+	gpu_chunk_culling_ = true;
+#else
+	gpu_chunk_culling_ = false;
+#endif
+	chunk_culling_pipeline_ = nullptr;
+
+#ifdef PER_FRAME_RECORDING
+	per_frame_recording_ = true;
+#else
+	per_frame_recording_ = false;
+#endif
+	command_recorder_ = nullptr;
+
+#ifdef TERRAIN_DEPTH_PREPASS
+	terrain_depth_prepass_ = true;
+#else
+	terrain_depth_prepass_ = false;
+#endif
+	terrain_depth_shader_ = nullptr;
+	terrain_depth_pipeline_ = nullptr;
+
+#ifdef TERRAIN_OVERDRAW_STATS
+	overdraw_stats_ = true;
+#else
+	overdraw_stats_ = false;
+#endif
+	overdraw_query_pool_ = VK_NULL_HANDLE;
+	terrain_timestamp_pool_ = VK_NULL_HANDLE;
+	total_fragment_invocations_ = 0;
+	total_terrain_pass_time_ = 0.0;
+	overdraw_frame_count_ = 0;
+
+#ifdef DYNAMIC_RESOLUTION
+	dynamic_resolution_enabled_ = true;
+#else
+	dynamic_resolution_enabled_ = false;
+#endif
+	dynamic_resolution_ = nullptr;
+
+#ifdef TERRAIN_CULL_STATS
+	cull_stats_ = true;
+#else
+	cull_stats_ = false;
+#endif
+	hiz_pyramid_ = nullptr;
+	hiz_history_valid_ = false;
+	previous_hiz_uv_scale_ = glm::vec2(1.0f);
+	total_chunks_tested_ = 0;
+	total_frustum_culled_ = 0;
+	total_occlusion_culled_ = 0;
+	cull_stats_frame_count_ = 0;
+	chunk_bounds_dirty_ = true;
+#ifdef UPLOAD_STATS
+	upload_stats_ = true;
+#else
+	upload_stats_ = false;
+#endif
+	upload_stats_start_bytes_ = 0;
+	upload_stats_frame_count_ = 0;
+
 	CreateShaders();
 	CreateCommandPool();
 	CreateBuffers();
@@ -31,7 +179,7 @@ void VulkanRenderer::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain)
 	vkGetDeviceQueue(devices_->GetLogicalDevice(), devices_->GetQueueFamilyIndices().compute_family, 0, &compute_queue_);
 }
 
-void VulkanRenderer::RenderScene()
+void VulkanRenderer::RenderScene(float frame_time)
 {
 	// get swap chain index
 	uint32_t image_index = swap_chain_->GetCurrentSwapChainImage();
@@ -61,54 +209,24 @@ void VulkanRenderer::RenderScene()
 
 	bool chunk_move = (current_chunk_x_ != old_chunk_x || current_chunk_y_ != old_chunk_y);
 
-	// only update the world matrices if the player has moved between chunks
+	// pick up any height pyramid readbacks that have finished since the last frame
+	if (terrain_generator_->UpdateHeightBounds())
+		chunk_bounds_dirty_ = true;
+
+	// only update the chunk placement if the player has moved between chunks
 	if (chunk_move)
 	{
-		for (int y = 0; y < TERRAIN_CHUNK_SIZE; y++)
-		{
-			for (int x = 0; x < TERRAIN_CHUNK_SIZE; x++)
-			{
-				glm::mat4 scale = glm::scale(glm::vec3(TERRAIN_SIZE / 2, TERRAIN_SIZE / 2, TERRAIN_SIZE / 2));
-				glm::mat4 rot = glm::mat4(1.0f);
-
-				int chunk_x = current_chunk_x_ - (TERRAIN_CHUNK_SIZE / 2) + x;
-				int chunk_y = current_chunk_y_ + (TERRAIN_CHUNK_SIZE / 2) - y;
+		// the shifted chunks are regenerating, so hold off occlusion culling until they have been drawn again
+		hiz_history_valid_ = false;
 
-				glm::mat4 translate = glm::translate(glm::vec3(chunk_x * (TERRAIN_SIZE), chunk_y * (TERRAIN_SIZE), 0.0f));
-				glm::mat4 world = translate * rot * scale;
-				terrain_matrix_data_.world[x + (y * TERRAIN_CHUNK_SIZE)] = world;
-			}
-		}
+		UpdateChunkPlacement();
 	}
-	// update the matrix buffer
-	terrain_matrix_data_.view = render_camera_->GetViewMatrix();
-	terrain_matrix_data_.proj = render_camera_->GetProjectionMatrix();
-	devices_->CopyDataToBuffer(terrain_matrix_buffer_memory_, &terrain_matrix_data_, sizeof(TerrainMatrixData));
 
-	// update the lod factors buffer
-	TerrainLODFactors lod = {};
-	lod.minMaxDistance = glm::vec4(4.0f, 1000.0f, 0.0f, 0.0f);
-	lod.minMaxLOD = glm::vec4(1.0f, 10.0f, 0.0f, 0.0f);
-	lod.cameraPos = glm::vec4(render_camera_->GetPosition(), 1.0f);
-	devices_->CopyDataToBuffer(terrain_lod_factors_buffer_memory_, &lod, sizeof(TerrainLODFactors));
-
-	// update the terrain render data buffer
-	TerrainRenderData data = {};
-	data.terrain_size = TERRAIN_SIZE;
-	data.camera_pos = render_camera_->GetPosition();
-	data.water_size = glm::vec4(WATER_SIZE);
-	devices_->CopyDataToBuffer(terrain_render_data_buffer_memory_, &data, sizeof(TerrainRenderData));
-
-	// update the water matrix buffer
-	WaterMatrixData water_matrices = {}; 
-	glm::mat4 scale = glm::scale(glm::vec3((TERRAIN_SIZE / 2) * TERRAIN_CHUNK_SIZE, (TERRAIN_SIZE / 2) * TERRAIN_CHUNK_SIZE, TERRAIN_SIZE / 2));
-	glm::mat4 rot = glm::mat4(1.0f);
-	glm::mat4 translate = glm::translate(glm::vec3(current_chunk_x_ * TERRAIN_SIZE, current_chunk_y_ * TERRAIN_SIZE, 0.0f));
-	glm::mat4 world = translate * rot * scale;
-	water_matrices.world = world;
-	water_matrices.view = render_camera_->GetViewMatrix();
-	water_matrices.proj = render_camera_->GetProjectionMatrix();
-	devices_->CopyDataToBuffer(water_matrix_buffer_memory_, &water_matrices, sizeof(WaterMatrixData));
+	// update the camera buffer, the only terrain uniforms that change every frame
+	camera_data_.view = render_camera_->GetViewMatrix();
+	camera_data_.proj = render_camera_->GetProjectionMatrix();
+	camera_data_.camera_pos = glm::vec4(render_camera_->GetPosition(), 1.0f);
+	devices_->CopyDataToBuffer(camera_buffer_memory_, &camera_data_, sizeof(CameraData));
 
 	// update the water render data buffer
 	WaterRenderData water_data = {};
@@ -120,29 +238,42 @@ void VulkanRenderer::RenderScene()
 	water_data.padding[2] = 2;
 	devices_->CopyDataToBuffer(water_render_data_buffer_memory_, &water_data, sizeof(WaterRenderData));
 
-	// update fog factors buffer
-	FogFactors fog_factors = {};
-	fog_factors.extinction_factor = 0.004f;
-	fog_factors.in_scattering_factor = 0.002f;
-	fog_factors.camera_height = render_camera_->GetPosition().z;
-	fog_factors.padding = 0;
-	devices_->CopyDataToBuffer(fog_factors_buffer_memory_, &fog_factors, sizeof(FogFactors));
-	
-	// terrain rendering
-	// render the skybox
-	skybox_->Render(render_camera_);
+	// swap the terrain textures in as their uploads complete
+	if (texture_cache_->Update())
+		RebindTerrainTextures();
 
-	// render the terrain
-	RenderTerrain();
-	render_semaphore_ = terrain_rendering_semaphore_;
-	
-	// render the water
-	RenderWater();
-	render_semaphore_ = water_rendering_semaphore_;
+	// read back last frame's terrain fragment count, the queue has been idled by the present since then
+	if (overdraw_query_pool_ != VK_NULL_HANDLE)
+		ReportOverdrawStats();
+
+	if (per_frame_recording_)
+	{
+		// record and submit the skybox, terrain and water as a single frame
+		RenderSceneCommands(frame_time);
+		render_semaphore_ = scene_rendering_semaphore_;
+	}
+	else
+	{
+		// the hdr chain still needs this frame's time to adapt its exposure
+		if (hdr_->GetHDRMode() > 0)
+			hdr_->UpdateRenderRegion(swap_chain_->GetRenderExtent(), frame_time);
+
+		// terrain rendering
+		// render the skybox
+		skybox_->Render(render_camera_);
+
+		// render the terrain
+		RenderTerrain();
+		render_semaphore_ = terrain_rendering_semaphore_;
+
+		// render the water
+		RenderWater();
+		render_semaphore_ = water_rendering_semaphore_;
+	}
 
 	if (hdr_->GetHDRMode() > 0)
 	{
-		hdr_->Render(swap_chain_, &render_semaphore_);
+		hdr_->Render(&render_semaphore_);
 		render_semaphore_ = hdr_->GetHDRSemaphore();
 	}
 	
@@ -151,6 +282,9 @@ void VulkanRenderer::RenderScene()
 	//render_semaphore_ = visualisation_semaphore_;
 
 	swap_chain_->FinalizeIntermediateImage();
+
+	if (upload_stats_)
+		ReportUploadStats();
 }
 
 void VulkanRenderer::RenderVisualisation()
@@ -178,8 +312,7 @@ void VulkanRenderer::RenderVisualisation()
 
 void VulkanRenderer::RenderTerrain()
 {
-	// determine which terrain chunks to render
-	std::vector<VkCommandBuffer> visible_chunk_commands = CheckTerrainVisibility();
+	UpdateTerrainCulling();
 
 	// submit the draw command buffer
 	VkSubmitInfo submit_info = {};
@@ -191,8 +324,8 @@ void VulkanRenderer::RenderTerrain()
 	submit_info.waitSemaphoreCount = 1;
 	submit_info.pWaitSemaphores = wait_semaphores;
 	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = visible_chunk_commands.size();
-	submit_info.pCommandBuffers = visible_chunk_commands.data();
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &terrain_rendering_command_buffer_;
 
 	VkSemaphore signal_semaphores[] = { terrain_rendering_semaphore_ };
 	submit_info.signalSemaphoreCount = 1;
@@ -205,6 +338,68 @@ void VulkanRenderer::RenderTerrain()
 	}
 }
 
+void VulkanRenderer::UpdateTerrainCulling()
+{
+	UpdateTerrainChunkBounds();
+
+	if (gpu_chunk_culling_)
+	{
+		// hand the frustum and chunk boxes to the cull pass, it writes the visible chunk list and the draw
+		ChunkCullData cull_data = {};
+		for (int i = 0; i < 6; i++)
+			cull_data.frustum_planes[i] = view_frustum_.GetPlanes()[i];
+
+		for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
+		{
+			cull_data.chunk_min[i] = glm::vec4(terrain_chunk_bounds_.min_x[i], terrain_chunk_bounds_.min_y[i], terrain_chunk_bounds_.min_z[i], 0.0f);
+			cull_data.chunk_max[i] = glm::vec4(terrain_chunk_bounds_.max_x[i], terrain_chunk_bounds_.max_y[i], terrain_chunk_bounds_.max_z[i], 0.0f);
+		}
+
+		cull_data.chunk_count = TERRAIN_CHUNK_COUNT;
+		cull_data.index_count = terrain_mesh_->GetIndexCount();
+
+		// test against the pyramid built at the end of last frame's terrain pass, unless the camera has cut away from it
+		cull_data.previous_view_projection = previous_view_projection_;
+		cull_data.occlusion_enabled = (hiz_history_valid_ && !IsCameraCut()) ? 1 : 0;
+		cull_data.hiz_mip_count = hiz_pyramid_->GetMipCount();
+		cull_data.hiz_size = hiz_pyramid_->GetSize();
+		cull_data.hiz_uv_scale = previous_hiz_uv_scale_;
+
+		// the chunk boxes make up most of the buffer, so they are only uploaded when they have changed
+		if (chunk_bounds_dirty_)
+		{
+			devices_->CopyDataToBuffer(chunk_cull_buffer_memory_, &cull_data, sizeof(ChunkCullData));
+		}
+		else
+		{
+			VkDeviceSize tail_offset = offsetof(ChunkCullData, chunk_count);
+			devices_->CopyDataToBuffer(chunk_cull_buffer_memory_, &cull_data, offsetof(ChunkCullData, chunk_min));
+			devices_->CopyDataToBuffer(chunk_cull_buffer_memory_, reinterpret_cast<uint8_t*>(&cull_data) + tail_offset, sizeof(ChunkCullData) - tail_offset, tail_offset);
+		}
+
+		// this frame's pyramid will be rebuilt from this view
+		glm::mat4 view = camera_data_.view;
+		previous_view_projection_ = camera_data_.proj * view;
+		previous_camera_position_ = render_camera_->GetPosition();
+		previous_view_direction_ = glm::vec3(view[0][2], view[1][2], view[2][2]);
+
+		VkExtent2D render_extent = swap_chain_->GetRenderExtent();
+		VkExtent2D swap_extent = swap_chain_->GetSwapChainExtent();
+		previous_hiz_uv_scale_ = glm::vec2((float)render_extent.width / swap_extent.width, (float)render_extent.height / swap_extent.height);
+		hiz_history_valid_ = true;
+
+		if (cull_stats_)
+			ReportChunkCullStats();
+	}
+	else
+	{
+		// write the visible chunk list and the draw from the cpu
+		CheckTerrainVisibility();
+	}
+
+	chunk_bounds_dirty_ = false;
+}
+
 void VulkanRenderer::RenderWater()
 {
 	// submit the draw command buffer
@@ -231,115 +426,354 @@ void VulkanRenderer::RenderWater()
 	}
 }
 
-std::vector<VkCommandBuffer> VulkanRenderer::CheckTerrainVisibility()
+void VulkanRenderer::RenderSceneCommands(float frame_time)
 {
-	std::vector<VkCommandBuffer> visible_chunk_commands;
-	
-	// player can always see the center chunk
-	int center_index = (TERRAIN_CHUNK_COUNT - 1) / 2;
-	visible_chunk_commands.push_back(terrain_rendering_command_buffers_[center_index]);
-
-	// determine the position in the center chunk
-	float int_part;
-	glm::vec3 camera_pos = render_camera_->GetPosition();
-	camera_pos.z = 0;
-	camera_pos = camera_pos / (float)TERRAIN_SIZE;
-	camera_pos = glm::vec3(modf(camera_pos.x, &int_part), modf(camera_pos.y, &int_part), modf(camera_pos.z, &int_part));
-
-	// determine the edges of the camera frustum
-	glm::vec3 camera_rot = render_camera_->GetRotation();
-	glm::vec3 look_at = glm::rotateY(glm::vec3(0.0f, 1.0f, 0.0f), glm::radians(camera_rot.y));
-	look_at = glm::rotateZ(look_at, glm::radians(camera_rot.z));
-	look_at = look_at + camera_pos;
-	glm::vec3 view_left_edge = glm::rotateZ(look_at, glm::radians(-60.0f));
-	glm::vec3 view_right_edge = glm::rotateZ(look_at, glm::radians(60.0f));
-
-	glm::vec3 v0 = camera_pos;
-	glm::vec3 v1 = view_left_edge * (float)TERRAIN_CHUNK_SIZE;
-	glm::vec3 v2 = view_right_edge * (float)TERRAIN_CHUNK_SIZE;
-
-	// compute the view area
-	glm::vec3 v0v1 = v1 - v0;
-	glm::vec3 v0v2 = v2 - v0;
-	glm::vec3 n = glm::cross(v0v1, v0v2);
-	float area = n.length() / 2;
+	// pick this frame's render extent from the gpu time of the frames before it, the passes recorded below all draw at it
+	if (dynamic_resolution_)
+	{
+		dynamic_resolution_->Update();
+		swap_chain_->SetRenderExtent(dynamic_resolution_->GetRenderExtent(swap_chain_->GetSwapChainExtent()));
+	}
+
+	skybox_->Update(render_camera_);
+	UpdateTerrainCulling();
+
+	VkCommandBuffer frame_command_buffer = command_recorder_->BeginFrame();
+
+	if (dynamic_resolution_)
+		dynamic_resolution_->RecordFrameStart(frame_command_buffer);
+
+	hdr_->RecordRenderRegionUpdate(frame_command_buffer, swap_chain_->GetRenderExtent(), frame_time);
+
+	// record the draws of each pass on the job system, each job only writes its own slot
+	VkCommandBuffer pass_command_buffers[4];
+	JobSystem* job_system = devices_->GetJobSystem();
+	JobCounter record_counter;
+
+	// the shaded terrain pass inherits the overdraw query when it is active
+	VkQueryPipelineStatisticFlags terrain_statistics = (overdraw_query_pool_ != VK_NULL_HANDLE) ? VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT : 0;
+
+	job_system->Submit([&](uint32_t worker_index) { pass_command_buffers[0] = RecordSkyboxCommands(worker_index); }, 1, &record_counter);
+	job_system->Submit([&](uint32_t worker_index) { pass_command_buffers[1] = RecordTerrainCommands(worker_index, terrain_rendering_pipeline_, terrain_statistics); }, 1, &record_counter);
+	job_system->Submit([&](uint32_t worker_index) { pass_command_buffers[2] = RecordWaterCommands(worker_index); }, 1, &record_counter);
+
+	if (terrain_depth_prepass_)
+		job_system->Submit([&](uint32_t worker_index) { pass_command_buffers[3] = RecordTerrainCommands(worker_index, terrain_depth_pipeline_, 0); }, 1, &record_counter);
+
+	// the chunk cull does not depend on the skybox, so it is recorded at the start of the primary buffer while the workers run
+	if (gpu_chunk_culling_)
+		RecordChunkCullCommands(frame_command_buffer);
+
+	job_system->Wait(&record_counter);
+
+	// skybox, a meshlet mesh culls its clusters before the pass draws them
+	skybox_->RecordCullCommands(frame_command_buffer);
+	skybox_->GetPipeline()->BeginRenderPass(frame_command_buffer, 0, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	vkCmdExecuteCommands(frame_command_buffer, 1, &pass_command_buffers[0]);
+	vkCmdEndRenderPass(frame_command_buffer);
+
+	// terrain depth
+	if (terrain_depth_prepass_)
+	{
+		RecordAttachmentBarrier(frame_command_buffer);
+		terrain_depth_pipeline_->BeginRenderPass(frame_command_buffer, 0, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(frame_command_buffer, 1, &pass_command_buffers[3]);
+		vkCmdEndRenderPass(frame_command_buffer);
+	}
+
+	// terrain
+	RecordAttachmentBarrier(frame_command_buffer);
+	BeginOverdrawQuery(frame_command_buffer);
+	terrain_rendering_pipeline_->BeginRenderPass(frame_command_buffer, 0, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	vkCmdExecuteCommands(frame_command_buffer, 1, &pass_command_buffers[1]);
+	vkCmdEndRenderPass(frame_command_buffer);
+	EndOverdrawQuery(frame_command_buffer);
+
+	if (gpu_chunk_culling_)
+		hiz_pyramid_->RecordBuildCommands(frame_command_buffer);
+
+	// water
+	RecordAttachmentBarrier(frame_command_buffer);
+	water_rendering_pipeline_->BeginRenderPass(frame_command_buffer, 0, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	vkCmdExecuteCommands(frame_command_buffer, 1, &pass_command_buffers[2]);
+	vkCmdEndRenderPass(frame_command_buffer);
+
+	if (dynamic_resolution_)
+		dynamic_resolution_->RecordFrameEnd(frame_command_buffer);
+
+	command_recorder_->SubmitFrame(graphics_queue_, scene_rendering_semaphore_);
+}
+
+VkCommandBuffer VulkanRenderer::RecordSkyboxCommands(uint32_t worker_index)
+{
+	SkyboxPipeline* skybox_pipeline = skybox_->GetPipeline();
+	VkCommandBuffer command_buffer = command_recorder_->BeginSecondary(worker_index, skybox_pipeline->GetRenderPass(), skybox_pipeline->GetFramebuffer(0));
+
+	skybox_->RecordRenderCommands(command_buffer);
+
+	command_recorder_->EndSecondary(command_buffer);
+	return command_buffer;
+}
+
+VkCommandBuffer VulkanRenderer::RecordTerrainCommands(uint32_t worker_index, TerrainRenderingPipeline* pipeline, VkQueryPipelineStatisticFlags pipeline_statistics)
+{
+	VkCommandBuffer command_buffer = command_recorder_->BeginSecondary(worker_index, pipeline->GetRenderPass(), pipeline->GetFramebuffer(0), pipeline_statistics);
+
+	// render every visible chunk as an instance of the terrain mesh
+	pipeline->RecordBindCommands(command_buffer);
+	terrain_mesh_->RecordTerrainInstancedRenderCommands(command_buffer, chunk_instance_buffer_, chunk_draw_buffer_);
+
+	command_recorder_->EndSecondary(command_buffer);
+	return command_buffer;
+}
+
+VkCommandBuffer VulkanRenderer::RecordWaterCommands(uint32_t worker_index)
+{
+	VkCommandBuffer command_buffer = command_recorder_->BeginSecondary(worker_index, water_rendering_pipeline_->GetRenderPass(), water_rendering_pipeline_->GetFramebuffer(0));
+
+	water_rendering_pipeline_->RecordBindCommands(command_buffer);
+	water_mesh_->RecordTerrainRenderCommands(command_buffer, 0);
+
+	command_recorder_->EndSecondary(command_buffer);
+	return command_buffer;
+}
+
+void VulkanRenderer::RecordAttachmentBarrier(VkCommandBuffer& command_buffer)
+{
+	// passes that write the same attachments back to back must see each other's writes
+	VkMemoryBarrier attachment_barrier = {};
+	attachment_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	attachment_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	attachment_barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	VkPipelineStageFlags attachment_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+	vkCmdPipelineBarrier(command_buffer, attachment_stages, attachment_stages, 0, 1, &attachment_barrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanRenderer::BeginOverdrawQuery(VkCommandBuffer& command_buffer)
+{
+	if (overdraw_query_pool_ == VK_NULL_HANDLE)
+		return;
+
+	vkCmdResetQueryPool(command_buffer, overdraw_query_pool_, 0, 1);
+	vkCmdBeginQuery(command_buffer, overdraw_query_pool_, 0, 0);
+
+	if (terrain_timestamp_pool_ != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(command_buffer, terrain_timestamp_pool_, 0, 2);
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, terrain_timestamp_pool_, 0);
+	}
+}
+
+void VulkanRenderer::EndOverdrawQuery(VkCommandBuffer& command_buffer)
+{
+	if (overdraw_query_pool_ == VK_NULL_HANDLE)
+		return;
+
+	vkCmdEndQuery(command_buffer, overdraw_query_pool_, 0);
+
+	if (terrain_timestamp_pool_ != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, terrain_timestamp_pool_, 1);
+}
+
+void VulkanRenderer::ReportOverdrawStats()
+{
+	// not ready until the query has been submitted once
+	uint64_t fragment_invocations = 0;
+	if (vkGetQueryPoolResults(devices_->GetLogicalDevice(), overdraw_query_pool_, 0, 1, sizeof(uint64_t), &fragment_invocations, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	// timestamps are in ticks of the timestamp period in nanoseconds
+	uint64_t timestamps[2];
+	if (terrain_timestamp_pool_ != VK_NULL_HANDLE && vkGetQueryPoolResults(devices_->GetLogicalDevice(), terrain_timestamp_pool_, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		total_terrain_pass_time_ += (timestamps[1] - timestamps[0]) * timestamp_period_ / 1000000.0;
+
+	total_fragment_invocations_ += fragment_invocations;
+	overdraw_frame_count_++;
+
+	if (overdraw_frame_count_ < OVERDRAW_STATS_REPORT_INTERVAL)
+		return;
+
+	VkExtent2D extent = swap_chain_->GetRenderExtent();
+	double pixel_count = (double)extent.width * (double)extent.height * overdraw_frame_count_;
+	std::cout << "Terrain fragments shaded per pixel: " << total_fragment_invocations_ / pixel_count << std::endl;
+
+	// the fragment count does not change with the texture mips, so the time per fragment isolates their sampling cost
+	if (terrain_timestamp_pool_ != VK_NULL_HANDLE && total_fragment_invocations_ > 0)
+	{
+		uint32_t mip_levels = terrain_material_array_ ? terrain_materials_->GetMipLevels() : mountain_texture_->Get()->GetMipLevels();
+		std::cout << "Terrain pass: " << total_terrain_pass_time_ / overdraw_frame_count_ << " ms, " << total_terrain_pass_time_ * 1000000.0 / total_fragment_invocations_
+			<< " ns per fragment with " << mip_levels << " texture mip levels" << std::endl;
+	}
+
+	total_fragment_invocations_ = 0;
+	total_terrain_pass_time_ = 0.0;
+	overdraw_frame_count_ = 0;
+}
+
+void VulkanRenderer::UpdateTerrainChunkBounds()
+{
+	// build the frustum from the matrices the terrain is rendered with
+	view_frustum_.Update(camera_data_.proj * camera_data_.view);
+
+	// the boxes only move with the chunk placement and the height readbacks
+	if (!chunk_bounds_dirty_)
+		return;
+
+	// chunk meshes span -1 to 1 and are scaled by half the terrain size, heights are scaled the same way
+	float chunk_half_size = TERRAIN_SIZE / 2;
+	terrain_chunk_bounds_.Resize(TERRAIN_CHUNK_COUNT);
+
+	for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
+	{
+		glm::vec3 chunk_center_pos = glm::vec3(chunk_placement_data_.chunk_offsets[i]);
+		glm::vec2 height_bounds = terrain_generator_->GetChunkHeightBounds(i);
+
+		// edge vertices sample the right and upper neighbours, so their heights can extend the box
+		if (i % TERRAIN_CHUNK_SIZE != TERRAIN_CHUNK_SIZE - 1)
+		{
+			glm::vec2 neighbour_bounds = terrain_generator_->GetChunkHeightBounds(i + 1);
+			height_bounds = glm::vec2(glm::min(height_bounds.x, neighbour_bounds.x), glm::max(height_bounds.y, neighbour_bounds.y));
+		}
+		if (i > TERRAIN_CHUNK_SIZE - 1)
+		{
+			glm::vec2 neighbour_bounds = terrain_generator_->GetChunkHeightBounds(i - TERRAIN_CHUNK_SIZE);
+			height_bounds = glm::vec2(glm::min(height_bounds.x, neighbour_bounds.x), glm::max(height_bounds.y, neighbour_bounds.y));
+		}
+
+		glm::vec3 chunk_min = chunk_center_pos + glm::vec3(-chunk_half_size, -chunk_half_size, height_bounds.x * chunk_half_size);
+		glm::vec3 chunk_max = chunk_center_pos + glm::vec3(chunk_half_size, chunk_half_size, height_bounds.y * chunk_half_size);
+		terrain_chunk_bounds_.Set(i, chunk_min, chunk_max);
+	}
+}
+
+void VulkanRenderer::RebindTerrainTextures()
+{
+	// the terrain descriptor set may still be in use by frames in flight, this only happens as each batch of textures arrives
+	vkDeviceWaitIdle(devices_->GetLogicalDevice());
+
+	terrain_rendering_pipeline_->UpdateTexture(7, mountain_texture_->Get());
+	terrain_rendering_pipeline_->UpdateTexture(8, sand_texture_->Get());
+	terrain_rendering_pipeline_->UpdateTexture(9, grass_texture_->Get());
+
+	// rewriting the descriptor set invalidates the command buffer recorded at init, per frame recording picks the change up by itself
+	if (!per_frame_recording_)
+	{
+		vkFreeCommandBuffers(devices_->GetLogicalDevice(), command_pool_, 1, &terrain_rendering_command_buffer_);
+		CreateTerrainRenderingCommandBuffers();
+	}
+}
 
+void VulkanRenderer::UpdateChunkPlacement()
+{
+	// chunk meshes span -1 to 1, so each chunk is scaled by half the terrain size and offset to its grid position
 	for (int y = 0; y < TERRAIN_CHUNK_SIZE; y++)
 	{
 		for (int x = 0; x < TERRAIN_CHUNK_SIZE; x++)
 		{
-			int i = x + (y * TERRAIN_CHUNK_SIZE);
+			int chunk_x = current_chunk_x_ - (TERRAIN_CHUNK_SIZE / 2) + x;
+			int chunk_y = current_chunk_y_ + (TERRAIN_CHUNK_SIZE / 2) - y;
 
-			if (i == center_index)
-				continue;
-
-			// determine the four corner points of the chunk
-			float chunk_center_x = ((TERRAIN_CHUNK_SIZE / 2) * -1) + x;
-			float chunk_center_y = (TERRAIN_CHUNK_SIZE / 2) - y;
-			glm::vec3 chunk_center_pos = glm::vec3(chunk_center_x, chunk_center_y, 0.0);
-
-			glm::vec3 chunk_top_left = chunk_center_pos + glm::vec3(-0.5f, 0.5f, 0.0f);
-			glm::vec3 chunk_top_right = chunk_center_pos + glm::vec3(0.5f, 0.5f, 0.0f);
-			glm::vec3 chunk_bot_left = chunk_center_pos + glm::vec3(-0.5f, -0.5f, 0.0f);
-			glm::vec3 chunk_bot_right = chunk_center_pos + glm::vec3(0.5f, -0.5f, 0.0f);
-
-			// determine barycentric coordinates for each of the corner points to see if they fall inside the frustum
-			glm::vec3 c0 = glm::vec3(0, 0, 0);
-			glm::vec3 c1 = glm::vec3(0, 0, 0);
-			glm::vec3 vp1 = glm::vec3(0, 0, 0);
-			glm::vec3 vp2 = glm::vec3(0, 0, 0);
-
-			// top left
-			vp1 = chunk_top_left - v1;
-			c0 = glm::cross(view_left_edge, vp1);
-			vp2 = chunk_top_left - v2;
-			c1 = glm::cross(view_right_edge, vp2);
-			if (glm::dot(n, c0) >= 0 && glm::dot(n, c1) < 0)
-			{
-				// chunk falls within the view frustum
-				visible_chunk_commands.push_back(terrain_rendering_command_buffers_[i]);
-				continue;
-			}
+			chunk_placement_data_.chunk_offsets[x + (y * TERRAIN_CHUNK_SIZE)] = glm::vec4(chunk_x * TERRAIN_SIZE, chunk_y * TERRAIN_SIZE, 0.0f, TERRAIN_SIZE / 2);
+		}
+	}
 
-			// top right
-			vp1 = chunk_top_right - v1;
-			c0 = glm::cross(view_left_edge, vp1);
-			vp2 = chunk_top_right - v2;
-			c1 = glm::cross(view_right_edge, vp2);
-			if (glm::dot(n, c0) >= 0 && glm::dot(n, c1) < 0)
-			{
-				// chunk falls within the view frustum
-				visible_chunk_commands.push_back(terrain_rendering_command_buffers_[i]);
-				continue;
-			}
+	// the water covers every chunk and is centred on the player's chunk
+	glm::mat4 scale = glm::scale(glm::vec3((TERRAIN_SIZE / 2) * TERRAIN_CHUNK_SIZE, (TERRAIN_SIZE / 2) * TERRAIN_CHUNK_SIZE, TERRAIN_SIZE / 2));
+	glm::mat4 rot = glm::mat4(1.0f);
+	glm::mat4 translate = glm::translate(glm::vec3(current_chunk_x_ * TERRAIN_SIZE, current_chunk_y_ * TERRAIN_SIZE, 0.0f));
+	chunk_placement_data_.water_world = translate * rot * scale;
 
-			// top left
-			vp1 = chunk_bot_left - v1;
-			c0 = glm::cross(view_left_edge, vp1);
-			vp2 = chunk_bot_left - v2;
-			c1 = glm::cross(view_right_edge, vp2);
-			if (glm::dot(n, c0) >= 0 && glm::dot(n, c1) < 0)
-			{
-				// chunk falls within the view frustum
-				visible_chunk_commands.push_back(terrain_rendering_command_buffers_[i]);
-				continue;
-			}
+	devices_->CopyDataToBuffer(chunk_placement_buffer_memory_, &chunk_placement_data_, sizeof(ChunkPlacementData));
 
-			// top left
-			vp1 = chunk_bot_right - v1;
-			c0 = glm::cross(view_left_edge, vp1);
-			vp2 = chunk_bot_right - v2;
-			c1 = glm::cross(view_right_edge, vp2);
-			if (glm::dot(n, c0) >= 0 && glm::dot(n, c1) < 0)
-			{
-				// chunk falls within the view frustum
-				visible_chunk_commands.push_back(terrain_rendering_command_buffers_[i]);
-				continue;
-			}
-		}
+	chunk_bounds_dirty_ = true;
+}
+
+void VulkanRenderer::UploadStaticData()
+{
+	// update the lod factors buffer
+	TerrainLODFactors lod = {};
+	lod.minMaxDistance = glm::vec4(4.0f, 1000.0f, 0.0f, 0.0f);
+	lod.minMaxLOD = glm::vec4(1.0f, 10.0f, 0.0f, 0.0f);
+	lod.cameraPos = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	devices_->CopyDataToBuffer(terrain_lod_factors_buffer_memory_, &lod, sizeof(TerrainLODFactors));
+
+	// update the terrain render data buffer
+	TerrainRenderData data = {};
+	data.terrain_size = TERRAIN_SIZE;
+	data.water_size = glm::vec4(WATER_SIZE);
+	devices_->CopyDataToBuffer(terrain_render_data_buffer_memory_, &data, sizeof(TerrainRenderData));
+
+	// update fog factors buffer, the camera height is read from the camera buffer
+	FogFactors fog_factors = {};
+	fog_factors.extinction_factor = 0.004f;
+	fog_factors.in_scattering_factor = 0.002f;
+	devices_->CopyDataToBuffer(fog_factors_buffer_memory_, &fog_factors, sizeof(FogFactors));
+}
+
+void VulkanRenderer::ReportUploadStats()
+{
+	upload_stats_frame_count_++;
+
+	if (upload_stats_frame_count_ < UPLOAD_STATS_REPORT_INTERVAL)
+		return;
+
+	uint64_t uploaded_bytes = devices_->GetUploadedBytes();
+	std::cout << "Host uploads: " << (uploaded_bytes - upload_stats_start_bytes_) / upload_stats_frame_count_ << " bytes per frame" << std::endl;
+
+	upload_stats_start_bytes_ = uploaded_bytes;
+	upload_stats_frame_count_ = 0;
+}
+
+bool VulkanRenderer::IsCameraCut()
+{
+	glm::mat4 view = camera_data_.view;
+	glm::vec3 view_direction = glm::vec3(view[0][2], view[1][2], view[2][2]);
+
+	float distance = glm::length(render_camera_->GetPosition() - previous_camera_position_);
+	return distance > HIZ_CUT_DISTANCE || glm::dot(view_direction, previous_view_direction_) < HIZ_CUT_MIN_VIEW_DOT;
+}
+
+void VulkanRenderer::ReportChunkCullStats()
+{
+	// the stats come from the last submitted cull pass, the queue has been idled by the present since then
+	total_chunks_tested_ += chunk_cull_stats_->tested_count;
+	total_frustum_culled_ += chunk_cull_stats_->frustum_culled_count;
+	total_occlusion_culled_ += chunk_cull_stats_->occlusion_culled_count;
+	cull_stats_frame_count_++;
+
+	if (cull_stats_frame_count_ < CULL_STATS_REPORT_INTERVAL || total_chunks_tested_ == 0)
+		return;
+
+	float frustum_percentage = 100.0f * total_frustum_culled_ / total_chunks_tested_;
+	float occlusion_percentage = 100.0f * total_occlusion_culled_ / total_chunks_tested_;
+	std::cout << "Terrain chunks culled: " << frustum_percentage << "% frustum, " << occlusion_percentage << "% occlusion" << std::endl;
+
+	total_chunks_tested_ = 0;
+	total_frustum_culled_ = 0;
+	total_occlusion_culled_ = 0;
+	cull_stats_frame_count_ = 0;
+}
+
+void VulkanRenderer::CheckTerrainVisibility()
+{
+	// test every chunk in one batch
+	view_frustum_.TestAABBs(terrain_chunk_bounds_, terrain_chunk_visibility_);
+
+	uint32_t visible_chunks[TERRAIN_CHUNK_COUNT];
+	uint32_t visible_count = 0;
+	for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
+	{
+		if (terrain_chunk_visibility_[i])
+			visible_chunks[visible_count++] = i;
 	}
 
-	return visible_chunk_commands;
+	// the chunk buffers are host visible on this path, the frame has finished with them by the time the next one is written
+	VkDrawIndexedIndirectCommand draw_command = { terrain_mesh_->GetIndexCount(), visible_count, 0, 0, 0 };
+	devices_->CopyDataToBuffer(chunk_draw_buffer_memory_, &draw_command, sizeof(VkDrawIndexedIndirectCommand));
+
+	if (visible_count > 0)
+		devices_->CopyDataToBuffer(chunk_instance_buffer_memory_, visible_chunks, sizeof(uint32_t) * visible_count);
 }
 
 void VulkanRenderer::Cleanup()
@@ -347,9 +781,19 @@ void VulkanRenderer::Cleanup()
 	// clean up command and descriptor pools
 	vkDestroyCommandPool(devices_->GetLogicalDevice(), command_pool_, nullptr);
 
+	if (command_recorder_)
+	{
+		command_recorder_->Cleanup();
+		delete command_recorder_;
+		command_recorder_ = nullptr;
+	}
+
 	// clean up buffers
-	vkDestroyBuffer(devices_->GetLogicalDevice(), terrain_matrix_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), terrain_matrix_buffer_memory_, nullptr);
+	vkDestroyBuffer(devices_->GetLogicalDevice(), camera_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), camera_buffer_memory_, nullptr);
+
+	vkDestroyBuffer(devices_->GetLogicalDevice(), chunk_placement_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), chunk_placement_buffer_memory_, nullptr);
 
 	vkDestroyBuffer(devices_->GetLogicalDevice(), terrain_lod_factors_buffer_, nullptr);
 	vkFreeMemory(devices_->GetLogicalDevice(), terrain_lod_factors_buffer_memory_, nullptr);
@@ -360,15 +804,25 @@ void VulkanRenderer::Cleanup()
 	vkDestroyBuffer(devices_->GetLogicalDevice(), fog_factors_buffer_, nullptr);
 	vkFreeMemory(devices_->GetLogicalDevice(), fog_factors_buffer_memory_, nullptr);
 
-	vkDestroyBuffer(devices_->GetLogicalDevice(), water_matrix_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), water_matrix_buffer_memory_, nullptr);
-
 	vkDestroyBuffer(devices_->GetLogicalDevice(), water_render_data_buffer_, nullptr);
 	vkFreeMemory(devices_->GetLogicalDevice(), water_render_data_buffer_memory_, nullptr);
 
 	vkDestroyBuffer(devices_->GetLogicalDevice(), color_data_buffer_, nullptr);
 	vkFreeMemory(devices_->GetLogicalDevice(), color_data_buffer_memory_, nullptr);
 
+	vkDestroyBuffer(devices_->GetLogicalDevice(), chunk_cull_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), chunk_cull_buffer_memory_, nullptr);
+
+	vkDestroyBuffer(devices_->GetLogicalDevice(), chunk_draw_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), chunk_draw_buffer_memory_, nullptr);
+
+	vkDestroyBuffer(devices_->GetLogicalDevice(), chunk_instance_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), chunk_instance_buffer_memory_, nullptr);
+
+	vkUnmapMemory(devices_->GetLogicalDevice(), chunk_cull_stats_buffer_memory_);
+	vkDestroyBuffer(devices_->GetLogicalDevice(), chunk_cull_stats_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), chunk_cull_stats_buffer_memory_, nullptr);
+
 	// clean up shaders
 	buffer_visualisation_shader_->Cleanup();
 	delete buffer_visualisation_shader_;
@@ -378,10 +832,21 @@ void VulkanRenderer::Cleanup()
 	delete terrain_shader_;
 	terrain_shader_ = nullptr;
 
+	if (terrain_depth_shader_)
+	{
+		terrain_depth_shader_->Cleanup();
+		delete terrain_depth_shader_;
+		terrain_depth_shader_ = nullptr;
+	}
+
 	water_shader_->Cleanup();
 	delete water_shader_;
 	water_shader_ = nullptr;
 
+	chunk_cull_shader_->Cleanup();
+	delete chunk_cull_shader_;
+	chunk_cull_shader_ = nullptr;
+
 	// clean up the texture cache
 	texture_cache_->Cleanup();
 	delete texture_cache_;
@@ -397,6 +862,48 @@ void VulkanRenderer::Cleanup()
 	delete terrain_rendering_pipeline_;
 	terrain_rendering_pipeline_ = nullptr;
 
+	if (terrain_depth_pipeline_)
+	{
+		terrain_depth_pipeline_->CleanUp();
+		delete terrain_depth_pipeline_;
+		terrain_depth_pipeline_ = nullptr;
+	}
+
+	if (overdraw_query_pool_ != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(devices_->GetLogicalDevice(), overdraw_query_pool_, nullptr);
+		overdraw_query_pool_ = VK_NULL_HANDLE;
+	}
+
+	if (terrain_timestamp_pool_ != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(devices_->GetLogicalDevice(), terrain_timestamp_pool_, nullptr);
+		terrain_timestamp_pool_ = VK_NULL_HANDLE;
+	}
+
+	if (dynamic_resolution_)
+	{
+		dynamic_resolution_->Cleanup();
+		delete dynamic_resolution_;
+		dynamic_resolution_ = nullptr;
+	}
+
+	// clean up the chunk culling pipeline
+	if (chunk_culling_pipeline_)
+	{
+		chunk_culling_pipeline_->CleanUp();
+		delete chunk_culling_pipeline_;
+		chunk_culling_pipeline_ = nullptr;
+	}
+
+	// clean up the hi-z pyramid
+	if (hiz_pyramid_)
+	{
+		hiz_pyramid_->Cleanup();
+		delete hiz_pyramid_;
+		hiz_pyramid_ = nullptr;
+	}
+
 	// clean up water rendering pipeline
 	water_rendering_pipeline_->CleanUp();
 	delete water_rendering_pipeline_;
@@ -425,19 +932,23 @@ void VulkanRenderer::Cleanup()
 	delete terrain_generator_;
 	terrain_generator_ = nullptr;
 
+	if (terrain_materials_)
+	{
+		terrain_materials_->Cleanup();
+		delete terrain_materials_;
+		terrain_materials_ = nullptr;
+	}
+
 	// clean up default texture
 	default_texture_->Cleanup();
 	delete default_texture_;
 	default_texture_ = nullptr;
 
-	// clean up samplers
-	vkDestroySampler(devices_->GetLogicalDevice(), buffer_normalized_sampler_, nullptr);
-	vkDestroySampler(devices_->GetLogicalDevice(), buffer_unnormalized_sampler_, nullptr);
-
 	// clean up semaphores
 	vkDestroySemaphore(devices_->GetLogicalDevice(), visualisation_semaphore_, nullptr);
 	vkDestroySemaphore(devices_->GetLogicalDevice(), terrain_rendering_semaphore_, nullptr);
 	vkDestroySemaphore(devices_->GetLogicalDevice(), water_rendering_semaphore_, nullptr);
+	vkDestroySemaphore(devices_->GetLogicalDevice(), scene_rendering_semaphore_, nullptr);
 }
 
 void VulkanRenderer::InitPipelines()
@@ -483,22 +994,12 @@ void VulkanRenderer::InitPipelines()
 	// generate water map
 	terrain_generator_->GenerateWatermap();
 
-	// generate initial matrices to save time while rendering
-	for (int y = 0; y < TERRAIN_CHUNK_SIZE; y++)
-	{
-		for (int x = 0; x < TERRAIN_CHUNK_SIZE; x++)
-		{
-			glm::mat4 scale = glm::scale(glm::vec3(TERRAIN_SIZE / 2, TERRAIN_SIZE / 2, TERRAIN_SIZE / 2));
-			glm::mat4 rot = glm::mat4(1.0f);
+	// collect the initial chunk height bounds
+	terrain_generator_->UpdateHeightBounds();
 
-			int chunk_x = current_chunk_x_ - (TERRAIN_CHUNK_SIZE / 2) + x;
-			int chunk_y = current_chunk_y_ + (TERRAIN_CHUNK_SIZE / 2) - y;
-
-			glm::mat4 translate = glm::translate(glm::vec3(chunk_x * (TERRAIN_SIZE), chunk_y * (TERRAIN_SIZE), 0.0f));
-			glm::mat4 world = translate * rot * scale;
-			terrain_matrix_data_.world[x + (y * TERRAIN_CHUNK_SIZE)] = world;
-		}
-	}
+	// upload the data that never changes and the initial chunk placement
+	UploadStaticData();
+	UpdateChunkPlacement();
 
 	// initialize the buffer samplers
 	VkSamplerCreateInfo sampler_info = {};
@@ -516,17 +1017,13 @@ void VulkanRenderer::InitPipelines()
 	sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
 	sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 
-	if (vkCreateSampler(devices_->GetLogicalDevice(), &sampler_info, nullptr, &buffer_unnormalized_sampler_) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create g buffer sampler!");
-	}
+	buffer_unnormalized_sampler_ = devices_->GetSampler(sampler_info);
 
-	// initialize the shadow map sampler
+	// initialize the shadow map sampler, it has the same state as the normalized buffer sampler so they share one
 	sampler_info.unnormalizedCoordinates = VK_FALSE;
 
-	if (vkCreateSampler(devices_->GetLogicalDevice(), &sampler_info, nullptr, &shadow_map_sampler_) != VK_SUCCESS ||
-		vkCreateSampler(devices_->GetLogicalDevice(), &sampler_info, nullptr, &buffer_normalized_sampler_) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create normalized samplers!");
-	}
+	shadow_map_sampler_ = devices_->GetSampler(sampler_info);
+	buffer_normalized_sampler_ = devices_->GetSampler(sampler_info);
 
 	// initialize a buffer visualisation pipeline
 	buffer_visualisation_pipeline_ = new BufferVisualisationPipeline();
@@ -539,26 +1036,113 @@ void VulkanRenderer::InitPipelines()
 	// create the terrain rendering pipeline
 	terrain_rendering_pipeline_ = new TerrainRenderingPipeline();
 	terrain_rendering_pipeline_->SetShader(terrain_shader_);
-	terrain_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, terrain_matrix_buffer_, sizeof(TerrainMatrixData));
+	terrain_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, camera_buffer_, sizeof(CameraData));
 	terrain_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 1, terrain_render_data_buffer_, sizeof(TerrainRenderData));
 	terrain_rendering_pipeline_->AddSampler(VK_SHADER_STAGE_VERTEX_BIT, 2, buffer_normalized_sampler_);
-	terrain_rendering_pipeline_->AddTextureArray(VK_SHADER_STAGE_VERTEX_BIT, 3, terrain_generator_->GetHeightmaps());
+	terrain_rendering_pipeline_->AddTexture(VK_SHADER_STAGE_VERTEX_BIT, 3, terrain_generator_->GetHeightmapArray());
 	terrain_rendering_pipeline_->AddTexture(VK_SHADER_STAGE_VERTEX_BIT, 4, terrain_generator_->GetWatermap());
 	terrain_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 5, fog_factors_buffer_, sizeof(FogFactors));
 	terrain_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 6, color_data_buffer_, sizeof(ColorDataBuffer));
-	terrain_rendering_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 7, mountain_texture_);
-	terrain_rendering_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 8, sand_texture_);
-	terrain_rendering_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 9, grass_texture_);
+	if (terrain_material_array_)
+	{
+		terrain_rendering_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 7, terrain_materials_);
+	}
+	else
+	{
+		terrain_rendering_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 7, mountain_texture_->Get());
+		terrain_rendering_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 8, sand_texture_->Get());
+		terrain_rendering_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 9, grass_texture_->Get());
+	}
+	terrain_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 10, chunk_placement_buffer_, sizeof(ChunkPlacementData));
 	terrain_rendering_pipeline_->Init(devices_, swap_chain_);
 
+	// create the terrain depth pre-pass pipeline, it only needs the inputs that place the vertices
+	if (terrain_depth_prepass_)
+	{
+		terrain_depth_pipeline_ = new TerrainDepthPipeline();
+		terrain_depth_pipeline_->SetShader(terrain_depth_shader_);
+		terrain_depth_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, camera_buffer_, sizeof(CameraData));
+		terrain_depth_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 1, terrain_render_data_buffer_, sizeof(TerrainRenderData));
+		terrain_depth_pipeline_->AddSampler(VK_SHADER_STAGE_VERTEX_BIT, 2, buffer_normalized_sampler_);
+		terrain_depth_pipeline_->AddTexture(VK_SHADER_STAGE_VERTEX_BIT, 3, terrain_generator_->GetHeightmapArray());
+		terrain_depth_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 10, chunk_placement_buffer_, sizeof(ChunkPlacementData));
+		terrain_depth_pipeline_->Init(devices_, swap_chain_);
+	}
+
+	// create the overdraw query, secondary command buffers can only inherit it with inherited queries enabled
+	const VkPhysicalDeviceFeatures& enabled_features = devices_->GetEnabledFeatures();
+	if (overdraw_stats_ && enabled_features.pipelineStatisticsQuery && (enabled_features.inheritedQueries || !per_frame_recording_))
+	{
+		VkQueryPoolCreateInfo query_pool_info = {};
+		query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		query_pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		query_pool_info.queryCount = 1;
+		query_pool_info.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+		if (vkCreateQueryPool(devices_->GetLogicalDevice(), &query_pool_info, nullptr, &overdraw_query_pool_) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create overdraw query pool!");
+		}
+
+		// the pass is only timed where timestamps are supported, the fragment counts are still reported without them
+		VkPhysicalDeviceProperties device_properties;
+		vkGetPhysicalDeviceProperties(devices_->GetPhysicalDevice(), &device_properties);
+		timestamp_period_ = device_properties.limits.timestampPeriod;
+
+		if (device_properties.limits.timestampComputeAndGraphics)
+		{
+			query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			query_pool_info.queryCount = 2;
+			query_pool_info.pipelineStatistics = 0;
+
+			if (vkCreateQueryPool(devices_->GetLogicalDevice(), &query_pool_info, nullptr, &terrain_timestamp_pool_) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create terrain timestamp query pool!");
+			}
+		}
+	}
+	else if (overdraw_stats_)
+	{
+		std::cout << "Terrain overdraw stats need pipeline statistics queries, which this device does not support" << std::endl;
+	}
+
+	// the render extent is set while the frame is recorded, so the command buffers recorded once here always draw at full resolution
+	if (dynamic_resolution_enabled_ && per_frame_recording_)
+	{
+		dynamic_resolution_ = new DynamicResolution();
+		dynamic_resolution_->Init(devices_, DYNAMIC_RESOLUTION_FRAME_TIME, DYNAMIC_RESOLUTION_MIN_SCALE, DYNAMIC_RESOLUTION_MAX_SCALE);
+	}
+	else if (dynamic_resolution_enabled_)
+	{
+		std::cout << "Dynamic resolution needs per frame recording, the scene will be drawn at full resolution" << std::endl;
+	}
+
+	// create the chunk culling pipeline
+	if (gpu_chunk_culling_)
+	{
+		hiz_pyramid_ = new HiZPyramid();
+		hiz_pyramid_->Init(devices_, swap_chain_);
+
+		chunk_culling_pipeline_ = new ChunkCullingPipeline();
+		chunk_culling_pipeline_->SetShader(chunk_cull_shader_);
+		chunk_culling_pipeline_->AddStorageBuffer(0, chunk_draw_buffer_, sizeof(VkDrawIndexedIndirectCommand));
+		chunk_culling_pipeline_->AddUniformBuffer(1, chunk_cull_buffer_, sizeof(ChunkCullData));
+		chunk_culling_pipeline_->AddTexture(2, hiz_pyramid_->GetImageView());
+		chunk_culling_pipeline_->AddSampler(3, hiz_pyramid_->GetSampler());
+		chunk_culling_pipeline_->AddStorageBuffer(4, chunk_cull_stats_buffer_, sizeof(ChunkCullStats));
+		chunk_culling_pipeline_->AddStorageBuffer(5, chunk_instance_buffer_, sizeof(uint32_t) * TERRAIN_CHUNK_COUNT);
+		chunk_culling_pipeline_->Init(devices_);
+	}
+
 	// create the water rendering pipeline
 	water_rendering_pipeline_ = new WaterRenderingPipeline();
 	water_rendering_pipeline_->SetShader(water_shader_);
-	water_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, water_matrix_buffer_, sizeof(WaterMatrixData));
+	water_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, camera_buffer_, sizeof(CameraData));
 	water_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 1, water_render_data_buffer_, sizeof(WaterRenderData));
 	water_rendering_pipeline_->AddStorageImage(VK_SHADER_STAGE_VERTEX_BIT, 2, terrain_generator_->GetWatermap());
 	water_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 3, fog_factors_buffer_, sizeof(FogFactors));
 	water_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 4, color_data_buffer_, sizeof(ColorDataBuffer));
+	water_rendering_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 5, chunk_placement_buffer_, sizeof(ChunkPlacementData));
 	water_rendering_pipeline_->Init(devices_, swap_chain_);
 
 	// generate the color data
@@ -610,8 +1194,18 @@ void VulkanRenderer::CreateCommandPool()
 void VulkanRenderer::CreateCommandBuffers()
 {
 	CreateBufferVisualisationCommandBuffers();
-	CreateTerrainRenderingCommandBuffers();
-	CreateWaterRenderingCommandBuffers();
+
+	// the scene passes are either recorded every frame or once here
+	if (per_frame_recording_)
+	{
+		command_recorder_ = new CommandRecorder();
+		command_recorder_->Init(devices_);
+	}
+	else
+	{
+		CreateTerrainRenderingCommandBuffers();
+		CreateWaterRenderingCommandBuffers();
+	}
 }
 
 void VulkanRenderer::CreateBufferVisualisationCommandBuffers()
@@ -643,40 +1237,83 @@ void VulkanRenderer::CreateBufferVisualisationCommandBuffers()
 
 void VulkanRenderer::CreateTerrainRenderingCommandBuffers()
 {
-	terrain_rendering_command_buffers_.resize(TERRAIN_CHUNK_COUNT);
-
-	// create render command buffers for each chunk
-	devices_->CreateCommandBuffers(command_pool_, terrain_rendering_command_buffers_.data(), TERRAIN_CHUNK_COUNT);
+	// every visible chunk is drawn by one instanced draw in a single render pass
+	devices_->CreateCommandBuffers(command_pool_, &terrain_rendering_command_buffer_);
 
-	// record the command buffers
+	// record the command buffer
 	VkCommandBufferBeginInfo begin_info = {};
 	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
 	begin_info.pInheritanceInfo = nullptr;
 
-	// record the command buffer for each chunk
-	for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
+	vkBeginCommandBuffer(terrain_rendering_command_buffer_, &begin_info);
+
+	if (gpu_chunk_culling_)
+		RecordChunkCullCommands(terrain_rendering_command_buffer_);
+
+	// lay down the terrain depth with the same draw before shading it
+	if (terrain_depth_prepass_)
 	{
-		vkBeginCommandBuffer(terrain_rendering_command_buffers_[i], &begin_info);
+		terrain_depth_pipeline_->RecordCommands(terrain_rendering_command_buffer_, 0);
+		terrain_mesh_->RecordTerrainInstancedRenderCommands(terrain_rendering_command_buffer_, chunk_instance_buffer_, chunk_draw_buffer_);
+		vkCmdEndRenderPass(terrain_rendering_command_buffer_);
 
-		if (terrain_rendering_pipeline_)
-		{
-			// bind pipeline
-			terrain_rendering_pipeline_->RecordCommands(terrain_rendering_command_buffers_[i], 0);
+		RecordAttachmentBarrier(terrain_rendering_command_buffer_);
+	}
 
-			// render terrain mesh
-			terrain_mesh_->RecordTerrainRenderCommands(terrain_rendering_command_buffers_[i], i);
+	if (terrain_rendering_pipeline_)
+	{
+		BeginOverdrawQuery(terrain_rendering_command_buffer_);
 
-			vkCmdEndRenderPass(terrain_rendering_command_buffers_[i]);
-		}
+		// bind pipeline
+		terrain_rendering_pipeline_->RecordCommands(terrain_rendering_command_buffer_, 0);
 
-		if (vkEndCommandBuffer(terrain_rendering_command_buffers_[i]) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to record render command buffer!");
-		}
+		// render every visible chunk as an instance of the terrain mesh
+		terrain_mesh_->RecordTerrainInstancedRenderCommands(terrain_rendering_command_buffer_, chunk_instance_buffer_, chunk_draw_buffer_);
+
+		vkCmdEndRenderPass(terrain_rendering_command_buffer_);
+
+		EndOverdrawQuery(terrain_rendering_command_buffer_);
+	}
+
+	// build next frame's occlusion pyramid from the terrain depth before the water is drawn over it
+	if (gpu_chunk_culling_)
+		hiz_pyramid_->RecordBuildCommands(terrain_rendering_command_buffer_);
+
+	if (vkEndCommandBuffer(terrain_rendering_command_buffer_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record render command buffer!");
 	}
 }
 
+void VulkanRenderer::RecordChunkCullCommands(VkCommandBuffer& command_buffer)
+{
+	// the previous frame's draw must finish reading the chunk list before it is rewritten
+	VkBufferMemoryBarrier barriers[2] = {};
+	barriers[0].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barriers[0].srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].buffer = chunk_draw_buffer_;
+	barriers[0].offset = 0;
+	barriers[0].size = VK_WHOLE_SIZE;
+
+	barriers[1] = barriers[0];
+	barriers[1].srcAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	barriers[1].buffer = chunk_instance_buffer_;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 2, barriers, 0, nullptr);
+
+	// cull the chunks
+	chunk_culling_pipeline_->RecordCommands(command_buffer);
+
+	barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	barriers[1].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 2, barriers, 0, nullptr);
+}
+
 void VulkanRenderer::CreateWaterRenderingCommandBuffers()
 {
 	// create the render command buffer
@@ -713,11 +1350,26 @@ void VulkanRenderer::CreateShaders()
 	buffer_visualisation_shader_ = new VulkanShader();
 	buffer_visualisation_shader_->Init(devices_, swap_chain_, "../res/shaders/buffer_visualisation.vert.spv", "", "", "", "../res/shaders/buffer_visualisation.frag.spv");
 
-	terrain_shader_ = new VulkanShader();
-	terrain_shader_->Init(devices_, swap_chain_, "../res/shaders/terrain.vert.spv", "", "", "", "../res/shaders/terrain.frag.spv");
+	// with the pre-pass the shaded pass only draws the fragments whose depth matches
+	terrain_shader_ = new TerrainShader();
+	terrain_shader_->SetPass(terrain_depth_prepass_ ? TERRAIN_SHADER_PASS_DEPTH_EQUAL : TERRAIN_SHADER_PASS_FULL);
+	if (terrain_material_array_)
+		terrain_shader_->Init(devices_, swap_chain_, "../res/shaders/terrain.vert.spv", "", "", "", "../res/shaders/terrain_materials.frag.spv");
+	else
+		terrain_shader_->Init(devices_, swap_chain_, "../res/shaders/terrain.vert.spv", "", "", "", "../res/shaders/terrain.frag.spv");
+
+	if (terrain_depth_prepass_)
+	{
+		terrain_depth_shader_ = new TerrainShader();
+		terrain_depth_shader_->SetPass(TERRAIN_SHADER_PASS_DEPTH_ONLY);
+		terrain_depth_shader_->Init(devices_, swap_chain_, "../res/shaders/terrain_depth.vert.spv", "", "", "", "");
+	}
 
 	water_shader_ = new VulkanShader();
 	water_shader_->Init(devices_, swap_chain_, "../res/shaders/water_render.vert.spv", "", "", "", "../res/shaders/water_render.frag.spv");
+
+	chunk_cull_shader_ = new VulkanComputeShader();
+	chunk_cull_shader_->Init(devices_, swap_chain_, "../res/shaders/chunk_cull.comp.spv");
 }
 
 void VulkanRenderer::CreateSemaphores()
@@ -727,7 +1379,8 @@ void VulkanRenderer::CreateSemaphores()
 
 	if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &terrain_rendering_semaphore_) != VK_SUCCESS ||
 		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &water_rendering_semaphore_) != VK_SUCCESS ||
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &visualisation_semaphore_) != VK_SUCCESS)
+		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &visualisation_semaphore_) != VK_SUCCESS ||
+		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &scene_rendering_semaphore_) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create semaphores!");
 	}
@@ -736,11 +1389,27 @@ void VulkanRenderer::CreateSemaphores()
 void VulkanRenderer::CreateBuffers()
 {
 	// create the terrain rendering buffers
-	devices_->CreateBuffer(sizeof(TerrainMatrixData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, terrain_matrix_buffer_, terrain_matrix_buffer_memory_);
+	devices_->CreateBuffer(sizeof(CameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, camera_buffer_, camera_buffer_memory_);
+	devices_->CreateBuffer(sizeof(ChunkPlacementData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, chunk_placement_buffer_, chunk_placement_buffer_memory_);
 	devices_->CreateBuffer(sizeof(TerrainLODFactors), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, terrain_lod_factors_buffer_, terrain_lod_factors_buffer_memory_);
 	devices_->CreateBuffer(sizeof(TerrainRenderData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, terrain_render_data_buffer_, terrain_render_data_buffer_memory_);
 	devices_->CreateBuffer(sizeof(FogFactors), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, fog_factors_buffer_, fog_factors_buffer_memory_);
-	devices_->CreateBuffer(sizeof(WaterMatrixData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, water_matrix_buffer_, water_matrix_buffer_memory_);
 	devices_->CreateBuffer(sizeof(WaterRenderData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, water_render_data_buffer_, water_render_data_buffer_memory_);
 	devices_->CreateBuffer(sizeof(ColorDataBuffer), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, color_data_buffer_, color_data_buffer_memory_);
+
+	// create the chunk culling buffers
+	devices_->CreateBuffer(sizeof(ChunkCullData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, chunk_cull_buffer_, chunk_cull_buffer_memory_);
+
+	// the visible chunk list and its draw are written by the cull pass, or mapped and written by the cpu without it
+	VkMemoryPropertyFlags chunk_list_properties = gpu_chunk_culling_ ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	devices_->CreateBuffer(sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, chunk_list_properties, chunk_draw_buffer_, chunk_draw_buffer_memory_);
+	devices_->CreateBuffer(sizeof(uint32_t) * TERRAIN_CHUNK_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, chunk_list_properties, chunk_instance_buffer_, chunk_instance_buffer_memory_);
+
+	// the cull statistics stay mapped so they can be read every frame
+	devices_->CreateBuffer(sizeof(ChunkCullStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, chunk_cull_stats_buffer_, chunk_cull_stats_buffer_memory_);
+
+	void* stats_data;
+	vkMapMemory(devices_->GetLogicalDevice(), chunk_cull_stats_buffer_memory_, 0, sizeof(ChunkCullStats), 0, &stats_data);
+	chunk_cull_stats_ = static_cast<ChunkCullStats*>(stats_data);
+	memset(chunk_cull_stats_, 0, sizeof(ChunkCullStats));
 }
\ No newline at end of file
@@ -8,12 +8,20 @@
 #include "device.h"
 #include "swap_chain.h"
 #include "shader.h"
+#include "terrain_shader.h"
 #include "texture_cache.h"
+#include "texture_array.h"
 #include "camera.h"
+#include "frustum.h"
+#include "hiz_pyramid.h"
+#include "command_recorder.h"
+#include "dynamic_resolution.h"
 #include "compute_shader.h"
 #include "pipelines\buffer_visualisation_pipeline.h"
 #include "pipelines\terrain_rendering_pipeline.h"
+#include "pipelines\terrain_depth_pipeline.h"
 #include "pipelines\water_rendering_pipeline.h"
+#include "pipelines\chunk_culling_pipeline.h"
 #include "terrain_generator.h"
 #include "skybox.h"
 #include "HDR.h"
@@ -38,7 +46,7 @@ class VulkanRenderer
 public:
 	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain);
 	void InitPipelines();
-	void RenderScene();
+	void RenderScene(float frame_time);
 	void Cleanup();
 	
 	void RecreateSwapChainFeatures();
@@ -54,6 +62,7 @@ public:
 	inline std::string GetTextureDirectory() { return texture_directory_; }
 
 	inline VkSemaphore GetRenderSemaphore() { return render_semaphore_; }
+	inline HDR* GetHDR() { return hdr_; }
 	inline VulkanTextureCache*	GetTextureCache() { return texture_cache_; }
 
 	
@@ -75,7 +84,24 @@ protected:
 	void RenderVisualisation();
 	void RenderTerrain();
 	void RenderWater();
-	std::vector<VkCommandBuffer> CheckTerrainVisibility();
+	void RenderSceneCommands(float frame_time);
+	void UpdateTerrainCulling();
+	void RecordChunkCullCommands(VkCommandBuffer& command_buffer);
+	VkCommandBuffer RecordSkyboxCommands(uint32_t worker_index);
+	VkCommandBuffer RecordTerrainCommands(uint32_t worker_index, TerrainRenderingPipeline* pipeline, VkQueryPipelineStatisticFlags pipeline_statistics);
+	VkCommandBuffer RecordWaterCommands(uint32_t worker_index);
+	void RecordAttachmentBarrier(VkCommandBuffer& command_buffer);
+	void BeginOverdrawQuery(VkCommandBuffer& command_buffer);
+	void EndOverdrawQuery(VkCommandBuffer& command_buffer);
+	void ReportOverdrawStats();
+	void UpdateTerrainChunkBounds();
+	void RebindTerrainTextures();
+	void UpdateChunkPlacement();
+	void UploadStaticData();
+	void ReportUploadStats();
+	bool IsCameraCut();
+	void ReportChunkCullStats();
+	void CheckTerrainVisibility();
 
 protected:
 	VulkanDevices* devices_;
@@ -89,31 +115,98 @@ protected:
 
 	// terrain rendering components
 	Mesh* terrain_mesh_;
-	VulkanShader* terrain_shader_;
+	TerrainShader* terrain_shader_;
 	TerrainRenderingPipeline* terrain_rendering_pipeline_;
-	std::vector<VkCommandBuffer> terrain_rendering_command_buffers_;
-	VkBuffer terrain_matrix_buffer_, terrain_lod_factors_buffer_, terrain_render_data_buffer_, fog_factors_buffer_, color_data_buffer_;
-	VkDeviceMemory terrain_matrix_buffer_memory_, terrain_lod_factors_buffer_memory_, terrain_render_data_buffer_memory_, fog_factors_buffer_memory_, color_data_buffer_memory_;
+	VkCommandBuffer terrain_rendering_command_buffer_;
+
+	// optional depth only terrain pass, the shaded pass then tests for equal depth
+	bool terrain_depth_prepass_;
+	TerrainShader* terrain_depth_shader_;
+	TerrainDepthPipeline* terrain_depth_pipeline_;
+
+	// fragments shaded by the terrain pass, counted with a pipeline statistics query, and the pass's gpu time from timestamps
+	bool overdraw_stats_;
+	VkQueryPool overdraw_query_pool_, terrain_timestamp_pool_;
+	float timestamp_period_;
+	uint64_t total_fragment_invocations_;
+	double total_terrain_pass_time_;
+	uint32_t overdraw_frame_count_;
+
+	// dynamic resolution, the scene is drawn into a scaled part of the intermediate image to keep its gpu time in budget
+	bool dynamic_resolution_enabled_;
+	DynamicResolution* dynamic_resolution_;
+	VkBuffer terrain_lod_factors_buffer_, terrain_render_data_buffer_, fog_factors_buffer_, color_data_buffer_;
+	VkDeviceMemory terrain_lod_factors_buffer_memory_, terrain_render_data_buffer_memory_, fog_factors_buffer_memory_, color_data_buffer_memory_;
+
+	// uniform data is split by how often it changes, the camera every frame and the chunk placement on chunk moves
+	VkBuffer camera_buffer_, chunk_placement_buffer_;
+	VkDeviceMemory camera_buffer_memory_, chunk_placement_buffer_memory_;
+	CameraData camera_data_;
+	ChunkPlacementData chunk_placement_data_;
 	
 	// water rendering components
 	Mesh* water_mesh_;
 	VulkanShader* water_shader_;
 	WaterRenderingPipeline* water_rendering_pipeline_;
 	VkCommandBuffer water_rendering_command_buffer_;
-	VkBuffer water_matrix_buffer_, water_render_data_buffer_;
-	VkDeviceMemory water_matrix_buffer_memory_, water_render_data_buffer_memory_;
+	VkBuffer water_render_data_buffer_;
+	VkDeviceMemory water_render_data_buffer_memory_;
+
+	// per frame recording, the skybox, terrain and water draws are recorded on worker threads and executed by one primary buffer
+	bool per_frame_recording_;
+	CommandRecorder* command_recorder_;
+	VkSemaphore scene_rendering_semaphore_;
 
 	Skybox* skybox_;
 	HDR* hdr_;
 	TerrainGenerator* terrain_generator_;
 	int current_chunk_x_, current_chunk_y_;
-	TerrainMatrixData terrain_matrix_data_;
+
+	// terrain chunk culling
+	Frustum view_frustum_;
+	AABBList terrain_chunk_bounds_;
+	bool chunk_bounds_dirty_;
+	std::vector<uint8_t> terrain_chunk_visibility_;
+
+	// the visible chunk indices are the instance buffer of a single indirect terrain draw
+	VkBuffer chunk_draw_buffer_, chunk_instance_buffer_;
+	VkDeviceMemory chunk_draw_buffer_memory_, chunk_instance_buffer_memory_;
+
+	// gpu chunk culling, a compute pass writes the visible chunk list at the start of the terrain command buffer
+	bool gpu_chunk_culling_;
+	VulkanComputeShader* chunk_cull_shader_;
+	ChunkCullingPipeline* chunk_culling_pipeline_;
+	VkBuffer chunk_cull_buffer_;
+	VkDeviceMemory chunk_cull_buffer_memory_;
+
+	// occlusion culling against last frame's terrain depth, skipped for a frame whenever the history is unusable
+	HiZPyramid* hiz_pyramid_;
+	bool hiz_history_valid_;
+	glm::mat4 previous_view_projection_;
+	glm::vec3 previous_camera_position_, previous_view_direction_;
+	glm::vec2 previous_hiz_uv_scale_;
+	VkBuffer chunk_cull_stats_buffer_;
+	VkDeviceMemory chunk_cull_stats_buffer_memory_;
+	ChunkCullStats* chunk_cull_stats_;
+	bool cull_stats_;
+	uint64_t total_chunks_tested_, total_frustum_culled_, total_occlusion_culled_;
+	uint32_t cull_stats_frame_count_;
+
+	// host upload measurement
+	bool upload_stats_;
+	uint64_t upload_stats_start_bytes_;
+	uint32_t upload_stats_frame_count_;
 
 	Camera* render_camera_;
 	Texture* default_texture_;
-	Texture* mountain_texture_;
-	Texture* sand_texture_;
-	Texture* grass_texture_;
+
+	// the terrain materials either as one array image or as separately loaded textures
+	bool terrain_material_array_;
+	TextureArray* terrain_materials_;
+	TextureHandle* mountain_texture_;
+	TextureHandle* sand_texture_;
+	TextureHandle* grass_texture_;
+
 	VkSampler buffer_unnormalized_sampler_, buffer_normalized_sampler_, shadow_map_sampler_;
 
 	VkQueue graphics_queue_;
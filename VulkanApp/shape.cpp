@@ -21,6 +21,7 @@ void Shape::InitShape(VulkanDevices* devices, std::vector<Vertex>& vertices, std
 	
 	CreateVertexBuffer(vertices);
 	CreateIndexBuffer(indices);
+	UploadBufferData(vertices, indices);
 }
 
 void Shape::CleanUp()
@@ -40,25 +41,6 @@ void Shape::CreateVertexBuffer(std::vector<Vertex>& vertices)
 
 	// create the vertex buffer
 	devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertex_buffer_, vertex_buffer_memory_);
-
-	// create a staging buffer to copy the data from
-	VkBuffer staging_buffer;
-	VkDeviceMemory staging_buffer_memory;
-
-	devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, staging_buffer, staging_buffer_memory);
-		
-	// copy the data to the staging buffer
-	void* data;
-	vkMapMemory(devices_->GetLogicalDevice(), staging_buffer_memory, 0, buffer_size, 0, &data);
-	memcpy(data, vertices.data(), (size_t)buffer_size);
-	vkUnmapMemory(devices_->GetLogicalDevice(), staging_buffer_memory);
-
-	// copy the data from the staging buffer to the vertex buffer
-	devices_->CopyBuffer(staging_buffer, vertex_buffer_, buffer_size);
-
-	// clean up the staging buffer now that it is no longer needed
-	vkDestroyBuffer(devices_->GetLogicalDevice(), staging_buffer, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), staging_buffer_memory, nullptr);
 }
 
 void Shape::CreateIndexBuffer(std::vector<uint32_t>& indices)
@@ -68,25 +50,37 @@ void Shape::CreateIndexBuffer(std::vector<uint32_t>& indices)
 
 	// create the index buffer
 	devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, index_buffer_, index_buffer_memory_);
+}
+
+void Shape::UploadBufferData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	VkDeviceSize vertex_data_size = sizeof(vertices[0]) * vertices.size();
+	VkDeviceSize index_data_size = sizeof(indices[0]) * indices.size();
 
-	// create a staging buffer to copy the data from
-	VkBuffer staging_buffer;
-	VkDeviceMemory staging_buffer_memory;
+	// use the calling thread's staging memory so shapes can be uploaded in parallel
+	TransferContext* transfer_context = devices_->GetTransferContext();
+	char* staging_data = (char*)devices_->ReserveStagingMemory(transfer_context, vertex_data_size + index_data_size);
 
-	devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, staging_buffer, staging_buffer_memory);
+	// copy the vertex and index data to the staging buffer
+	memcpy(staging_data, vertices.data(), (size_t)vertex_data_size);
+	memcpy(staging_data + vertex_data_size, indices.data(), (size_t)index_data_size);
 
-	// copy the data to the staging buffer
-	void* data;
-	vkMapMemory(devices_->GetLogicalDevice(), staging_buffer_memory, 0, buffer_size, 0, &data);
-	memcpy(data, indices.data(), (size_t)buffer_size);
-	vkUnmapMemory(devices_->GetLogicalDevice(), staging_buffer_memory);
+	// copy both buffers in a single submission
+	VkCommandBuffer command_buffer = devices_->BeginTransfer(transfer_context);
 
-	// copy the data from the staging buffer to the vertex buffer
-	devices_->CopyBuffer(staging_buffer, index_buffer_, buffer_size);
+	VkBufferCopy vertex_copy_region = {};
+	vertex_copy_region.srcOffset = 0;
+	vertex_copy_region.dstOffset = 0;
+	vertex_copy_region.size = vertex_data_size;
+	vkCmdCopyBuffer(command_buffer, transfer_context->staging_buffer, vertex_buffer_, 1, &vertex_copy_region);
 
-	// clean up the staging buffer now that it is no longer needed
-	vkDestroyBuffer(devices_->GetLogicalDevice(), staging_buffer, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), staging_buffer_memory, nullptr);
+	VkBufferCopy index_copy_region = {};
+	index_copy_region.srcOffset = vertex_data_size;
+	index_copy_region.dstOffset = 0;
+	index_copy_region.size = index_data_size;
+	vkCmdCopyBuffer(command_buffer, transfer_context->staging_buffer, index_buffer_, 1, &index_copy_region);
+
+	devices_->EndTransfer(transfer_context);
 }
 
 void Shape::RecordRenderCommands(VkCommandBuffer& command_buffer)
@@ -111,4 +105,39 @@ void Shape::RecordTerrainRenderCommands(VkCommandBuffer& command_buffer, int ins
 
 	// execute a draw command
 	vkCmdDrawIndexed(command_buffer, index_count_, 1, 0, 0, instance_index);
+}
+
+void Shape::RecordIndirectRenderCommands(VkCommandBuffer& command_buffer, VkBuffer indirect_buffer, uint32_t draw_count)
+{
+	// bind the vertex and index buffers
+	VkBuffer vertex_buffers[] = { vertex_buffer_ };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+	vkCmdBindIndexBuffer(command_buffer, index_buffer_, 0, VK_INDEX_TYPE_UINT32);
+
+	// execute every draw range in a single command when the device allows it
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	if (devices_->GetEnabledFeatures().multiDrawIndirect)
+	{
+		vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer, 0, draw_count, stride);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < draw_count; i++)
+		{
+			vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer, i * stride, 1, stride);
+		}
+	}
+}
+
+void Shape::RecordInstancedIndirectRenderCommands(VkCommandBuffer& command_buffer, VkBuffer instance_buffer, VkBuffer indirect_buffer)
+{
+	// bind the vertex buffer alongside the per instance buffer
+	VkBuffer vertex_buffers[] = { vertex_buffer_, instance_buffer };
+	VkDeviceSize offsets[] = { 0, 0 };
+	vkCmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers, offsets);
+	vkCmdBindIndexBuffer(command_buffer, index_buffer_, 0, VK_INDEX_TYPE_UINT32);
+
+	// a single draw whose instance count is written into the indirect buffer
+	vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
 }
\ No newline at end of file
@@ -20,13 +20,18 @@ public:
 	void InitShape(VulkanDevices* devices, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
 	void RecordRenderCommands(VkCommandBuffer& command_buffer);
 	void RecordTerrainRenderCommands(VkCommandBuffer& command_buffer, int instance_index);
+	void RecordIndirectRenderCommands(VkCommandBuffer& command_buffer, VkBuffer indirect_buffer, uint32_t draw_count);
+	void RecordInstancedIndirectRenderCommands(VkCommandBuffer& command_buffer, VkBuffer instance_buffer, VkBuffer indirect_buffer);
 	void CleanUp();
+
+	inline uint32_t GetIndexCount() { return index_count_; }
 	
 
 protected:
 	
 	void CreateVertexBuffer(std::vector<Vertex>& vertices);
 	void CreateIndexBuffer(std::vector<uint32_t>& indices);
+	void UploadBufferData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
 
 protected:
 	VulkanDevices* devices_;
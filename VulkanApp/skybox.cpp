@@ -205,7 +205,7 @@ void Skybox::Cleanup()
 	vkDestroySemaphore(devices_->GetLogicalDevice(), render_semaphore_, nullptr);
 }
 
-void Skybox::Render(Camera* camera)
+void Skybox::Update(Camera* camera)
 {
 	// copy the matrix data to the buffer
 	UniformBufferObject ubo = {};
@@ -214,7 +214,16 @@ void Skybox::Render(Camera* camera)
 	ubo.proj = camera->GetProjectionMatrix();
 
 	devices_->CopyDataToBuffer(matrix_buffer_memory_, &ubo, sizeof(UniformBufferObject));
-	
+
+	// only does anything when the mesh was built with meshlets
+	skybox_mesh_->UpdateWorldMatrix(ubo.model);
+	skybox_mesh_->UpdateMeshletCulling(camera);
+}
+
+void Skybox::Render(Camera* camera)
+{
+	Update(camera);
+
 
 	// submit the draw command buffer
 	VkSubmitInfo submit_info = {};
@@ -239,6 +248,18 @@ void Skybox::Render(Camera* camera)
 	}
 }
 
+void Skybox::RecordRenderCommands(VkCommandBuffer& command_buffer)
+{
+	skybox_pipeline_->RecordBindCommands(command_buffer);
+
+	skybox_mesh_->RecordRenderCommands(command_buffer);
+}
+
+void Skybox::RecordCullCommands(VkCommandBuffer& command_buffer)
+{
+	skybox_mesh_->RecordMeshletCullCommands(command_buffer);
+}
+
 void Skybox::InitPipeline(VulkanDevices* devices, VulkanSwapChain* swap_chain, VkBuffer color_data_buffer)
 {
 	// create the render semaphore
@@ -288,6 +309,8 @@ void Skybox::InitCommandBuffer(VkCommandPool command_pool)
 
 	vkBeginCommandBuffer(skybox_command_buffer_, &begin_info);
 
+	RecordCullCommands(skybox_command_buffer_);
+
 	skybox_pipeline_->RecordCommands(skybox_command_buffer_, 0);
 
 	skybox_mesh_->RecordRenderCommands(skybox_command_buffer_);
@@ -308,5 +331,5 @@ void Skybox::InitResources()
 
 	// init the skybox mesh
 	skybox_mesh_ = new Mesh();
-	skybox_mesh_->CreateModelMesh(devices_, "../res/models/skybox.obj");
+	skybox_mesh_->CreateModelMesh(devices_, "../res/models/skybox.obj", true);
 }
\ No newline at end of file
@@ -21,8 +21,17 @@ class Skybox
 public:
 	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VkCommandPool command_pool, VkBuffer color_data_buffer);
 	void Cleanup();
+	void Update(Camera* camera);
 	void Render(Camera* camera);
 
+	// records the skybox draw into a command buffer that is already inside the skybox render pass
+	void RecordRenderCommands(VkCommandBuffer& command_buffer);
+
+	// records the mesh's meshlet cull pass, must be outside of a render pass and before the draw
+	void RecordCullCommands(VkCommandBuffer& command_buffer);
+
+	inline SkyboxPipeline* GetPipeline() { return skybox_pipeline_; }
+
 	inline VkSemaphore GetRenderSemaphore() { return render_semaphore_; }
 
 protected:
@@ -129,12 +129,12 @@ void VulkanSwapChain::FinalizeIntermediateImage()
 	devices_->TransitionImageLayout(swap_chain_images_[current_image_index_], swap_chain_image_format_, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 	devices_->TransitionImageLayout(intermediate_image_, intermediate_image_format_, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
 
-	// start the copy command buffer
+	// start the copy command buffer, the linear filter scales a reduced render extent up to the swap chain
 	VkCommandBuffer blit_buffer = devices_->BeginSingleTimeCommands();
 
 	VkImageBlit image_blit = {};
 	image_blit.srcOffsets[0] = { 0, 0, 0 };
-	image_blit.srcOffsets[1] = { (int)swap_chain_extent_.width, (int)swap_chain_extent_.height, 1 };
+	image_blit.srcOffsets[1] = { (int)render_extent_.width, (int)render_extent_.height, 1 };
 	image_blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	image_blit.srcSubresource.baseArrayLayer = 0;
 	image_blit.srcSubresource.layerCount = 1;
@@ -163,12 +163,12 @@ void VulkanSwapChain::CopyToIntermediateImage(VkImage image, VkImageLayout image
 	devices_->TransitionImageLayout(image, intermediate_image_format_, image_layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
 	devices_->TransitionImageLayout(intermediate_image_, intermediate_image_format_, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-	// start the copy command buffer
+	// start the copy command buffer, the linear filter scales a reduced render extent up to the swap chain
 	VkCommandBuffer blit_buffer = devices_->BeginSingleTimeCommands();
 
 	VkImageBlit image_blit = {};
 	image_blit.srcOffsets[0] = { 0, 0, 0 };
-	image_blit.srcOffsets[1] = { (int)swap_chain_extent_.width, (int)swap_chain_extent_.height, 1 };
+	image_blit.srcOffsets[1] = { (int)render_extent_.width, (int)render_extent_.height, 1 };
 	image_blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	image_blit.srcSubresource.baseArrayLayer = 0;
 	image_blit.srcSubresource.layerCount = 1;
@@ -286,6 +286,7 @@ void VulkanSwapChain::CreateSwapChain(VulkanDevices* devices)
 
 	swap_chain_image_format_ = surface_format.format;
 	swap_chain_extent_ = extent;
+	render_extent_ = extent;
 
 	// transition the swap chain images to the correct format
 	for (int i = 0; i < swap_chain_images_.size(); i++)
@@ -327,7 +328,7 @@ void VulkanSwapChain::CreateDepthResources()
 {
 	depth_format_ = FindDepthFormat();
 
-	devices_->CreateImage(swap_chain_extent_.width, swap_chain_extent_.height, depth_format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depth_image_, depth_image_memory_);
+	devices_->CreateImage(swap_chain_extent_.width, swap_chain_extent_.height, depth_format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depth_image_, depth_image_memory_);
 	depth_image_view_ = devices_->CreateImageView(depth_image_, depth_format_, VK_IMAGE_ASPECT_DEPTH_BIT);
 
 	devices_->TransitionImageLayout(depth_image_, depth_format_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
@@ -402,6 +403,6 @@ VkFormat VulkanSwapChain::FindDepthFormat()
 	return devices_->FindSupportedFormat(
 	{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
 		);
 }
\ No newline at end of file
@@ -33,8 +33,13 @@ public:
 	inline VkFormat GetSwapChainImageFormat() { return swap_chain_image_format_; }
 	inline VkFormat GetIntermediateImageFormat() { return intermediate_image_format_; }
 	inline VkExtent2D GetSwapChainExtent() { return swap_chain_extent_; }
+
+	// the scene is drawn into the top left of the intermediate image at the render extent and scaled up when it is finalized
+	inline void SetRenderExtent(VkExtent2D extent) { render_extent_ = extent; }
+	inline VkExtent2D GetRenderExtent() { return render_extent_; }
 	inline VkImage GetDepthImage() { return depth_image_; }
 	inline VkImageView GetDepthImageView() { return depth_image_view_; }
+	inline VkFormat GetDepthFormat() { return depth_format_; }
 
 protected:
 	void CreateSurface();
@@ -65,6 +70,7 @@ protected:
 	VkFormat swap_chain_image_format_;
 	VkFormat intermediate_image_format_;
 	VkExtent2D swap_chain_extent_;
+	VkExtent2D render_extent_;
 
 	// depth buffer components
 	VkImage depth_image_;
@@ -2,6 +2,7 @@
 #include <chrono>
 #include <math.h>
 #include <iostream>
+#include <algorithm>
 
 TerrainGenerator::TerrainGenerator()
 {
@@ -45,22 +46,40 @@ void TerrainGenerator::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain,
 void TerrainGenerator::Cleanup()
 {
 	// clean up buffers
-	vkDestroyBuffer(devices_->GetLogicalDevice(), heightmap_data_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), heightmap_data_buffer_memory_, nullptr);
 	vkDestroyBuffer(devices_->GetLogicalDevice(), watermap_data_buffer_, nullptr);
 	vkFreeMemory(devices_->GetLogicalDevice(), watermap_data_buffer_memory_, nullptr);
+	vkDestroyBuffer(devices_->GetLogicalDevice(), height_pyramid_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), height_pyramid_buffer_memory_, nullptr);
+	vkUnmapMemory(devices_->GetLogicalDevice(), height_readback_buffer_memory_);
+	vkDestroyBuffer(devices_->GetLogicalDevice(), height_readback_buffer_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), height_readback_buffer_memory_, nullptr);
 
 	// clean up heightmap image
+	vkDestroyImageView(devices_->GetLogicalDevice(), heightmap_array_view_, nullptr);
+	vkDestroyImage(devices_->GetLogicalDevice(), heightmap_image_, nullptr);
+	vkFreeMemory(devices_->GetLogicalDevice(), heightmap_image_memory_, nullptr);
+
 	for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
 	{
-		vkDestroyImage(devices_->GetLogicalDevice(), heightmap_images_[i], nullptr);
 		vkDestroyImageView(devices_->GetLogicalDevice(), heightmap_image_views_[i], nullptr);
-		vkFreeMemory(devices_->GetLogicalDevice(), heightmap_image_memorys_[i], nullptr);
 
 		// clean up pipelines
 		heightmap_generation_pipelines_[i]->CleanUp();
 		delete heightmap_generation_pipelines_[i];
 		heightmap_generation_pipelines_[i] = nullptr;
+
+		height_pyramid_reduce_pipelines_[i]->CleanUp();
+		delete height_pyramid_reduce_pipelines_[i];
+		height_pyramid_reduce_pipelines_[i] = nullptr;
+
+		height_pyramid_levels_pipelines_[i]->CleanUp();
+		delete height_pyramid_levels_pipelines_[i];
+		height_pyramid_levels_pipelines_[i] = nullptr;
+
+		vkDestroyFence(devices_->GetLogicalDevice(), height_readback_fences_[i], nullptr);
+
+		vkDestroyBuffer(devices_->GetLogicalDevice(), heightmap_data_buffers_[i], nullptr);
+		vkFreeMemory(devices_->GetLogicalDevice(), heightmap_data_buffer_memories_[i], nullptr);
 	}
 
 	// clean up watermap image
@@ -86,6 +105,14 @@ void TerrainGenerator::Cleanup()
 	delete watermap_generation_shader_;
 	watermap_generation_shader_ = nullptr;
 
+	height_pyramid_reduce_shader_->Cleanup();
+	delete height_pyramid_reduce_shader_;
+	height_pyramid_reduce_shader_ = nullptr;
+
+	height_pyramid_levels_shader_->Cleanup();
+	delete height_pyramid_levels_shader_;
+	height_pyramid_levels_shader_ = nullptr;
+
 	// clean up semaphore
 	vkDestroySemaphore(devices_->GetLogicalDevice(), heightmap_generation_semaphore_, nullptr);
 	vkDestroySemaphore(devices_->GetLogicalDevice(), watermap_generation_sempahore_, nullptr);
@@ -93,8 +120,14 @@ void TerrainGenerator::Cleanup()
 
 void TerrainGenerator::GenerateHeightmap(int index)
 {
-	// update the terrain generation buffer with the new data
-	devices_->CopyDataToBuffer(heightmap_data_buffer_memory_, &fbm_generation_data_, generation_data_size_);
+	// collect the chunk's previous readback so its fence can be reused
+	if (height_readback_pending_[index])
+		ReadHeightPyramid(index);
+
+	vkResetFences(devices_->GetLogicalDevice(), 1, &height_readback_fences_[index]);
+
+	// update the chunk's generation buffer with the new data, the chunk's previous dispatch has finished reading it
+	devices_->CopyDataToBuffer(heightmap_data_buffer_memories_[index], &fbm_generation_data_, generation_data_size_);
 
 	// submit the draw command buffer
 	VkSubmitInfo submit_info = {};
@@ -112,13 +145,14 @@ void TerrainGenerator::GenerateHeightmap(int index)
 
 	auto begin = std::chrono::high_resolution_clock::now();
 
-	VkResult result = vkQueueSubmit(compute_queue_, 1, &submit_info, VK_NULL_HANDLE);
+	// the fence marks when the pyramid readback has landed
+	VkResult result = vkQueueSubmit(compute_queue_, 1, &submit_info, height_readback_fences_[index]);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to submit heightmap generation command buffer!");
 	}
 
-	vkQueueWaitIdle(compute_queue_);
+	height_readback_pending_[index] = true;
 
 	auto end = std::chrono::high_resolution_clock::now();
 
@@ -128,6 +162,74 @@ void TerrainGenerator::GenerateHeightmap(int index)
 	//std::cout << "\n";
 }
 
+bool TerrainGenerator::UpdateHeightBounds()
+{
+	bool bounds_changed = false;
+
+	// only take readbacks the gpu has finished, never wait here
+	for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
+	{
+		if (height_readback_pending_[i] && vkGetFenceStatus(devices_->GetLogicalDevice(), height_readback_fences_[i]) == VK_SUCCESS)
+		{
+			ReadHeightPyramid(i);
+			bounds_changed = true;
+		}
+	}
+
+	return bounds_changed;
+}
+
+void TerrainGenerator::ReadHeightPyramid(int index)
+{
+	vkWaitForFences(devices_->GetLogicalDevice(), 1, &height_readback_fences_[index], VK_TRUE, UINT64_MAX);
+	height_readback_pending_[index] = false;
+
+	// copy the chunk's tiles out of the mapped readback buffer
+	ChunkHeightTable& table = chunk_height_tables_[index];
+	const HeightPyramidTile* tiles = height_readback_data_ + (index * height_readback_tile_count_);
+	table.tiles.assign(tiles, tiles + height_readback_tile_count_);
+
+	// the last tile covers the whole chunk
+	const HeightPyramidTile& chunk_tile = table.tiles.back();
+	table.height_bounds = glm::vec2(chunk_tile.min_height, chunk_tile.max_height);
+
+	// roughness is the mean standard deviation of the finest readback tiles
+	uint32_t level_size = HeightPyramidPipeline::GetLevelSize(HEIGHT_PYRAMID_READBACK_LEVEL);
+	uint32_t level_tile_count = level_size * level_size;
+	float deviation_sum = 0.0f;
+	for (uint32_t i = 0; i < level_tile_count; i++)
+	{
+		const HeightPyramidTile& tile = table.tiles[i];
+		deviation_sum += sqrtf(std::max(0.0f, tile.mean_square_height - tile.mean_height * tile.mean_height));
+	}
+	table.roughness = deviation_sum / (float)level_tile_count;
+}
+
+glm::vec2 TerrainGenerator::GetTileHeightBounds(int index, int level, int x, int y)
+{
+	const ChunkHeightTable& table = chunk_height_tables_[index];
+	if (level < HEIGHT_PYRAMID_READBACK_LEVEL || table.tiles.empty())
+		return table.height_bounds;
+
+	uint32_t level_size = HeightPyramidPipeline::GetLevelSize(level);
+	uint32_t tile_index = HeightPyramidPipeline::GetLevelOffset(level) - height_readback_tile_offset_ + x + (y * level_size);
+
+	const HeightPyramidTile& tile = table.tiles[tile_index];
+	return glm::vec2(tile.min_height, tile.max_height);
+}
+
+void TerrainGenerator::ShiftHeightBounds(int src_index, int dst_index)
+{
+	// both chunks must have landed before their tables are moved
+	if (height_readback_pending_[src_index])
+		ReadHeightPyramid(src_index);
+
+	if (height_readback_pending_[dst_index])
+		ReadHeightPyramid(dst_index);
+
+	chunk_height_tables_[dst_index] = chunk_height_tables_[src_index];
+}
+
 void TerrainGenerator::GenerateWatermap()
 {
 	// update the terrain generation buffer with the new data
@@ -180,7 +282,8 @@ void TerrainGenerator::MoveLeft(int current_chunk_x, int current_chunk_y)
 			int src_index = x + (y * TERRAIN_CHUNK_SIZE);
 			int dst_index = src_index + 1;
 
-			devices_->CopyImage(heightmap_images_[src_index], heightmap_images_[dst_index], heightmap_size);
+			devices_->CopyImage(heightmap_image_, heightmap_image_, heightmap_size, { 0, 0, 0 }, { 0, 0, 0 }, src_index, dst_index);
+			ShiftHeightBounds(src_index, dst_index);
 		}
 	}
 
@@ -216,7 +319,8 @@ void TerrainGenerator::MoveRight(int current_chunk_x, int current_chunk_y)
 			int src_index = (x) + (y * TERRAIN_CHUNK_SIZE);
 			int dst_index = src_index - 1;
 
-			devices_->CopyImage(heightmap_images_[src_index], heightmap_images_[dst_index], heightmap_size);
+			devices_->CopyImage(heightmap_image_, heightmap_image_, heightmap_size, { 0, 0, 0 }, { 0, 0, 0 }, src_index, dst_index);
+			ShiftHeightBounds(src_index, dst_index);
 		}
 	}
 
@@ -253,7 +357,8 @@ void TerrainGenerator::MoveUp(int current_chunk_x, int current_chunk_y)
 			int src_index = x + (y * TERRAIN_CHUNK_SIZE);
 			int dst_index = src_index + TERRAIN_CHUNK_SIZE;
 
-			devices_->CopyImage(heightmap_images_[src_index], heightmap_images_[dst_index], heightmap_size);
+			devices_->CopyImage(heightmap_image_, heightmap_image_, heightmap_size, { 0, 0, 0 }, { 0, 0, 0 }, src_index, dst_index);
+			ShiftHeightBounds(src_index, dst_index);
 		}
 	}
 
@@ -290,7 +395,8 @@ void TerrainGenerator::MoveDown(int current_chunk_x, int current_chunk_y)
 			int src_index = x + (y * TERRAIN_CHUNK_SIZE);
 			int dst_index = src_index - TERRAIN_CHUNK_SIZE;
 
-			devices_->CopyImage(heightmap_images_[src_index], heightmap_images_[dst_index], heightmap_size);
+			devices_->CopyImage(heightmap_image_, heightmap_image_, heightmap_size, { 0, 0, 0 }, { 0, 0, 0 }, src_index, dst_index);
+			ShiftHeightBounds(src_index, dst_index);
 		}
 	}
 
@@ -398,9 +504,14 @@ void TerrainGenerator::InitPipeline()
 		throw std::runtime_error("failed to create semaphores!");
 	}
 
-	// create the heightmap data buffer
+	// create the heightmap data buffers
 	generation_data_size_ = sizeof(FbmGenerationData);
-	devices_->CreateBuffer(generation_data_size_, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, heightmap_data_buffer_, heightmap_data_buffer_memory_);
+	heightmap_data_buffers_.resize(TERRAIN_CHUNK_COUNT);
+	heightmap_data_buffer_memories_.resize(TERRAIN_CHUNK_COUNT);
+	for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
+	{
+		devices_->CreateBuffer(generation_data_size_, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, heightmap_data_buffers_[i], heightmap_data_buffer_memories_[i]);
+	}
 
 	// create the heightmap shader
 	heightmap_generation_shader_ = new VulkanComputeShader();
@@ -413,10 +524,37 @@ void TerrainGenerator::InitPipeline()
 		heightmap_generation_pipelines_[i] = new HeightmapGenerationPipeline();
 		heightmap_generation_pipelines_[i]->SetShader(heightmap_generation_shader_);
 		heightmap_generation_pipelines_[i]->AddStorageImage(0, heightmap_image_views_[i]);
-		heightmap_generation_pipelines_[i]->AddUniformBuffer(1, heightmap_data_buffer_, sizeof(generation_data_size_));
+		heightmap_generation_pipelines_[i]->AddUniformBuffer(1, heightmap_data_buffers_[i], generation_data_size_);
 		heightmap_generation_pipelines_[i]->Init(devices_);
 	}
 
+	// create the height pyramid shaders
+	height_pyramid_reduce_shader_ = new VulkanComputeShader();
+	height_pyramid_reduce_shader_->Init(devices_, swap_chain_, "../res/shaders/height_pyramid_reduce.comp.spv");
+
+	height_pyramid_levels_shader_ = new VulkanComputeShader();
+	height_pyramid_levels_shader_->Init(devices_, swap_chain_, "../res/shaders/height_pyramid_levels.comp.spv");
+
+	// initialize the height pyramid pipelines, each chunk reduces into its own region of the pyramid buffer
+	VkDeviceSize pyramid_size = sizeof(HeightPyramidTile) * HEIGHT_PYRAMID_TILE_COUNT;
+	height_pyramid_reduce_pipelines_.resize(TERRAIN_CHUNK_COUNT);
+	height_pyramid_levels_pipelines_.resize(TERRAIN_CHUNK_COUNT);
+	for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
+	{
+		height_pyramid_reduce_pipelines_[i] = new HeightPyramidPipeline();
+		height_pyramid_reduce_pipelines_[i]->SetShader(height_pyramid_reduce_shader_);
+		height_pyramid_reduce_pipelines_[i]->SetWorkgroupCount(HEIGHT_PYRAMID_BASE_SIZE, HEIGHT_PYRAMID_BASE_SIZE);
+		height_pyramid_reduce_pipelines_[i]->AddStorageImage(0, heightmap_image_views_[i]);
+		height_pyramid_reduce_pipelines_[i]->AddStorageBuffer(1, height_pyramid_buffer_, pyramid_size, height_pyramid_stride_ * i);
+		height_pyramid_reduce_pipelines_[i]->Init(devices_);
+
+		height_pyramid_levels_pipelines_[i] = new HeightPyramidPipeline();
+		height_pyramid_levels_pipelines_[i]->SetShader(height_pyramid_levels_shader_);
+		height_pyramid_levels_pipelines_[i]->SetWorkgroupCount(1, 1);
+		height_pyramid_levels_pipelines_[i]->AddStorageBuffer(0, height_pyramid_buffer_, pyramid_size, height_pyramid_stride_ * i);
+		height_pyramid_levels_pipelines_[i]->Init(devices_);
+	}
+
 	// create the watermap generation pipeline resources
 	if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &watermap_generation_sempahore_) != VK_SUCCESS)
 	{
@@ -442,18 +580,52 @@ void TerrainGenerator::InitPipeline()
 void TerrainGenerator::InitResources()
 {
 	// create the heightmap resources
-	heightmap_images_.resize(TERRAIN_CHUNK_COUNT);
-	heightmap_image_memorys_.resize(TERRAIN_CHUNK_COUNT);
+	chunk_height_tables_.resize(TERRAIN_CHUNK_COUNT);
+	height_readback_pending_.resize(TERRAIN_CHUNK_COUNT, false);
+	for (ChunkHeightTable& table : chunk_height_tables_)
+	{
+		table.height_bounds = glm::vec2(0.0f, 0.0f);
+		table.roughness = 0.0f;
+	}
 	heightmap_image_views_.resize(TERRAIN_CHUNK_COUNT);
 
+	// every chunk's heightmap is a layer of one image so the terrain can be drawn with a single instanced draw
+	devices_->CreateImage(TERRAIN_SIZE, TERRAIN_SIZE, IMAGE_FORMAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, heightmap_image_, heightmap_image_memory_, 1, TERRAIN_CHUNK_COUNT);
+	heightmap_array_view_ = devices_->CreateImageView(heightmap_image_, IMAGE_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, TERRAIN_CHUNK_COUNT, VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+
+	// the generation passes write each layer through its own view
 	for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
 	{
-		// initialize the heightmap
-		devices_->CreateImage(TERRAIN_SIZE, TERRAIN_SIZE, IMAGE_FORMAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, heightmap_images_[i], heightmap_image_memorys_[i]);
-		heightmap_image_views_[i] = devices_->CreateImageView(heightmap_images_[i], IMAGE_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
+		heightmap_image_views_[i] = devices_->CreateImageView(heightmap_image_, IMAGE_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, i, 1);
+	}
 
-		// transition to the general image layout
-		devices_->TransitionImageLayout(heightmap_images_[i], IMAGE_FORMAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+	// transition to the general image layout
+	devices_->TransitionImageLayout(heightmap_image_, IMAGE_FORMAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1, TERRAIN_CHUNK_COUNT);
+
+	// create the height pyramid buffer, each chunk's pyramid is padded to keep the descriptor offsets aligned
+	height_pyramid_stride_ = ((sizeof(HeightPyramidTile) * HEIGHT_PYRAMID_TILE_COUNT + 255) / 256) * 256;
+	devices_->CreateBuffer(height_pyramid_stride_ * TERRAIN_CHUNK_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, height_pyramid_buffer_, height_pyramid_buffer_memory_);
+
+	// create the persistently mapped readback buffer for the upper pyramid levels
+	height_readback_tile_offset_ = HeightPyramidPipeline::GetLevelOffset(HEIGHT_PYRAMID_READBACK_LEVEL);
+	height_readback_tile_count_ = HEIGHT_PYRAMID_TILE_COUNT - height_readback_tile_offset_;
+	VkDeviceSize readback_size = sizeof(HeightPyramidTile) * height_readback_tile_count_ * TERRAIN_CHUNK_COUNT;
+	devices_->CreateBuffer(readback_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, height_readback_buffer_, height_readback_buffer_memory_);
+
+	void* readback_data;
+	vkMapMemory(devices_->GetLogicalDevice(), height_readback_buffer_memory_, 0, readback_size, 0, &readback_data);
+	height_readback_data_ = static_cast<HeightPyramidTile*>(readback_data);
+
+	// one fence per chunk so each readback can be collected independently
+	height_readback_fences_.resize(TERRAIN_CHUNK_COUNT);
+	VkFenceCreateInfo fence_info = {};
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	for (int i = 0; i < TERRAIN_CHUNK_COUNT; i++)
+	{
+		if (vkCreateFence(devices_->GetLogicalDevice(), &fence_info, nullptr, &height_readback_fences_[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create height readback fence!");
+		}
 	}
 
 	// create the watermap resources 
@@ -510,6 +682,35 @@ void TerrainGenerator::InitCommandBuffer(VkCommandPool command_pool)
 
 		heightmap_generation_pipelines_[i]->RecordCommands(heightmap_generation_command_buffers_[i]);
 
+		// build the height pyramid from the finished heightmap
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(heightmap_generation_command_buffers_[i], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		height_pyramid_reduce_pipelines_[i]->RecordCommands(heightmap_generation_command_buffers_[i]);
+
+		vkCmdPipelineBarrier(heightmap_generation_command_buffers_[i], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		height_pyramid_levels_pipelines_[i]->RecordCommands(heightmap_generation_command_buffers_[i]);
+
+		// copy the upper levels into the chunk's readback slot
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(heightmap_generation_command_buffers_[i], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy readback_region = {};
+		readback_region.srcOffset = height_pyramid_stride_ * i + sizeof(HeightPyramidTile) * height_readback_tile_offset_;
+		readback_region.dstOffset = sizeof(HeightPyramidTile) * height_readback_tile_count_ * i;
+		readback_region.size = sizeof(HeightPyramidTile) * height_readback_tile_count_;
+		vkCmdCopyBuffer(heightmap_generation_command_buffers_[i], height_pyramid_buffer_, height_readback_buffer_, 1, &readback_region);
+
+		// make the copy visible to the host once the fence signals
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(heightmap_generation_command_buffers_[i], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
 		if (vkEndCommandBuffer(heightmap_generation_command_buffers_[i]) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to record heightmap command buffer!");
@@ -535,6 +736,13 @@ void TerrainGenerator::InitCommandBuffer(VkCommandPool command_pool)
 
 	vkBeginCommandBuffer(watermap_generation_command_buffer_, &begin_info);
 
+	// the heightmap dispatches submitted before it are not waited on, so make their writes visible first
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(watermap_generation_command_buffer_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
 	watermap_generation_pipeline_->RecordCommands(watermap_generation_command_buffer_);
 
 	if (vkEndCommandBuffer(watermap_generation_command_buffer_) != VK_SUCCESS)
@@ -5,6 +5,7 @@
 
 #include "pipelines\heightmap_generation_pipeline.h"
 #include "pipelines\watermap_generation_pipeline.h"
+#include "pipelines\height_pyramid_pipeline.h"
 #include "render_target.h"
 
 const int TERRAIN_SIZE = 1024;
@@ -14,11 +15,30 @@ const VkFormat IMAGE_FORMAT = VK_FORMAT_R16_SFLOAT;
 
 const int WATER_SIZE = (TERRAIN_SIZE / 4) * TERRAIN_CHUNK_SIZE;
 
-struct TerrainMatrixData
+// pyramid levels from this one up are read back to the cpu, level one is 16x16 tiles of 64x64 texels
+const int HEIGHT_PYRAMID_READBACK_LEVEL = 1;
+
+// cpu copy of the upper levels of a chunk's height pyramid
+struct ChunkHeightTable
+{
+	std::vector<HeightPyramidTile> tiles;
+	glm::vec2 height_bounds;
+	float roughness;
+};
+
+// camera data shared by the terrain and water passes, the only terrain uniforms rewritten every frame
+struct CameraData
 {
-	glm::mat4 world[TERRAIN_CHUNK_COUNT];
 	glm::mat4 view;
 	glm::mat4 proj;
+	glm::vec4 camera_pos;
+};
+
+// placement of the chunks around the player, only rewritten when the player moves between chunks
+struct ChunkPlacementData
+{
+	glm::vec4 chunk_offsets[TERRAIN_CHUNK_COUNT];	// xyz translation, w scale
+	glm::mat4 water_world;
 };
 
 class TerrainGenerator
@@ -37,6 +57,21 @@ public:
 	inline VkImageView GetHeightmap(int index) { return heightmap_image_views_[index]; }
 	inline std::vector<VkImageView> GetHeightmaps() { return heightmap_image_views_; }
 
+	// every chunk's heightmap as one array view, indexed by chunk
+	inline VkImageView GetHeightmapArray() { return heightmap_array_view_; }
+
+	// collects any finished height pyramid readbacks into the chunk tables, returns true if any were collected
+	bool UpdateHeightBounds();
+
+	// min and max generated height of a chunk in heightmap units
+	inline glm::vec2 GetChunkHeightBounds(int index) { return chunk_height_tables_[index].height_bounds; }
+
+	// average standard deviation of height across the chunk's readback tiles
+	inline float GetChunkRoughness(int index) { return chunk_height_tables_[index].roughness; }
+
+	// min and max height of a pyramid tile, levels below the readback level return the whole chunk
+	glm::vec2 GetTileHeightBounds(int index, int level, int x, int y);
+
 	inline VkImageView GetWatermap() { return watermap_image_view_; }
 	inline VkImageView GetWatermapSegment() { return watermap_segment_image_view_; }
 
@@ -50,6 +85,9 @@ protected:
 	void InitResources();
 	void InitCommandBuffer(VkCommandPool command_pool);
 
+	void ReadHeightPyramid(int index);
+	void ShiftHeightBounds(int src_index, int dst_index);
+
 	// water map shifts
 	void WatermapLeftShift();
 	void WatermapRightShift();
@@ -69,16 +107,38 @@ protected:
 	VulkanComputeShader* heightmap_generation_shader_;
 	std::vector<HeightmapGenerationPipeline*> heightmap_generation_pipelines_;
 
-	VkBuffer heightmap_data_buffer_;
-	VkDeviceMemory heightmap_data_buffer_memory_;
+	// one generation data buffer per chunk, several chunks can be generating at once
+	std::vector<VkBuffer> heightmap_data_buffers_;
+	std::vector<VkDeviceMemory> heightmap_data_buffer_memories_;
 
 	std::vector<VkCommandBuffer> heightmap_generation_command_buffers_;
 	VkSemaphore heightmap_generation_semaphore_; 
 
-	std::vector<VkImage> heightmap_images_;
-	std::vector<VkDeviceMemory> heightmap_image_memorys_;
+	VkImage heightmap_image_;
+	VkDeviceMemory heightmap_image_memory_;
+	VkImageView heightmap_array_view_;
 	std::vector<VkImageView> heightmap_image_views_;
 
+	// height pyramid, built after each heightmap dispatch with its upper levels copied to a mapped buffer
+	VulkanComputeShader* height_pyramid_reduce_shader_;
+	VulkanComputeShader* height_pyramid_levels_shader_;
+	std::vector<HeightPyramidPipeline*> height_pyramid_reduce_pipelines_;
+	std::vector<HeightPyramidPipeline*> height_pyramid_levels_pipelines_;
+
+	VkBuffer height_pyramid_buffer_;
+	VkDeviceMemory height_pyramid_buffer_memory_;
+	VkDeviceSize height_pyramid_stride_;
+
+	VkBuffer height_readback_buffer_;
+	VkDeviceMemory height_readback_buffer_memory_;
+	HeightPyramidTile* height_readback_data_;
+	uint32_t height_readback_tile_offset_;
+	uint32_t height_readback_tile_count_;
+
+	std::vector<VkFence> height_readback_fences_;
+	std::vector<bool> height_readback_pending_;
+	std::vector<ChunkHeightTable> chunk_height_tables_;
+
 	// water map generation
 	VulkanComputeShader* watermap_generation_shader_;
 	WatermapGenerationPipeline* watermap_generation_pipeline_;
@@ -0,0 +1,60 @@
+#include "terrain_shader.h"
+
+TerrainShader::TerrainShader()
+{
+	pass_ = TERRAIN_SHADER_PASS_FULL;
+}
+
+void TerrainShader::CreateVertexInput()
+{
+	CreateVertexBinding();
+	CreateVertexAttributes();
+
+	// the chunk index advances once per instance
+	VkVertexInputBindingDescription instance_binding = {};
+	instance_binding.binding = 1;
+	instance_binding.stride = sizeof(uint32_t);
+	instance_binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	VkVertexInputAttributeDescription chunk_index_attribute = {};
+	chunk_index_attribute.binding = 1;
+	chunk_index_attribute.location = 4;
+	chunk_index_attribute.format = VK_FORMAT_R32_UINT;
+	chunk_index_attribute.offset = 0;
+	vertex_attributes_.push_back(chunk_index_attribute);
+
+	vertex_bindings_[0] = vertex_binding_;
+	vertex_bindings_[1] = instance_binding;
+
+	vertex_input_ = {};
+	vertex_input_.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertex_input_.vertexBindingDescriptionCount = 2;
+	vertex_input_.pVertexBindingDescriptions = vertex_bindings_;
+	vertex_input_.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_attributes_.size());
+	vertex_input_.pVertexAttributeDescriptions = vertex_attributes_.data();
+}
+
+void TerrainShader::CreateDepthStencilState()
+{
+	VulkanShader::CreateDepthStencilState();
+
+	// the pre-pass has already written the nearest depth, so only the fragments that match it are shaded
+	if (pass_ == TERRAIN_SHADER_PASS_DEPTH_EQUAL)
+	{
+		depth_stencil_state_.depthWriteEnable = VK_FALSE;
+		depth_stencil_state_.depthCompareOp = VK_COMPARE_OP_EQUAL;
+	}
+}
+
+void TerrainShader::CreateBlendState()
+{
+	VulkanShader::CreateBlendState();
+
+	// the depth only pass has no color attachments to blend
+	if (pass_ == TERRAIN_SHADER_PASS_DEPTH_ONLY)
+	{
+		attachment_blend_states_.clear();
+		blend_state_.attachmentCount = 0;
+		blend_state_.pAttachments = nullptr;
+	}
+}
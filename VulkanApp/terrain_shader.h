@@ -0,0 +1,33 @@
+#ifndef _TERRAIN_SHADER_H_
+#define _TERRAIN_SHADER_H_
+
+#include "shader.h"
+
+// the pass a terrain shader is built for, the depth pre-pass splits the terrain into a depth only and a depth equal pass
+enum TerrainShaderPass
+{
+	TERRAIN_SHADER_PASS_FULL,
+	TERRAIN_SHADER_PASS_DEPTH_ONLY,
+	TERRAIN_SHADER_PASS_DEPTH_EQUAL
+};
+
+// terrain vertex input, the mesh vertices plus a per instance chunk index read from the visible chunk list
+class TerrainShader : public VulkanShader
+{
+public:
+	TerrainShader();
+
+	// must be set before Init
+	inline void SetPass(TerrainShaderPass pass) { pass_ = pass; }
+
+protected:
+	void CreateVertexInput();
+	void CreateDepthStencilState();
+	void CreateBlendState();
+
+protected:
+	VkVertexInputBindingDescription vertex_bindings_[2];
+	TerrainShaderPass pass_;
+};
+
+#endif
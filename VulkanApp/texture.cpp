@@ -2,6 +2,119 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+
+#include "ktx2.h"
+
+#ifdef TEXTURE_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef TEXTURE_USE_AVX2
+#include <immintrin.h>
+#endif
+
+// build a full mip chain for each texture so minified samples read a level close to their footprint, comment out to keep only the base level
+#define TEXTURE_MIPMAPS
+
+// source images timed by the downscale benchmark, one reduced by a whole factor and one by a fractional factor
+static const uint32_t DOWNSCALE_BENCHMARK_SIZES[][2] = { { 4096, 4096 }, { 5000, 3000 } };
+static const uint32_t DOWNSCALE_BENCHMARK_REPEATS = 4;
+
+#if defined(TEXTURE_USE_AVX2)
+static const char* DOWNSCALE_INSTRUCTION_SET = "avx2";
+#elif defined(TEXTURE_USE_SSE2)
+static const char* DOWNSCALE_INSTRUCTION_SET = "sse2";
+#else
+static const char* DOWNSCALE_INSTRUCTION_SET = "scalar";
+#endif
+
+// the source texels under one destination texel along an axis, with the weight of each in the weights list from weight_offset
+struct AreaSpan
+{
+	uint32_t first;
+	uint32_t count;
+	uint32_t weight_offset;
+};
+
+// each destination texel covers src_size / dst_size source texels, the texels cut by its edges are weighted by the part it covers
+static void CalculateAreaSpans(uint32_t src_size, uint32_t dst_size, std::vector<AreaSpan>& spans, std::vector<float>& weights)
+{
+	double scale = (double)src_size / (double)dst_size;
+
+	spans.resize(dst_size);
+	weights.clear();
+
+	for (uint32_t i = 0; i < dst_size; i++)
+	{
+		double begin = i * scale;
+		double end = (i + 1) * scale;
+		uint32_t first = static_cast<uint32_t>(begin);
+		uint32_t last = std::min(static_cast<uint32_t>(ceil(end)), src_size);
+
+		spans[i].first = first;
+		spans[i].count = last - first;
+		spans[i].weight_offset = static_cast<uint32_t>(weights.size());
+
+		for (uint32_t s = first; s < last; s++)
+		{
+			double coverage = std::min(end, s + 1.0) - std::max(begin, (double)s);
+			weights.push_back(static_cast<float>(coverage / scale));
+		}
+	}
+}
+
+// adds count bytes of a source row, scaled by weight, to the float sums of those bytes
+static void AccumulateRow(const uint8_t* src, uint32_t count, float weight, float* sums)
+{
+	uint32_t i = 0;
+
+#if defined(TEXTURE_USE_AVX2)
+	// sixteen channels per iteration, each eight widened straight from bytes to floats
+	const __m256 weights = _mm256_set1_ps(weight);
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256 low = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i))));
+		__m256 high = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i + 8))));
+
+		_mm256_storeu_ps(sums + i, _mm256_add_ps(_mm256_loadu_ps(sums + i), _mm256_mul_ps(low, weights)));
+		_mm256_storeu_ps(sums + i + 8, _mm256_add_ps(_mm256_loadu_ps(sums + i + 8), _mm256_mul_ps(high, weights)));
+	}
+#elif defined(TEXTURE_USE_SSE2)
+	// sixteen channels per iteration, widened to 16 and then 32 bits before conversion
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 weights = _mm_set1_ps(weight);
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m128i low = _mm_unpacklo_epi8(bytes, zero);
+		__m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+		__m128 channels[4] =
+		{
+			_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)),
+			_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)),
+			_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)),
+			_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero))
+		};
+
+		for (uint32_t j = 0; j < 4; j++)
+		{
+			_mm_storeu_ps(sums + i + j * 4, _mm_add_ps(_mm_loadu_ps(sums + i + j * 4), _mm_mul_ps(channels[j], weights)));
+		}
+	}
+#endif
+
+	// remaining channels, or all of them without simd
+	for (; i < count; i++)
+		sums[i] += src[i] * weight;
+}
 
 Texture::Texture()
 {
@@ -18,6 +131,14 @@ void Texture::Init(VulkanDevices* devices, std::string filename)
 	vk_device_handle_ = devices->GetLogicalDevice();
 	texture_name_ = filename;
 
+	// prefer a block compressed copy written next to the image by the texture compressor, the image is only decoded without one
+	std::string compressed_filename = filename.substr(0, filename.find_last_of('.')) + ".ktx2";
+	if (DecodeKTX2(devices, compressed_filename))
+	{
+		Upload(devices);
+		return;
+	}
+
 	int tex_width, tex_height, tex_channels;
 	stbi_uc* pixels = stbi_load(filename.c_str(), &tex_width, &tex_height, &tex_channels, STBI_rgb_alpha);
 
@@ -28,89 +149,605 @@ void Texture::Init(VulkanDevices* devices, std::string filename)
 		throw std::runtime_error("failed to load texture image!");
 	}
 
+	// the mips are blitted on the gpu when the format supports linear blits, otherwise they are filtered on the cpu
+	format_ = VK_FORMAT_R8G8B8A8_UNORM;
+
+	VkFormatProperties format_properties;
+	vkGetPhysicalDeviceFormatProperties(devices->GetPhysicalDevice(), VK_FORMAT_R8G8B8A8_UNORM, &format_properties);
+
+	VkFormatFeatureFlags blit_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if ((format_properties.optimalTilingFeatures & blit_features) == blit_features)
+	{
+		InitFromBlits(devices, pixels, tex_width, tex_height);
+	}
+	else
+	{
+		DecodeImage(pixels, tex_width, tex_height);
+		UploadDecodedLevels(devices);
+	}
+
+	stbi_image_free(pixels);
+
+	texture_image_view_ = devices->CreateImageView(texture_image_, format_, VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_levels_);
+	
+	InitSampler(devices);
+}
+
+void Texture::Decode(VulkanDevices* devices, std::string filename)
+{
+	vk_device_handle_ = devices->GetLogicalDevice();
+	texture_name_ = filename;
+
+	std::string compressed_filename = filename.substr(0, filename.find_last_of('.')) + ".ktx2";
+	if (DecodeKTX2(devices, compressed_filename))
+		return;
+
+	int tex_width, tex_height, tex_channels;
+	stbi_uc* pixels = stbi_load(filename.c_str(), &tex_width, &tex_height, &tex_channels, STBI_rgb_alpha);
+
+	if (!pixels)
+	{
+		throw std::runtime_error("failed to load texture image!");
+	}
+
+	// there is no command buffer to blit with on a worker, so the whole chain is filtered here
+	image_size_ = tex_width * tex_height * 4;
+	format_ = VK_FORMAT_R8G8B8A8_UNORM;
+	DecodeImage(pixels, tex_width, tex_height);
+
+	stbi_image_free(pixels);
+}
+
+void Texture::RecordUpload(VulkanDevices* devices, VkCommandBuffer command_buffer, VkBuffer staging_buffer, VkDeviceSize staging_offset, void* staging_data)
+{
+	memcpy(staging_data, decoded_levels_.data(), decoded_levels_.size());
+
+	devices->CreateImage(width_, height_, format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_, texture_image_memory_, mip_levels_);
+
+	RecordLevelCopies(command_buffer, staging_buffer, staging_offset);
+
+	// the cpu copy is no longer needed once it is in the staging memory
+	std::vector<uint8_t>().swap(decoded_levels_);
+	decoded_regions_.clear();
+
+	texture_image_view_ = devices->CreateImageView(texture_image_, format_, VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_levels_);
+	InitSampler(devices);
+}
+
+void Texture::InitFromBlits(VulkanDevices* devices, const uint8_t* pixels, int tex_width, int tex_height)
+{
+	// textures larger than max texture resolution are reduced on the cpu, only the final resolution is staged
+	std::vector<uint8_t> downscaled_pixels;
+	uint32_t width, height;
+	if (DownscaleImage(pixels, tex_width, tex_height, downscaled_pixels, width, height))
+		pixels = downscaled_pixels.data();
+
+	VkDeviceSize level_size = (VkDeviceSize)width * height * 4;
+
 	VkBuffer staging_buffer;
 	VkDeviceMemory staging_buffer_memory;
 
-	devices->CreateBuffer(image_size_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
+	devices->CreateBuffer(level_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
 
 	void* data;
-	vkMapMemory(vk_device_handle_, staging_buffer_memory, 0, image_size_, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(image_size_));
+	vkMapMemory(vk_device_handle_, staging_buffer_memory, 0, level_size, 0, &data);
+	memcpy(data, pixels, static_cast<size_t>(level_size));
 	vkUnmapMemory(vk_device_handle_, staging_buffer_memory);
 
-	stbi_image_free(pixels);
+	// create the texture and copy in data from the buffer
+	width_ = width;
+	height_ = height;
+	mip_levels_ = CalculateMipLevels(width, height);
+	devices->CreateImage(width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_, texture_image_memory_, mip_levels_);
+	devices->TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels_);
+	devices->CopyBufferToImage(staging_buffer, texture_image_, width, height);
 
-	// reduce sizes of textures that are larger than max texture resolution
-	if (tex_width * tex_height > MAX_TEXTURE_RESOLUTION * MAX_TEXTURE_RESOLUTION)
+	VkCommandBuffer blit_buffer = devices->BeginSingleTimeCommands();
+	RecordMipBlits(blit_buffer, static_cast<int>(width), static_cast<int>(height));
+	devices->EndSingleTimeCommands(blit_buffer);
+
+	vkDestroyBuffer(vk_device_handle_, staging_buffer, nullptr);
+	vkFreeMemory(vk_device_handle_, staging_buffer_memory, nullptr);
+}
+
+void Texture::DecodeImage(const uint8_t* pixels, int tex_width, int tex_height)
+{
+	// textures larger than max texture resolution are reduced before their mips are built, the full size image is never staged
+	std::vector<uint8_t> downscaled_pixels;
+	uint32_t width, height;
+	if (DownscaleImage(pixels, tex_width, tex_height, downscaled_pixels, width, height))
+		pixels = downscaled_pixels.data();
+
+	// the levels are packed one after another, each copy region points at its own level
+	width_ = width;
+	height_ = height;
+	mip_levels_ = CalculateMipLevels(width, height);
+
+	decoded_regions_.resize(mip_levels_);
+	VkDeviceSize chain_size = 0;
+	for (uint32_t i = 0; i < mip_levels_; i++)
 	{
-		int new_width, new_height;
-		// determine new resolution for texture
-		if (tex_height > tex_width)
-		{
-			new_height = MAX_TEXTURE_RESOLUTION;
-			new_width = tex_width * ((float)new_height / (float)tex_height);
-		}
-		else
+		uint32_t level_width = std::max(width >> i, 1u);
+		uint32_t level_height = std::max(height >> i, 1u);
+
+		decoded_regions_[i] = {};
+		decoded_regions_[i].bufferOffset = chain_size;
+		decoded_regions_[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		decoded_regions_[i].imageSubresource.mipLevel = i;
+		decoded_regions_[i].imageSubresource.baseArrayLayer = 0;
+		decoded_regions_[i].imageSubresource.layerCount = 1;
+		decoded_regions_[i].imageOffset = { 0, 0, 0 };
+		decoded_regions_[i].imageExtent = { level_width, level_height, 1 };
+
+		chain_size += level_width * level_height * 4;
+	}
+
+	// each level is filtered from the one before it
+	decoded_levels_.resize((size_t)chain_size);
+	uint8_t* chain = decoded_levels_.data();
+
+	memcpy(chain, pixels, (size_t)width * height * 4);
+	for (uint32_t i = 1; i < mip_levels_; i++)
+	{
+		const VkBufferImageCopy& previous = decoded_regions_[i - 1];
+		DownsampleBox(chain + previous.bufferOffset, previous.imageExtent.width, previous.imageExtent.height, chain + decoded_regions_[i].bufferOffset);
+	}
+}
+
+bool Texture::DecodeKTX2(VulkanDevices* devices, std::string filename)
+{
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	size_t file_size = (size_t)file.tellg();
+	if (file_size < sizeof(KTX2Header))
+		return false;
+
+	KTX2Header header;
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(KTX2Header));
+
+	// only plain 2d block compressed textures are loaded, anything else falls back to the decoded image
+	if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 || header.supercompression_scheme != 0 || header.pixel_depth > 1 || header.layer_count > 1 || header.face_count != 1)
+	{
+		std::cout << "Texture " << filename << " is not a 2d ktx2 texture without supercompression, loading the image instead" << std::endl;
+		return false;
+	}
+
+	uint32_t block_size = KTX2BlockSize(header.vk_format);
+	if (block_size == 0)
+	{
+		std::cout << "Texture " << filename << " is not in a supported block compressed format, loading the image instead" << std::endl;
+		return false;
+	}
+
+	VkFormatProperties format_properties;
+	vkGetPhysicalDeviceFormatProperties(devices->GetPhysicalDevice(), static_cast<VkFormat>(header.vk_format), &format_properties);
+
+	if (!devices->GetEnabledFeatures().textureCompressionBC || !(format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+	{
+		std::cout << "Block compressed textures need BC texture compression, which this device does not support" << std::endl;
+		return false;
+	}
+
+	format_ = static_cast<VkFormat>(header.vk_format);
+	width_ = header.pixel_width;
+	height_ = header.pixel_height;
+	mip_levels_ = std::max(header.level_count, 1u);
+
+	std::vector<KTX2LevelIndex> level_index(mip_levels_);
+	file.read(reinterpret_cast<char*>(level_index.data()), sizeof(KTX2LevelIndex) * mip_levels_);
+
+	// the levels are packed in the file's order, each copy region points at its own level
+	decoded_regions_.resize(mip_levels_);
+	VkDeviceSize chain_size = 0;
+	for (uint32_t i = 0; i < mip_levels_; i++)
+	{
+		uint32_t level_width = std::max(header.pixel_width >> i, 1u);
+		uint32_t level_height = std::max(header.pixel_height >> i, 1u);
+		VkDeviceSize level_size = (VkDeviceSize)((level_width + 3) / 4) * ((level_height + 3) / 4) * block_size;
+
+		if (!file || level_index[i].byte_length != level_size || level_index[i].byte_offset + level_index[i].byte_length > file_size)
 		{
-			new_width = MAX_TEXTURE_RESOLUTION;
-			new_height = tex_height * ((float)new_width / (float)tex_width);
+			throw std::runtime_error("failed to read ktx2 texture levels!");
 		}
 
-		// create the initial texture and copy in data from the staging buffer
-		VkImage initial_image;
-		VkDeviceMemory initial_image_memory;
+		decoded_regions_[i] = {};
+		decoded_regions_[i].bufferOffset = chain_size;
+		decoded_regions_[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		decoded_regions_[i].imageSubresource.mipLevel = i;
+		decoded_regions_[i].imageSubresource.baseArrayLayer = 0;
+		decoded_regions_[i].imageSubresource.layerCount = 1;
+		decoded_regions_[i].imageOffset = { 0, 0, 0 };
+		decoded_regions_[i].imageExtent = { level_width, level_height, 1 };
 
-		devices->CreateImage(tex_width, tex_height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, initial_image, initial_image_memory);
-		devices->TransitionImageLayout(initial_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		devices->CopyBufferToImage(staging_buffer, initial_image, static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height));
-		devices->TransitionImageLayout(initial_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		chain_size += level_size;
+	}
 
-		// create the final texture
-		devices->CreateImage(new_width, new_height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_, texture_image_memory_);
-		devices->TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	image_size_ = level_index[0].byte_length;
 
-		// blit the image from the initial texture
-		VkCommandBuffer blit_buffer = devices->BeginSingleTimeCommands();
+	// the blocks are uploaded as they are stored, there is nothing to decode
+	decoded_levels_.resize((size_t)chain_size);
+	for (uint32_t i = 0; i < mip_levels_; i++)
+	{
+		file.seekg(level_index[i].byte_offset);
+		file.read(reinterpret_cast<char*>(decoded_levels_.data()) + decoded_regions_[i].bufferOffset, level_index[i].byte_length);
+	}
+
+	if (!file)
+	{
+		throw std::runtime_error("failed to read ktx2 texture levels!");
+	}
+
+	return true;
+}
+
+void Texture::Upload(VulkanDevices* devices)
+{
+	UploadDecodedLevels(devices);
+
+	texture_image_view_ = devices->CreateImageView(texture_image_, format_, VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_levels_);
+	InitSampler(devices);
+}
+
+void Texture::UploadDecodedLevels(VulkanDevices* devices)
+{
+	VkDeviceSize chain_size = decoded_levels_.size();
+
+	VkBuffer staging_buffer;
+	VkDeviceMemory staging_buffer_memory;
+
+	devices->CreateBuffer(chain_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
+
+	void* data;
+	vkMapMemory(vk_device_handle_, staging_buffer_memory, 0, chain_size, 0, &data);
+	memcpy(data, decoded_levels_.data(), (size_t)chain_size);
+	vkUnmapMemory(vk_device_handle_, staging_buffer_memory);
+
+	devices->CreateImage(width_, height_, format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_, texture_image_memory_, mip_levels_);
+
+	VkCommandBuffer copy_buffer = devices->BeginSingleTimeCommands();
+	RecordLevelCopies(copy_buffer, staging_buffer, 0);
+	devices->EndSingleTimeCommands(copy_buffer);
+
+	vkDestroyBuffer(vk_device_handle_, staging_buffer, nullptr);
+	vkFreeMemory(vk_device_handle_, staging_buffer_memory, nullptr);
+
+	std::vector<uint8_t>().swap(decoded_levels_);
+	decoded_regions_.clear();
+}
+
+void Texture::RecordLevelCopies(VkCommandBuffer command_buffer, VkBuffer staging_buffer, VkDeviceSize staging_offset)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = texture_image_;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mip_levels_;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	std::vector<VkBufferImageCopy> regions = decoded_regions_;
+	for (VkBufferImageCopy& region : regions)
+		region.bufferOffset += staging_offset;
+
+	vkCmdCopyBufferToImage(command_buffer, staging_buffer, texture_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void Texture::RecordMipBlits(VkCommandBuffer command_buffer, int width, int height)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = texture_image_;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	for (uint32_t i = 1; i < mip_levels_; i++)
+	{
+		// the level above has been written, it becomes the source of this level's blit
+		barrier.subresourceRange.baseMipLevel = i - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		int next_width = std::max(width / 2, 1);
+		int next_height = std::max(height / 2, 1);
 
 		VkImageBlit image_blit = {};
 		image_blit.srcOffsets[0] = { 0, 0, 0 };
-		image_blit.srcOffsets[1] = { tex_width, tex_height, 1 };
+		image_blit.srcOffsets[1] = { width, height, 1 };
 		image_blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		image_blit.srcSubresource.baseArrayLayer = 0;
 		image_blit.srcSubresource.layerCount = 1;
-		image_blit.srcSubresource.mipLevel = 0;
+		image_blit.srcSubresource.mipLevel = i - 1;
 
 		image_blit.dstOffsets[0] = { 0, 0, 0 };
-		image_blit.dstOffsets[1] = { new_width, new_height, 1 };
+		image_blit.dstOffsets[1] = { next_width, next_height, 1 };
 		image_blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		image_blit.dstSubresource.baseArrayLayer = 0;
 		image_blit.dstSubresource.layerCount = 1;
-		image_blit.dstSubresource.mipLevel = 0;
+		image_blit.dstSubresource.mipLevel = i;
+
+		vkCmdBlitImage(command_buffer, texture_image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_blit, VK_FILTER_LINEAR);
+
+		// the level above is finished with once its blit has read it
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		width = next_width;
+		height = next_height;
+	}
+
+	// the last level was only ever written
+	barrier.subresourceRange.baseMipLevel = mip_levels_ - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+uint32_t Texture::CalculateMipLevels(uint32_t width, uint32_t height)
+{
+#ifdef TEXTURE_MIPMAPS
+	// levels down to a single texel along the longer side
+	uint32_t mip_levels = 1;
+	while ((std::max(width, height) >> mip_levels) > 0)
+		mip_levels++;
+
+	return mip_levels;
+#else
+	return 1;
+#endif
+}
+
+void Texture::DownsampleBox(const uint8_t* src, uint32_t src_width, uint32_t src_height, uint8_t* dst)
+{
+	uint32_t dst_width = std::max(src_width / 2, 1u);
+	uint32_t dst_height = std::max(src_height / 2, 1u);
+
+	for (uint32_t y = 0; y < dst_height; y++)
+	{
+		// a one texel high source is averaged with itself
+		const uint8_t* row0 = src + (size_t)std::min(y * 2, src_height - 1) * src_width * 4;
+		const uint8_t* row1 = src + (size_t)std::min(y * 2 + 1, src_height - 1) * src_width * 4;
+		uint8_t* dst_row = dst + (size_t)y * dst_width * 4;
+
+		uint32_t first_scalar = 0;
+
+#ifdef TEXTURE_USE_SSE2
+		// two destination texels per iteration from four source texels of each row, summed in 16 bits so the rounding matches the scalar path
+		if (src_width >= 4)
+		{
+			// an even count of destination texels only reads source texels below twice that count
+			uint32_t simd_count = dst_width & ~1u;
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i round = _mm_set1_epi16(2);
+
+			for (uint32_t x = 0; x < simd_count; x += 2)
+			{
+				__m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+				__m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+
+				// columns summed for texels 0 and 1, then 2 and 3
+				__m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+				__m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+				// neighbouring texels summed into the low half of each
+				left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+				right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+
+				__m128i sum = _mm_unpacklo_epi64(left, right);
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst_row + x * 4), _mm_packus_epi16(sum, sum));
+			}
 
-		vkCmdBlitImage(blit_buffer, initial_image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_blit, VK_FILTER_LINEAR);
+			first_scalar = simd_count;
+		}
+#endif
 
-		// submit the blit command buffer
-		devices->EndSingleTimeCommands(blit_buffer);
+		// remaining texels, or all of them without sse2
+		for (uint32_t x = first_scalar; x < dst_width; x++)
+		{
+			uint32_t x0 = std::min(x * 2, src_width - 1) * 4;
+			uint32_t x1 = std::min(x * 2 + 1, src_width - 1) * 4;
 
-		// clean up the initial texture now it is no longer needed
-		vkDestroyImage(vk_device_handle_, initial_image, nullptr);
-		vkFreeMemory(vk_device_handle_, initial_image_memory, nullptr);
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				dst_row[x * 4 + c] = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+}
+
+void Texture::DownsampleArea(const uint8_t* src, uint32_t src_width, uint32_t src_height, uint8_t* dst, uint32_t dst_width, uint32_t dst_height)
+{
+	std::vector<AreaSpan> columns, rows;
+	std::vector<float> column_weights, row_weights;
+	CalculateAreaSpans(src_width, dst_width, columns, column_weights);
+	CalculateAreaSpans(src_height, dst_height, rows, row_weights);
+
+	// the weighted source rows under a destination row are summed first, so every source byte is read once
+	std::vector<float> row_sums((size_t)src_width * 4);
+
+	for (uint32_t y = 0; y < dst_height; y++)
+	{
+		const AreaSpan& row = rows[y];
+
+		std::fill(row_sums.begin(), row_sums.end(), 0.0f);
+		for (uint32_t r = 0; r < row.count; r++)
+		{
+			AccumulateRow(src + (size_t)(row.first + r) * src_width * 4, src_width * 4, row_weights[row.weight_offset + r], row_sums.data());
+		}
+
+		// then each destination texel sums the columns it covers, the weights along each axis add up to one so the channels stay in range
+		uint8_t* dst_row = dst + (size_t)y * dst_width * 4;
+
+		for (uint32_t x = 0; x < dst_width; x++)
+		{
+			const AreaSpan& column = columns[x];
+			const float* texels = row_sums.data() + (size_t)column.first * 4;
+			const float* weights = column_weights.data() + column.weight_offset;
+
+#ifdef TEXTURE_USE_SSE2
+			// the four channels of a texel in one register
+			__m128 total = _mm_setzero_ps();
+			for (uint32_t c = 0; c < column.count; c++)
+			{
+				total = _mm_add_ps(total, _mm_mul_ps(_mm_loadu_ps(texels + c * 4), _mm_set1_ps(weights[c])));
+			}
+
+			__m128i rounded = _mm_cvttps_epi32(_mm_add_ps(total, _mm_set1_ps(0.5f)));
+			rounded = _mm_packs_epi32(rounded, rounded);
+			rounded = _mm_packus_epi16(rounded, rounded);
+
+			int32_t texel = _mm_cvtsi128_si32(rounded);
+			memcpy(dst_row + x * 4, &texel, sizeof(texel));
+#else
+			for (uint32_t channel = 0; channel < 4; channel++)
+			{
+				float total = 0.0f;
+				for (uint32_t c = 0; c < column.count; c++)
+				{
+					total += texels[c * 4 + channel] * weights[c];
+				}
+
+				dst_row[x * 4 + channel] = static_cast<uint8_t>(std::min(total + 0.5f, 255.0f));
+			}
+#endif
+		}
+	}
+}
+
+void Texture::CalculateDownscaledSize(uint32_t width, uint32_t height, uint32_t& new_width, uint32_t& new_height)
+{
+	new_width = width;
+	new_height = height;
+
+	if ((uint64_t)width * height <= (uint64_t)MAX_TEXTURE_RESOLUTION * MAX_TEXTURE_RESOLUTION)
+		return;
+
+	// the longer side is reduced to max texture resolution and the other keeps the aspect ratio
+	if (height > width)
+	{
+		new_height = MAX_TEXTURE_RESOLUTION;
+		new_width = std::max(static_cast<uint32_t>(width * ((float)new_height / (float)height)), 1u);
 	}
 	else
 	{
-		// create the texture and copy in data from the buffer
-		devices->CreateImage(tex_width, tex_height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_, texture_image_memory_);
-		devices->TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		devices->CopyBufferToImage(staging_buffer, texture_image_, static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height));
-		devices->TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		new_width = MAX_TEXTURE_RESOLUTION;
+		new_height = std::max(static_cast<uint32_t>(height * ((float)new_width / (float)width)), 1u);
 	}
+}
 
-	vkDestroyBuffer(vk_device_handle_, staging_buffer, nullptr);
-	vkFreeMemory(vk_device_handle_, staging_buffer_memory, nullptr);
+bool Texture::DownscaleImage(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<uint8_t>& downscaled_pixels, uint32_t& new_width, uint32_t& new_height)
+{
+	CalculateDownscaledSize(width, height, new_width, new_height);
 
-	texture_image_view_ = devices->CreateImageView(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-	
-	InitSampler(devices);
+	if (new_width == width && new_height == height)
+		return false;
+
+	downscaled_pixels.resize((size_t)new_width * new_height * 4);
+	DownsampleArea(pixels, width, height, downscaled_pixels.data(), new_width, new_height);
+
+	return true;
+}
+
+void Texture::BenchmarkDownsampleArea(JobSystem* job_system)
+{
+	for (const auto& size : DOWNSCALE_BENCHMARK_SIZES)
+	{
+		uint32_t src_width = size[0];
+		uint32_t src_height = size[1];
+		uint32_t dst_width, dst_height;
+		CalculateDownscaledSize(src_width, src_height, dst_width, dst_height);
+
+		// throughput is counted in source bytes, the bytes that would otherwise have been staged
+		double src_megabytes = (double)src_width * src_height * 4 / (1024.0 * 1024.0);
+
+		// alone and then on every worker at once, so the memory bandwidth the cores share shows in the per core figure
+		std::vector<uint32_t> job_counts = { 1 };
+		if (job_system->GetWorkerCount() > 1)
+			job_counts.push_back(job_system->GetWorkerCount());
+
+		for (uint32_t job_count : job_counts)
+		{
+			std::vector<double> throughputs(job_count);
+			JobCounter benchmark_counter;
+
+			for (uint32_t job = 0; job < job_count; job++)
+			{
+				job_system->Submit([&throughputs, src_width, src_height, dst_width, dst_height, src_megabytes, job](uint32_t worker_index)
+				{
+					std::vector<uint8_t> src((size_t)src_width * src_height * 4);
+					std::vector<uint8_t> dst((size_t)dst_width * dst_height * 4);
+
+					for (size_t i = 0; i < src.size(); i++)
+						src[i] = static_cast<uint8_t>(i * 7 + (i >> 12));
+
+					// the first pass touches the pages of both images before timing
+					DownsampleArea(src.data(), src_width, src_height, dst.data(), dst_width, dst_height);
+
+					auto begin = std::chrono::high_resolution_clock::now();
+
+					for (uint32_t i = 0; i < DOWNSCALE_BENCHMARK_REPEATS; i++)
+						DownsampleArea(src.data(), src_width, src_height, dst.data(), dst_width, dst_height);
+
+					auto end = std::chrono::high_resolution_clock::now();
+
+					double seconds = std::chrono::duration<double>(end - begin).count();
+					throughputs[job] = src_megabytes * DOWNSCALE_BENCHMARK_REPEATS / seconds;
+				}, 1, &benchmark_counter);
+			}
+
+			job_system->Wait(&benchmark_counter);
+
+			double total_throughput = 0.0;
+			for (double throughput : throughputs)
+				total_throughput += throughput;
+
+			std::cout << "Area downscale " << src_width << "x" << src_height << " to " << dst_width << "x" << dst_height << " (" << DOWNSCALE_INSTRUCTION_SET << "), "
+				<< job_count << (job_count == 1 ? " core: " : " cores: ") << static_cast<uint32_t>(total_throughput / job_count) << " MB/s per core" << std::endl;
+		}
+	}
+}
+
+VkDeviceSize Texture::GetMemorySize()
+{
+	VkMemoryRequirements memory_requirements;
+	vkGetImageMemoryRequirements(vk_device_handle_, texture_image_, &memory_requirements);
+
+	return memory_requirements.size;
 }
 
 void Texture::Cleanup()
@@ -118,7 +755,6 @@ void Texture::Cleanup()
 	vkDestroyImageView(vk_device_handle_, texture_image_view_, nullptr);
 	vkDestroyImage(vk_device_handle_, texture_image_, nullptr);
 	vkFreeMemory(vk_device_handle_, texture_image_memory_, nullptr);
-	vkDestroySampler(vk_device_handle_, texture_sampler_, nullptr);
 }
 
 void Texture::InitSampler(VulkanDevices* devices)
@@ -137,10 +773,13 @@ void Texture::InitSampler(VulkanDevices* devices)
 	sampler_info.compareEnable = VK_FALSE;
 	sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
 	sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	sampler_info.mipLodBias = 0.0f;
+	sampler_info.minLod = 0.0f;
 
-	if (vkCreateSampler(vk_device_handle_, &sampler_info, nullptr, &texture_sampler_) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create texture sampler!");
-	}
+	// the view limits the levels, so textures with any number of mips share one sampler
+	sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+	texture_sampler_ = devices->GetSampler(sampler_info);
 }
 
 void Texture::AddMapType(MapType map_type)
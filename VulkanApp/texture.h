@@ -8,6 +8,16 @@
 
 #define MAX_TEXTURE_RESOLUTION 2048
 
+// use the sse2 box filter for the cpu mip chain wherever the compiler targets it
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define TEXTURE_USE_SSE2
+#endif
+
+// and the avx2 row accumulation of the area downscale where the compiler targets avx2, there is no runtime dispatch
+#if defined(__AVX2__)
+#define TEXTURE_USE_AVX2
+#endif
+
 class Texture
 {
 public:
@@ -30,6 +40,18 @@ public:
 	void Init(VulkanDevices* devices, std::string filename);
 	void Cleanup();
 
+	// reads the ktx2 copy or decodes the image and filters its mip chain on the cpu, safe to call from job system workers
+	void Decode(VulkanDevices* devices, std::string filename);
+
+	// creates the image and records the copy of the decoded levels from the staging memory at the given offset
+	// the levels are written to staging_data, which must be the mapped staging buffer at that offset
+	void RecordUpload(VulkanDevices* devices, VkCommandBuffer command_buffer, VkBuffer staging_buffer, VkDeviceSize staging_offset, void* staging_data);
+
+	// uploads the decoded levels through a staging buffer of their own and waits for the copy
+	void Upload(VulkanDevices* devices);
+
+	VkDeviceSize GetDecodedSize() { return decoded_levels_.size(); }
+
 	VkImageView GetImageView() { return texture_image_view_; }
 	VkSampler GetSampler() { return texture_sampler_; }
 
@@ -44,20 +66,68 @@ public:
 
 	VkDeviceSize GetImageSize() { return image_size_; }
 
+	// device memory taken by the image and its mip chain
+	VkDeviceSize GetMemorySize();
+
+	uint32_t GetMipLevels() { return mip_levels_; }
+
+	// averages each 2x2 block of an rgba8 image into one texel of the next mip level, odd edges are clamped
+	static void DownsampleBox(const uint8_t* src, uint32_t src_width, uint32_t src_height, uint8_t* dst);
+
+	// averages the source texels under each destination texel's footprint for any smaller size, texels cut by its edges are weighted by the part covered
+	static void DownsampleArea(const uint8_t* src, uint32_t src_width, uint32_t src_height, uint8_t* dst, uint32_t dst_width, uint32_t dst_height);
+
+	// the size a texture larger than max texture resolution is reduced to, unchanged when it already fits
+	static void CalculateDownscaledSize(uint32_t width, uint32_t height, uint32_t& new_width, uint32_t& new_height);
+
+	// times the area downscale of oversized images on one worker and then on every worker at once, and prints the source throughput per core
+	static void BenchmarkDownsampleArea(JobSystem* job_system);
+
+	// levels down to a single texel along the longer side, or just the base level without mipmaps
+	static uint32_t CalculateMipLevels(uint32_t width, uint32_t height);
+
 protected:
 	void InitSampler(VulkanDevices* devices);
 
+	// reduces an image larger than max texture resolution with the area filter, false when it already fits and is left as it is
+	static bool DownscaleImage(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<uint8_t>& downscaled_pixels, uint32_t& new_width, uint32_t& new_height);
+
+	// uploads the base level and blits each mip level from the one above it, used when the format can be linearly blitted
+	void InitFromBlits(VulkanDevices* devices, const uint8_t* pixels, int tex_width, int tex_height);
+
+	// builds the whole chain with the box filter into the decoded levels
+	void DecodeImage(const uint8_t* pixels, int tex_width, int tex_height);
+
+	// reads the pre-built levels of a block compressed ktx2 file into the decoded levels, false if there is no usable file so the image is decoded instead
+	bool DecodeKTX2(VulkanDevices* devices, std::string filename);
+
+	// creates the image from the decoded levels and frees them, the view and sampler are left to the caller
+	void UploadDecodedLevels(VulkanDevices* devices);
+
+	// records the copy of every decoded level, with one copy region per level offset into the staging buffer
+	void RecordLevelCopies(VkCommandBuffer command_buffer, VkBuffer staging_buffer, VkDeviceSize staging_offset);
+
+	// leaves every level in the shader read layout, level zero must be in the transfer destination layout
+	void RecordMipBlits(VkCommandBuffer command_buffer, int width, int height);
+
 protected:
 	VkImage texture_image_;
 	VkDeviceMemory texture_image_memory_;
 	VkImageView texture_image_view_;
 	VkSampler texture_sampler_;
 
+	VkFormat format_;
 	VkDeviceSize image_size_;
+	uint32_t width_, height_;
+	uint32_t mip_levels_;
 	std::string texture_name_;
 	std::vector<MapType> map_types_;
 	uint16_t usage_count_;
 
+	// levels packed one after another between decoding and upload, the regions' offsets are relative to the first level
+	std::vector<uint8_t> decoded_levels_;
+	std::vector<VkBufferImageCopy> decoded_regions_;
+
 	VkDevice vk_device_handle_;
 };
 
@@ -0,0 +1,180 @@
+#include "texture_array.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "texture.h"
+
+TextureArray::TextureArray()
+{
+	layer_size_ = 0;
+	layer_count_ = 0;
+	mip_levels_ = 0;
+}
+
+void TextureArray::Init(VulkanDevices* devices, const std::vector<std::string>& filenames, uint32_t layer_size)
+{
+	vk_device_handle_ = devices->GetLogicalDevice();
+	layer_size_ = layer_size;
+	layer_count_ = static_cast<uint32_t>(filenames.size());
+	mip_levels_ = Texture::CalculateMipLevels(layer_size, layer_size);
+
+	// the levels are packed level by level, so one copy region per level covers every layer
+	std::vector<VkBufferImageCopy> regions(mip_levels_);
+	std::vector<VkDeviceSize> level_sizes(mip_levels_);
+	VkDeviceSize chain_size = 0;
+	for (uint32_t i = 0; i < mip_levels_; i++)
+	{
+		uint32_t level_size = std::max(layer_size >> i, 1u);
+		level_sizes[i] = (VkDeviceSize)level_size * level_size * 4;
+
+		regions[i] = {};
+		regions[i].bufferOffset = chain_size;
+		regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].imageSubresource.mipLevel = i;
+		regions[i].imageSubresource.baseArrayLayer = 0;
+		regions[i].imageSubresource.layerCount = layer_count_;
+		regions[i].imageOffset = { 0, 0, 0 };
+		regions[i].imageExtent = { level_size, level_size, 1 };
+
+		chain_size += level_sizes[i] * layer_count_;
+	}
+
+	std::vector<uint8_t> chain((size_t)chain_size);
+
+	// each layer is decoded, resampled and filtered on its own worker straight into its place in the chain
+	JobSystem* job_system = devices->GetJobSystem();
+	JobCounter layer_counter;
+
+	for (uint32_t layer = 0; layer < layer_count_; layer++)
+	{
+		job_system->Submit([this, &filenames, &chain, &regions, &level_sizes, layer](uint32_t worker_index)
+		{
+			int tex_width, tex_height, tex_channels;
+			stbi_uc* pixels = stbi_load(filenames[layer].c_str(), &tex_width, &tex_height, &tex_channels, STBI_rgb_alpha);
+
+			if (!pixels)
+			{
+				throw std::runtime_error("failed to load texture image!");
+			}
+
+			// larger images are area averaged down to the layer size, smaller ones are resampled up
+			uint32_t width = tex_width;
+			uint32_t height = tex_height;
+
+			uint8_t* base_level = chain.data() + regions[0].bufferOffset + level_sizes[0] * layer;
+			if (width == layer_size_ && height == layer_size_)
+				memcpy(base_level, pixels, (size_t)width * height * 4);
+			else if (width >= layer_size_ && height >= layer_size_)
+				Texture::DownsampleArea(pixels, width, height, base_level, layer_size_, layer_size_);
+			else
+				ResampleBilinear(pixels, width, height, base_level, layer_size_, layer_size_);
+
+			stbi_image_free(pixels);
+
+			for (uint32_t i = 1; i < mip_levels_; i++)
+			{
+				const uint8_t* previous = chain.data() + regions[i - 1].bufferOffset + level_sizes[i - 1] * layer;
+				uint8_t* level = chain.data() + regions[i].bufferOffset + level_sizes[i] * layer;
+				Texture::DownsampleBox(previous, regions[i - 1].imageExtent.width, regions[i - 1].imageExtent.height, level);
+			}
+		}, 1, &layer_counter);
+	}
+
+	job_system->Wait(&layer_counter);
+
+	VkBuffer staging_buffer;
+	VkDeviceMemory staging_buffer_memory;
+
+	devices->CreateBuffer(chain_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
+
+	void* data;
+	vkMapMemory(vk_device_handle_, staging_buffer_memory, 0, chain_size, 0, &data);
+	memcpy(data, chain.data(), (size_t)chain_size);
+	vkUnmapMemory(vk_device_handle_, staging_buffer_memory);
+
+	devices->CreateImage(layer_size, layer_size, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_, texture_image_memory_, mip_levels_, layer_count_);
+	devices->TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels_, layer_count_);
+
+	VkCommandBuffer copy_buffer = devices->BeginSingleTimeCommands();
+	vkCmdCopyBufferToImage(copy_buffer, staging_buffer, texture_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+	devices->EndSingleTimeCommands(copy_buffer);
+
+	devices->TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mip_levels_, layer_count_);
+
+	vkDestroyBuffer(vk_device_handle_, staging_buffer, nullptr);
+	vkFreeMemory(vk_device_handle_, staging_buffer_memory, nullptr);
+
+	texture_image_view_ = devices->CreateImageView(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_levels_, 0, layer_count_, VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+
+	InitSampler(devices);
+}
+
+void TextureArray::Cleanup()
+{
+	vkDestroyImageView(vk_device_handle_, texture_image_view_, nullptr);
+	vkDestroyImage(vk_device_handle_, texture_image_, nullptr);
+	vkFreeMemory(vk_device_handle_, texture_image_memory_, nullptr);
+}
+
+void TextureArray::InitSampler(VulkanDevices* devices)
+{
+	VkSamplerCreateInfo sampler_info = {};
+	sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_info.magFilter = VK_FILTER_LINEAR;
+	sampler_info.minFilter = VK_FILTER_LINEAR;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_info.anisotropyEnable = VK_TRUE;
+	sampler_info.maxAnisotropy = 16;
+	sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	sampler_info.unnormalizedCoordinates = VK_FALSE;
+	sampler_info.compareEnable = VK_FALSE;
+	sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+	sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	sampler_info.mipLodBias = 0.0f;
+	sampler_info.minLod = 0.0f;
+	sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+	// the same state as the textures' sampler, so the array shares it
+	texture_sampler_ = devices->GetSampler(sampler_info);
+}
+
+void TextureArray::ResampleBilinear(const uint8_t* src, uint32_t src_width, uint32_t src_height, uint8_t* dst, uint32_t dst_width, uint32_t dst_height)
+{
+	float scale_x = (float)src_width / (float)dst_width;
+	float scale_y = (float)src_height / (float)dst_height;
+
+	for (uint32_t y = 0; y < dst_height; y++)
+	{
+		// texel centres are mapped onto each other
+		float src_y = (y + 0.5f) * scale_y - 0.5f;
+		float floor_y = floorf(src_y);
+		float weight_y = src_y - floor_y;
+		uint32_t y0 = (uint32_t)(((int)floor_y % (int)src_height + (int)src_height) % (int)src_height);
+		uint32_t y1 = (y0 + 1) % src_height;
+
+		for (uint32_t x = 0; x < dst_width; x++)
+		{
+			float src_x = (x + 0.5f) * scale_x - 0.5f;
+			float floor_x = floorf(src_x);
+			float weight_x = src_x - floor_x;
+			uint32_t x0 = (uint32_t)(((int)floor_x % (int)src_width + (int)src_width) % (int)src_width);
+			uint32_t x1 = (x0 + 1) % src_width;
+
+			const uint8_t* texel00 = src + ((size_t)y0 * src_width + x0) * 4;
+			const uint8_t* texel01 = src + ((size_t)y0 * src_width + x1) * 4;
+			const uint8_t* texel10 = src + ((size_t)y1 * src_width + x0) * 4;
+			const uint8_t* texel11 = src + ((size_t)y1 * src_width + x1) * 4;
+
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				float top = texel00[c] + (texel01[c] - texel00[c]) * weight_x;
+				float bottom = texel10[c] + (texel11[c] - texel10[c]) * weight_x;
+				dst[((size_t)y * dst_width + x) * 4 + c] = static_cast<uint8_t>(top + (bottom - top) * weight_y + 0.5f);
+			}
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef _TEXTURE_ARRAY_H_
+#define _TEXTURE_ARRAY_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+
+#include "device.h"
+
+// a set of images packed into the layers of one array image, sampled through a single descriptor and sampler
+class TextureArray
+{
+public:
+	TextureArray();
+
+	// decodes the layers in parallel on the job system and resamples each to a square of layer_size, every layer gets a full mip chain
+	void Init(VulkanDevices* devices, const std::vector<std::string>& filenames, uint32_t layer_size);
+	void Cleanup();
+
+	VkImageView GetImageView() { return texture_image_view_; }
+	VkSampler GetSampler() { return texture_sampler_; }
+
+	uint32_t GetLayerCount() { return layer_count_; }
+	uint32_t GetMipLevels() { return mip_levels_; }
+
+protected:
+	void InitSampler(VulkanDevices* devices);
+
+	// bilinearly resamples an rgba8 image, the edges wrap as the layers tile
+	static void ResampleBilinear(const uint8_t* src, uint32_t src_width, uint32_t src_height, uint8_t* dst, uint32_t dst_width, uint32_t dst_height);
+
+protected:
+	VkImage texture_image_;
+	VkDeviceMemory texture_image_memory_;
+	VkImageView texture_image_view_;
+	VkSampler texture_sampler_;
+
+	uint32_t layer_size_;
+	uint32_t layer_count_;
+	uint32_t mip_levels_;
+
+	VkDevice vk_device_handle_;
+};
+
+#endif
@@ -1,64 +1,421 @@
 #include "texture_cache.h"
 
+// staging memory shared by the async uploads, enough for a full resolution rgba8 texture with its mip chain
+static const VkDeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+
+// device memory the cached textures may take before textures without users are evicted
+static const VkDeviceSize TEXTURE_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+// ring offsets are aligned to the largest texel block so every level's copy region is aligned
+static const VkDeviceSize STAGING_RING_ALIGNMENT = 16;
+
 VulkanTextureCache::VulkanTextureCache(VulkanDevices* devices)
 {
 	loaded_texture_size_ = 0;
+	memory_budget_ = TEXTURE_MEMORY_BUDGET;
 	devices_ = devices;
+
+	hit_count_ = 0;
+	miss_count_ = 0;
+	eviction_count_ = 0;
+
+	pending_load_count_ = 0;
+	staging_ring_buffer_ = VK_NULL_HANDLE;
+	staging_ring_memory_ = VK_NULL_HANDLE;
+	staging_ring_data_ = nullptr;
+	ring_head_ = 0;
+	ring_tail_ = 0;
+	ring_used_ = 0;
+	upload_command_pool_ = VK_NULL_HANDLE;
 }
 
 void VulkanTextureCache::Cleanup()
 {
-	for (Texture* texture : textures_)
+	// the workers may still be decoding into textures that are about to be deleted
+	if (pending_load_count_ > 0)
+		devices_->GetJobSystem()->Wait(&load_counter_);
+
+	for (UploadBatch& batch : upload_batches_)
+		vkWaitForFences(devices_->GetLogicalDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+	RetireUploadBatches();
+
+	// textures that never became resident have no vulkan objects to clean up
+	for (auto& handle_entry : handles_)
 	{
-		texture->Cleanup();
-		delete texture;
-		texture = nullptr;
+		TextureHandle* handle = handle_entry.second;
+		if (!handle->resident)
+			delete handle->texture;
+		delete handle;
+	}
+	handles_.clear();
+	decoded_loads_.clear();
+	waiting_uploads_.clear();
+
+	if (upload_command_pool_ != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(devices_->GetLogicalDevice(), upload_command_pool_, nullptr);
+		upload_command_pool_ = VK_NULL_HANDLE;
+
+		vkUnmapMemory(devices_->GetLogicalDevice(), staging_ring_memory_);
+		vkDestroyBuffer(devices_->GetLogicalDevice(), staging_ring_buffer_, nullptr);
+		vkFreeMemory(devices_->GetLogicalDevice(), staging_ring_memory_, nullptr);
+	}
+
+	for (auto& texture_entry : textures_)
+	{
+		texture_entry.second.texture->Cleanup();
+		delete texture_entry.second.texture;
+		texture_entry.second.texture = nullptr;
 	}
 	textures_.clear();
+	unused_textures_.clear();
+	loaded_texture_size_ = 0;
 }
 
 Texture* VulkanTextureCache::LoadTexture(std::string texture_filename)
 {
-	for (Texture* texture : textures_)
-	{
-		if (texture->GetTextureName() == texture_filename)
-		{
-			texture->IncrementUsageCount();
-			return texture;
-		}
-	}
+	// a texture still loading asynchronously is finished rather than loaded twice
+	if (handles_.find(texture_filename) != handles_.end())
+		WaitForLoads();
 
-	Texture* texture = new Texture();
+	Texture* texture = FindTexture(texture_filename);
+	if (texture)
+		return texture;
+
+	miss_count_++;
+
+	texture = new Texture();
 	texture->Init(devices_, texture_filename);
 	texture->IncrementUsageCount();
-	textures_.push_back(texture);
-	loaded_texture_size_ += texture->GetImageSize();
+	AddTexture(texture);
 	return texture;
 }
 
 void VulkanTextureCache::ReleaseTexture(Texture*& texture)
 {
-	bool remove = false;
-	auto texture_it = textures_.begin();
-	for (texture_it = textures_.begin(); texture_it != textures_.end(); texture_it++)
+	auto texture_it = textures_.find(texture->GetTextureName());
+	if (texture_it != textures_.end() && texture_it->second.texture == texture)
 	{
-		if ((*texture_it)->GetTextureName() == texture->GetTextureName())
+		texture->DecrementUsageCount();
+		if (texture->GetUsageCount() == 0)
 		{
-			texture->DecrementUsageCount();
-			if (texture->GetUsageCount() == 0)
-			{
-				texture->Cleanup();
-				delete texture;
-				remove = true;
-				break;
-			}
+			// keep the texture so its next use does not decode it again, it is only freed under budget pressure
+			CacheEntry& entry = texture_it->second;
+			entry.unused = true;
+			entry.unused_position = unused_textures_.insert(unused_textures_.end(), texture_it->first);
+
+			EvictUnusedTextures();
 		}
 	}
 
-	if (remove)
+	texture = nullptr;
+}
+
+void VulkanTextureCache::SetMemoryBudget(VkDeviceSize memory_budget)
+{
+	memory_budget_ = memory_budget;
+	EvictUnusedTextures();
+}
+
+void VulkanTextureCache::AddTexture(Texture* texture)
+{
+	CacheEntry entry = {};
+	entry.texture = texture;
+	entry.memory_size = texture->GetMemorySize();
+	entry.unused = false;
+	entry.unused_position = unused_textures_.end();
+
+	textures_[texture->GetTextureName()] = entry;
+	loaded_texture_size_ += entry.memory_size;
+
+	EvictUnusedTextures();
+}
+
+Texture* VulkanTextureCache::FindTexture(const std::string& texture_filename)
+{
+	auto texture_it = textures_.find(texture_filename);
+	if (texture_it == textures_.end())
+		return nullptr;
+
+	hit_count_++;
+
+	// a texture without users is taken back out of the eviction order
+	CacheEntry& entry = texture_it->second;
+	if (entry.unused)
 	{
+		unused_textures_.erase(entry.unused_position);
+		entry.unused = false;
+		entry.unused_position = unused_textures_.end();
+	}
+
+	entry.texture->IncrementUsageCount();
+	return entry.texture;
+}
+
+void VulkanTextureCache::EvictUnusedTextures()
+{
+	while (loaded_texture_size_ > memory_budget_ && !unused_textures_.empty())
+	{
+		auto texture_it = textures_.find(unused_textures_.front());
+		unused_textures_.pop_front();
+
+		loaded_texture_size_ -= texture_it->second.memory_size;
+		texture_it->second.texture->Cleanup();
+		delete texture_it->second.texture;
 		textures_.erase(texture_it);
+
+		eviction_count_++;
 	}
+}
 
-	texture = nullptr;
-}
\ No newline at end of file
+TextureHandle* VulkanTextureCache::LoadTextureAsync(std::string texture_filename, Texture* placeholder)
+{
+	// a texture that is already loading shares its handle
+	auto handle_it = handles_.find(texture_filename);
+	if (handle_it != handles_.end())
+	{
+		hit_count_++;
+		handle_it->second->texture->IncrementUsageCount();
+		return handle_it->second;
+	}
+
+	TextureHandle* handle = new TextureHandle();
+	handle->filename = texture_filename;
+	handle->placeholder = placeholder;
+	handle->resident = false;
+	handles_[texture_filename] = handle;
+
+	// a texture that is already resident resolves straight away
+	Texture* texture = FindTexture(texture_filename);
+	if (texture)
+	{
+		handle->texture = texture;
+		handle->resident = true;
+		return handle;
+	}
+
+	miss_count_++;
+
+	if (upload_command_pool_ == VK_NULL_HANDLE)
+		InitUploads();
+
+	handle->texture = new Texture();
+	handle->texture->IncrementUsageCount();
+	pending_load_count_++;
+
+	// the worker only touches the texture's cpu side, the results are picked up by Update
+	devices_->GetJobSystem()->Submit([this, handle](uint32_t worker_index)
+	{
+		DecodedLoad load = { handle, nullptr };
+		try
+		{
+			handle->texture->Decode(devices_, handle->filename);
+		}
+		catch (...)
+		{
+			load.exception = std::current_exception();
+		}
+
+		std::unique_lock<std::mutex> decoded_lock(decoded_mutex_);
+		decoded_loads_.push_back(load);
+	}, 1, &load_counter_);
+
+	return handle;
+}
+
+bool VulkanTextureCache::Update()
+{
+	if (pending_load_count_ == 0)
+		return false;
+
+	bool resolved = RetireUploadBatches();
+
+	std::unique_lock<std::mutex> decoded_lock(decoded_mutex_);
+	while (!decoded_loads_.empty())
+	{
+		DecodedLoad load = decoded_loads_.front();
+		decoded_loads_.pop_front();
+
+		// a failed load is as fatal as it is when loading synchronously
+		if (load.exception)
+			std::rethrow_exception(load.exception);
+
+		waiting_uploads_.push_back(load.handle);
+	}
+	decoded_lock.unlock();
+
+	if (waiting_uploads_.empty())
+		return resolved;
+
+	UploadBatch batch = {};
+	devices_->CreateCommandBuffers(upload_command_pool_, &batch.command_buffer);
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(batch.command_buffer, &begin_info);
+
+	// textures are uploaded in the order they finished decoding until the ring is full, the rest wait for a later frame
+	while (!waiting_uploads_.empty())
+	{
+		TextureHandle* handle = waiting_uploads_.front();
+		VkDeviceSize decoded_size = handle->texture->GetDecodedSize();
+
+		if (decoded_size > STAGING_RING_SIZE)
+		{
+			// a texture larger than the whole ring is uploaded through its own staging buffer
+			handle->texture->Upload(devices_);
+			handle->resident = true;
+			AddTexture(handle->texture);
+			pending_load_count_--;
+			resolved = true;
+		}
+		else
+		{
+			VkDeviceSize offset, allocated;
+			if (!AllocateStaging(decoded_size, offset, allocated))
+				break;
+
+			handle->texture->RecordUpload(devices_, batch.command_buffer, staging_ring_buffer_, offset, staging_ring_data_ + offset);
+			batch.ring_bytes += allocated;
+			batch.handles.push_back(handle);
+		}
+
+		waiting_uploads_.pop_front();
+	}
+
+	if (vkEndCommandBuffer(batch.command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record texture upload command buffer!");
+	}
+
+	if (batch.handles.empty())
+	{
+		vkFreeCommandBuffers(devices_->GetLogicalDevice(), upload_command_pool_, 1, &batch.command_buffer);
+		return resolved;
+	}
+
+	VkFenceCreateInfo fence_info = {};
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	if (vkCreateFence(devices_->GetLogicalDevice(), &fence_info, nullptr, &batch.fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create fence!");
+	}
+
+	// the batch is submitted to the queue the scene is rendered on, so frames submitted after it see the uploaded images
+	batch.ring_end = ring_head_;
+	devices_->SubmitTransfer(batch.command_buffer, batch.fence);
+	upload_batches_.push_back(batch);
+
+	return resolved;
+}
+
+void VulkanTextureCache::WaitForLoads()
+{
+	while (pending_load_count_ > 0)
+	{
+		devices_->GetJobSystem()->Wait(&load_counter_);
+
+		// every batch is finished with before the next update, so it can fill the whole ring
+		Update();
+		if (!upload_batches_.empty())
+			vkWaitForFences(devices_->GetLogicalDevice(), 1, &upload_batches_.back().fence, VK_TRUE, UINT64_MAX);
+	}
+}
+
+void VulkanTextureCache::InitUploads()
+{
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = devices_->GetQueueFamilyIndices().graphics_family;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	if (vkCreateCommandPool(devices_->GetLogicalDevice(), &pool_info, nullptr, &upload_command_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create command pool!");
+	}
+
+	devices_->CreateBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_ring_buffer_, staging_ring_memory_);
+
+	void* data;
+	vkMapMemory(devices_->GetLogicalDevice(), staging_ring_memory_, 0, STAGING_RING_SIZE, 0, &data);
+	staging_ring_data_ = static_cast<uint8_t*>(data);
+}
+
+bool VulkanTextureCache::RetireUploadBatches()
+{
+	bool resolved = false;
+
+	// batches complete in submission order, so only the oldest needs checking
+	while (!upload_batches_.empty() && vkGetFenceStatus(devices_->GetLogicalDevice(), upload_batches_.front().fence) == VK_SUCCESS)
+	{
+		UploadBatch& batch = upload_batches_.front();
+
+		for (TextureHandle* handle : batch.handles)
+		{
+			handle->resident = true;
+			AddTexture(handle->texture);
+			pending_load_count_--;
+		}
+
+		ring_tail_ = batch.ring_end;
+		ring_used_ -= batch.ring_bytes;
+
+		vkDestroyFence(devices_->GetLogicalDevice(), batch.fence, nullptr);
+		vkFreeCommandBuffers(devices_->GetLogicalDevice(), upload_command_pool_, 1, &batch.command_buffer);
+		upload_batches_.pop_front();
+
+		resolved = true;
+	}
+
+	return resolved;
+}
+
+bool VulkanTextureCache::AllocateStaging(VkDeviceSize size, VkDeviceSize& offset, VkDeviceSize& allocated)
+{
+	size = (size + STAGING_RING_ALIGNMENT - 1) & ~(STAGING_RING_ALIGNMENT - 1);
+	allocated = 0;
+
+	// with nothing in flight the whole ring is free
+	if (ring_used_ == 0)
+	{
+		ring_head_ = 0;
+		ring_tail_ = 0;
+	}
+	else if (ring_head_ == ring_tail_)
+	{
+		return false;
+	}
+
+	if (ring_head_ >= ring_tail_)
+	{
+		if (ring_head_ + size <= STAGING_RING_SIZE)
+		{
+			offset = ring_head_;
+		}
+		else if (size <= ring_tail_)
+		{
+			// the end of the ring is skipped and freed along with this allocation
+			allocated = STAGING_RING_SIZE - ring_head_;
+			offset = 0;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else
+	{
+		if (ring_head_ + size > ring_tail_)
+			return false;
+
+		offset = ring_head_;
+	}
+
+	allocated += size;
+	ring_head_ = offset + size;
+	ring_used_ += allocated;
+	return true;
+}
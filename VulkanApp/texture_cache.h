@@ -2,8 +2,25 @@
 #define _TEXTURE_CACHE_H_
 
 #include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <exception>
 
 #include "texture.h"
+#include "job_system.h"
+
+// a texture loaded on the job system, it resolves to its placeholder until the texture is resident
+struct TextureHandle
+{
+	std::string filename;
+	Texture* texture;
+	Texture* placeholder;
+	bool resident;
+
+	inline Texture* Get() { return resident ? texture : placeholder; }
+};
 
 class VulkanTextureCache
 {
@@ -13,13 +30,94 @@ public:
 	void Cleanup();
 
 	Texture* LoadTexture(std::string texture_filepath);
+
+	// a texture with no users is kept resident until the cache is over its memory budget
 	void ReleaseTexture(Texture*& texture);
 
+	// evicts the least recently released textures until the resident textures fit in the budget
+	void SetMemoryBudget(VkDeviceSize memory_budget);
+
+	// decodes the texture on a job system worker and uploads it from Update, the handle is owned by the cache
+	// the handle holds its texture's reference until the cache is cleaned up, so the texture is never evicted from under it
+	TextureHandle* LoadTextureAsync(std::string texture_filepath, Texture* placeholder);
+
+	// uploads the textures decoded since the last call in one batch through the staging ring, call once a frame from the render thread
+	// returns true when any handle has become resident, so descriptors bound to its placeholder can be rewritten
+	bool Update();
+
+	// blocks until every async load is resident
+	void WaitForLoads();
+
+	inline uint64_t GetHitCount() { return hit_count_; }
+	inline uint64_t GetMissCount() { return miss_count_; }
+	inline uint64_t GetEvictionCount() { return eviction_count_; }
+	inline VkDeviceSize GetResidentSize() { return loaded_texture_size_; }
+	inline VkDeviceSize GetMemoryBudget() { return memory_budget_; }
+
+protected:
+	// a resident texture, textures without users are also in the unused list
+	struct CacheEntry
+	{
+		Texture* texture;
+		VkDeviceSize memory_size;
+		bool unused;
+		std::list<std::string>::iterator unused_position;
+	};
+
+	// a batch of uploads in flight, its staging ring bytes are free once its fence is signalled
+	struct UploadBatch
+	{
+		VkCommandBuffer command_buffer;
+		VkFence fence;
+		VkDeviceSize ring_end;
+		VkDeviceSize ring_bytes;
+		std::vector<TextureHandle*> handles;
+	};
+
+	// a decoded texture waiting for space in the staging ring
+	struct DecodedLoad
+	{
+		TextureHandle* handle;
+		std::exception_ptr exception;
+	};
+
+	void AddTexture(Texture* texture);
+	Texture* FindTexture(const std::string& texture_filename);
+	void EvictUnusedTextures();
+
+	void InitUploads();
+	bool RetireUploadBatches();
+	bool AllocateStaging(VkDeviceSize size, VkDeviceSize& offset, VkDeviceSize& allocated);
+
 protected:
 	VulkanDevices* devices_;
 	VkDeviceSize loaded_texture_size_;
+	VkDeviceSize memory_budget_;
+
+	std::unordered_map<std::string, CacheEntry> textures_;
+
+	// least recently released at the front
+	std::list<std::string> unused_textures_;
+
+	uint64_t hit_count_, miss_count_, eviction_count_;
+
+	std::unordered_map<std::string, TextureHandle*> handles_;
+	JobCounter load_counter_;
+	uint32_t pending_load_count_;
+
+	// filled by the workers as they finish decoding, drained by Update
+	std::mutex decoded_mutex_;
+	std::deque<DecodedLoad> decoded_loads_;
+	std::deque<TextureHandle*> waiting_uploads_;
+
+	// persistently mapped staging memory shared by every batch, allocated from the head and freed from the tail in submission order
+	VkBuffer staging_ring_buffer_;
+	VkDeviceMemory staging_ring_memory_;
+	uint8_t* staging_ring_data_;
+	VkDeviceSize ring_head_, ring_tail_, ring_used_;
 
-	std::vector<Texture*> textures_;
+	VkCommandPool upload_command_pool_;
+	std::deque<UploadBatch> upload_batches_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,184 @@
+#include "transient_image_pool.h"
+#include <algorithm>
+
+void TransientImagePool::Init(VulkanDevices* devices)
+{
+	devices_ = devices;
+	memory_ = VK_NULL_HANDLE;
+	memory_size_ = 0;
+	unaliased_memory_size_ = 0;
+}
+
+void TransientImagePool::Cleanup()
+{
+	for (TransientImage& transient_image : images_)
+	{
+		if (transient_image.image_view != VK_NULL_HANDLE)
+			vkDestroyImageView(devices_->GetLogicalDevice(), transient_image.image_view, nullptr);
+
+		vkDestroyImage(devices_->GetLogicalDevice(), transient_image.image, nullptr);
+	}
+	images_.clear();
+
+	if (memory_ != VK_NULL_HANDLE)
+	{
+		vkFreeMemory(devices_->GetLogicalDevice(), memory_, nullptr);
+		memory_ = VK_NULL_HANDLE;
+	}
+
+	memory_size_ = 0;
+	unaliased_memory_size_ = 0;
+}
+
+uint32_t TransientImagePool::AddImage(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, uint32_t first_pass, uint32_t last_pass)
+{
+	VkImageCreateInfo image_info = {};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.extent.width = width;
+	image_info.extent.height = height;
+	image_info.extent.depth = 1;
+	image_info.mipLevels = 1;
+	image_info.arrayLayers = 1;
+	image_info.format = format;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	image_info.usage = usage;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_info.flags = 0;
+
+	TransientImage transient_image = {};
+	transient_image.format = format;
+	transient_image.first_pass = first_pass;
+	transient_image.last_pass = last_pass;
+	transient_image.image_view = VK_NULL_HANDLE;
+	transient_image.aliased = false;
+
+	if (vkCreateImage(devices_->GetLogicalDevice(), &image_info, nullptr, &transient_image.image) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create transient image!");
+	}
+
+	vkGetImageMemoryRequirements(devices_->GetLogicalDevice(), transient_image.image, &transient_image.memory_requirements);
+
+	images_.push_back(transient_image);
+	return static_cast<uint32_t>(images_.size() - 1);
+}
+
+void TransientImagePool::Allocate()
+{
+	// place the images in order of first use
+	std::vector<uint32_t> image_order(images_.size());
+	for (uint32_t i = 0; i < image_order.size(); i++)
+		image_order[i] = i;
+
+	std::stable_sort(image_order.begin(), image_order.end(), [&](uint32_t a, uint32_t b) { return images_[a].first_pass < images_[b].first_pass; });
+
+	std::vector<MemoryRange> memory_ranges;
+	uint32_t memory_type_bits = UINT32_MAX;
+	unaliased_memory_size_ = 0;
+
+	for (uint32_t image_index : image_order)
+	{
+		TransientImage& transient_image = images_[image_index];
+		const VkMemoryRequirements& requirements = transient_image.memory_requirements;
+
+		memory_type_bits &= requirements.memoryTypeBits;
+		unaliased_memory_size_ += requirements.size;
+
+		// reuse the first range whose images have all finished before this one starts
+		MemoryRange* placement = nullptr;
+		for (MemoryRange& memory_range : memory_ranges)
+		{
+			if (memory_range.last_pass < transient_image.first_pass && memory_range.size >= requirements.size && memory_range.offset % requirements.alignment == 0)
+			{
+				placement = &memory_range;
+				break;
+			}
+		}
+
+		// otherwise start a new range at the end of the block
+		if (!placement)
+		{
+			VkDeviceSize end = memory_ranges.empty() ? 0 : memory_ranges.back().offset + memory_ranges.back().size;
+
+			MemoryRange memory_range = {};
+			memory_range.offset = (end + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+			memory_range.size = requirements.size;
+			memory_ranges.push_back(memory_range);
+			placement = &memory_ranges.back();
+		}
+
+		transient_image.offset = placement->offset;
+		placement->last_pass = transient_image.last_pass;
+		placement->images.push_back(image_index);
+	}
+
+	if (memory_type_bits == 0)
+	{
+		throw std::runtime_error("failed to find a memory type for every transient image!");
+	}
+
+	// every image in a shared range is overwritten by the others between its own uses
+	memory_size_ = 0;
+	for (MemoryRange& memory_range : memory_ranges)
+	{
+		for (uint32_t image_index : memory_range.images)
+			images_[image_index].aliased = (memory_range.images.size() > 1);
+
+		memory_size_ = std::max(memory_size_, memory_range.offset + memory_range.size);
+	}
+
+	if (memory_size_ == 0)
+		return;
+
+	VkMemoryAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = memory_size_;
+	alloc_info.memoryTypeIndex = devices_->FindMemoryType(memory_type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory_size_);
+
+	if (vkAllocateMemory(devices_->GetLogicalDevice(), &alloc_info, nullptr, &memory_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate transient image memory!");
+	}
+
+	for (TransientImage& transient_image : images_)
+	{
+		vkBindImageMemory(devices_->GetLogicalDevice(), transient_image.image, memory_, transient_image.offset);
+		transient_image.image_view = devices_->CreateImageView(transient_image.image, transient_image.format, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+}
+
+void TransientImagePool::RecordAcquireBarriers(VkCommandBuffer command_buffer, uint32_t pass, VkImageLayout layout)
+{
+	std::vector<VkImageMemoryBarrier> barriers;
+
+	for (TransientImage& transient_image : images_)
+	{
+		if (!transient_image.aliased || transient_image.first_pass != pass)
+			continue;
+
+		// the earlier users of the memory only need to have finished, nothing they wrote is kept
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = transient_image.image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barriers.push_back(barrier);
+	}
+
+	if (barriers.empty())
+		return;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+}
@@ -0,0 +1,60 @@
+#ifndef _TRANSIENT_IMAGE_POOL_H_
+#define _TRANSIENT_IMAGE_POOL_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "device.h"
+
+// images used by a fixed sequence of passes each frame, images whose passes never overlap are bound to the same memory
+class TransientImagePool
+{
+public:
+	void Init(VulkanDevices* devices);
+	void Cleanup();
+
+	// creates an image used from its first to its last pass of the frame inclusive, its memory is bound by Allocate
+	uint32_t AddImage(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, uint32_t first_pass, uint32_t last_pass);
+
+	// places every image in one block of memory and creates their views, images are left in the undefined layout
+	void Allocate();
+
+	// an image sharing memory holds undefined contents when its first pass starts, so it is transitioned from undefined there
+	// the images are only used by compute passes, the barrier waits for the compute work recorded before it
+	void RecordAcquireBarriers(VkCommandBuffer command_buffer, uint32_t pass, VkImageLayout layout);
+
+	inline uint32_t GetImageCount() { return static_cast<uint32_t>(images_.size()); }
+	inline VkImage GetImage(uint32_t index) { return images_[index].image; }
+	inline VkImageView GetImageView(uint32_t index) { return images_[index].image_view; }
+	inline VkDeviceSize GetMemorySize() { return memory_size_; }
+	inline VkDeviceSize GetUnaliasedMemorySize() { return unaliased_memory_size_; }
+
+protected:
+	struct TransientImage
+	{
+		VkImage image;
+		VkImageView image_view;
+		VkFormat format;
+		VkMemoryRequirements memory_requirements;
+		VkDeviceSize offset;
+		uint32_t first_pass, last_pass;
+		bool aliased;
+	};
+
+	// a range of the memory block and the images placed in it, in pass order
+	struct MemoryRange
+	{
+		VkDeviceSize offset, size;
+		uint32_t last_pass;
+		std::vector<uint32_t> images;
+	};
+
+protected:
+	VulkanDevices* devices_;
+
+	std::vector<TransientImage> images_;
+	VkDeviceMemory memory_;
+	VkDeviceSize memory_size_, unaliased_memory_size_;
+};
+
+#endif
@@ -6,31 +6,42 @@ layout(location = 1) in vec2 inTexCoord;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in uint inMatIndex;
 
+// index of the chunk this instance draws, taken from the visible chunk list
+layout(location = 4) in uint inChunkIndex;
+
 #define TERRAIN_CHUNK_COUNT 25
 #define TERRAIN_CHUNK_SIZE 5
 
-layout(binding = 0) uniform MatrixBuffer
+layout(binding = 0) uniform CameraBuffer
 {
-	mat4 model[TERRAIN_CHUNK_COUNT];
 	mat4 view;
 	mat4 proj;
-} matrices;
+	vec4 camera_pos;
+} camera;
 
 layout(binding = 1) uniform TerrainDataBuffer
 {
 	float terrain_size;
-	vec3 camera_pos;
+	vec3 padding;
 	vec4 water_size;
 } terrain_data;
 
 layout(binding = 2) uniform sampler heightmapSampler;
-layout(binding = 3) uniform texture2D heightmaps[TERRAIN_CHUNK_COUNT];
+layout(binding = 3) uniform texture2DArray heightmaps;
 layout(binding = 4) uniform texture2D watermap;
 
+// only rewritten when the player moves between chunks
+layout(binding = 10) uniform ChunkPlacementBuffer
+{
+	vec4 chunk_offsets[TERRAIN_CHUNK_COUNT];	// xyz translation, w scale
+	mat4 water_world;
+} placement;
+
 
+// invariant so the depth pre-pass in terrain_depth.vert produces exactly the same depth
 out gl_PerVertex
 {
-	vec4 gl_Position;
+	invariant vec4 gl_Position;
 };
 
 layout(location = 0) out vec2 fragTexCoord;
@@ -38,7 +49,7 @@ layout(location = 1) out vec3 worldNormal;
 layout(location = 2) out vec3 miscFactors;
 layout(location = 3) out vec4 viewPosition;
 
-vec3 Sobel(vec2 uv)
+vec3 Sobel(vec2 uv, int chunkIndex)
 {
 	vec2 texelSize = vec2 (1.0f / terrain_data.terrain_size, 1.0f / terrain_data.terrain_size);
 
@@ -55,16 +66,16 @@ vec3 Sobel(vec2 uv)
 	vec2 offset22 = uv + vec2(texelSize.x, texelSize.y);
 
 	// get the eight samples surrounding the current pixel
-	float height00 = texture(sampler2D(heightmaps[gl_InstanceIndex], heightmapSampler), offset00).r; 
-	float height10 = texture(sampler2D(heightmaps[gl_InstanceIndex], heightmapSampler), offset10).r; 
-	float height20 = texture(sampler2D(heightmaps[gl_InstanceIndex], heightmapSampler), offset20).r; 
+	float height00 = texture(sampler2DArray(heightmaps, heightmapSampler), vec3(offset00, chunkIndex)).r; 
+	float height10 = texture(sampler2DArray(heightmaps, heightmapSampler), vec3(offset10, chunkIndex)).r; 
+	float height20 = texture(sampler2DArray(heightmaps, heightmapSampler), vec3(offset20, chunkIndex)).r; 
 	
-	float height01 = texture(sampler2D(heightmaps[gl_InstanceIndex], heightmapSampler), offset01).r; 
-	float height21 = texture(sampler2D(heightmaps[gl_InstanceIndex], heightmapSampler), offset21).r; 
+	float height01 = texture(sampler2DArray(heightmaps, heightmapSampler), vec3(offset01, chunkIndex)).r; 
+	float height21 = texture(sampler2DArray(heightmaps, heightmapSampler), vec3(offset21, chunkIndex)).r; 
 	
-	float height02 = texture(sampler2D(heightmaps[gl_InstanceIndex], heightmapSampler), offset02).r; 
-	float height12 = texture(sampler2D(heightmaps[gl_InstanceIndex], heightmapSampler), offset12).r; 
-	float height22 = texture(sampler2D(heightmaps[gl_InstanceIndex], heightmapSampler), offset22).r; 
+	float height02 = texture(sampler2DArray(heightmaps, heightmapSampler), vec3(offset02, chunkIndex)).r; 
+	float height12 = texture(sampler2DArray(heightmaps, heightmapSampler), vec3(offset12, chunkIndex)).r; 
+	float height22 = texture(sampler2DArray(heightmaps, heightmapSampler), vec3(offset22, chunkIndex)).r; 
 
 	// evaluate the sobel filters
 	float Gx = height00 - height20 + 2.0f * height01 - 2.0f * height21 + height02 - height22;
@@ -79,20 +90,21 @@ vec3 Sobel(vec2 uv)
 
 void main()
 {
+	int chunkIndex = int(inChunkIndex);
 	vec4 mappedPosition = vec4(inPosition, 1.0f);
 
 	// blend heightmap data at chunk edges
-	if(inTexCoord.x == 1.0 && gl_InstanceIndex % TERRAIN_CHUNK_SIZE != TERRAIN_CHUNK_SIZE - 1)
-		mappedPosition.z = texelFetch(sampler2D(heightmaps[gl_InstanceIndex + 1], heightmapSampler), ivec2(vec2(0.0, inTexCoord.y) * terrain_data.terrain_size), 0).r;
-	else if (inTexCoord.y == 1.0 && gl_InstanceIndex > TERRAIN_CHUNK_SIZE - 1)
-		mappedPosition.z = texelFetch(sampler2D(heightmaps[gl_InstanceIndex - TERRAIN_CHUNK_SIZE], heightmapSampler), ivec2(vec2(inTexCoord.x, 0.0) * terrain_data.terrain_size), 0).r;
+	if(inTexCoord.x == 1.0 && chunkIndex % TERRAIN_CHUNK_SIZE != TERRAIN_CHUNK_SIZE - 1)
+		mappedPosition.z = texelFetch(sampler2DArray(heightmaps, heightmapSampler), ivec3(vec2(0.0, inTexCoord.y) * terrain_data.terrain_size, chunkIndex + 1), 0).r;
+	else if (inTexCoord.y == 1.0 && chunkIndex > TERRAIN_CHUNK_SIZE - 1)
+		mappedPosition.z = texelFetch(sampler2DArray(heightmaps, heightmapSampler), ivec3(vec2(inTexCoord.x, 0.0) * terrain_data.terrain_size, chunkIndex - TERRAIN_CHUNK_SIZE), 0).r;
 	else
-		mappedPosition.z = texelFetch(sampler2D(heightmaps[gl_InstanceIndex], heightmapSampler), ivec2(inTexCoord * terrain_data.terrain_size), 0).r;
+		mappedPosition.z = texelFetch(sampler2DArray(heightmaps, heightmapSampler), ivec3(inTexCoord * terrain_data.terrain_size, chunkIndex), 0).r;
 
 	// get watermap data
 	vec2 watermapIndices = vec2(0, 0);
-	watermapIndices.y = (TERRAIN_CHUNK_SIZE - 1) - (gl_InstanceIndex  / TERRAIN_CHUNK_SIZE);
-	watermapIndices.x = gl_InstanceIndex - ((gl_InstanceIndex / TERRAIN_CHUNK_SIZE) * TERRAIN_CHUNK_SIZE);
+	watermapIndices.y = (TERRAIN_CHUNK_SIZE - 1) - (chunkIndex  / TERRAIN_CHUNK_SIZE);
+	watermapIndices.x = chunkIndex - ((chunkIndex / TERRAIN_CHUNK_SIZE) * TERRAIN_CHUNK_SIZE);
 	vec2 watermapChunkDimensions = vec2(1280.0, 1280.0) / float(TERRAIN_CHUNK_SIZE);
 	vec2 watermapCoords = vec2(inTexCoord.x, inTexCoord.y) * watermapChunkDimensions;
 	watermapCoords = watermapCoords + (watermapChunkDimensions * watermapIndices);
@@ -101,10 +113,13 @@ void main()
 
 	//mappedPosition.z = waterValue;
 
-	miscFactors = vec3(mappedPosition.z, clamp((mappedPosition.z - waterValue) * 20.0, 0, 1), float(gl_InstanceIndex) / float(TERRAIN_CHUNK_COUNT));
+	miscFactors = vec3(mappedPosition.z, clamp((mappedPosition.z - waterValue) * 20.0, 0, 1), float(chunkIndex) / float(TERRAIN_CHUNK_COUNT));
+
+	vec4 chunkOffset = placement.chunk_offsets[chunkIndex];
+	vec4 worldPosition = vec4(mappedPosition.xyz * chunkOffset.w + chunkOffset.xyz, 1.0f);
 
-	viewPosition = matrices.view * matrices.model[gl_InstanceIndex] * mappedPosition;
-	gl_Position = matrices.proj * viewPosition;
+	viewPosition = camera.view * worldPosition;
+	gl_Position = camera.proj * viewPosition;
 	fragTexCoord = inTexCoord;
-	worldNormal = Sobel(inTexCoord);
+	worldNormal = Sobel(inTexCoord, chunkIndex);
 }
\ No newline at end of file
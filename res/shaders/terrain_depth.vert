@@ -0,0 +1,62 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// depth only terrain pass, the position must be computed exactly as in terrain.vert
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec3 inNormal;
+layout(location = 3) in uint inMatIndex;
+
+// index of the chunk this instance draws, taken from the visible chunk list
+layout(location = 4) in uint inChunkIndex;
+
+#define TERRAIN_CHUNK_COUNT 25
+#define TERRAIN_CHUNK_SIZE 5
+
+layout(binding = 0) uniform CameraBuffer
+{
+	mat4 view;
+	mat4 proj;
+	vec4 camera_pos;
+} camera;
+
+layout(binding = 1) uniform TerrainDataBuffer
+{
+	float terrain_size;
+	vec3 padding;
+	vec4 water_size;
+} terrain_data;
+
+layout(binding = 2) uniform sampler heightmapSampler;
+layout(binding = 3) uniform texture2DArray heightmaps;
+
+layout(binding = 10) uniform ChunkPlacementBuffer
+{
+	vec4 chunk_offsets[TERRAIN_CHUNK_COUNT];	// xyz translation, w scale
+	mat4 water_world;
+} placement;
+
+out gl_PerVertex
+{
+	invariant vec4 gl_Position;
+};
+
+void main()
+{
+	int chunkIndex = int(inChunkIndex);
+	vec4 mappedPosition = vec4(inPosition, 1.0f);
+
+	// blend heightmap data at chunk edges
+	if(inTexCoord.x == 1.0 && chunkIndex % TERRAIN_CHUNK_SIZE != TERRAIN_CHUNK_SIZE - 1)
+		mappedPosition.z = texelFetch(sampler2DArray(heightmaps, heightmapSampler), ivec3(vec2(0.0, inTexCoord.y) * terrain_data.terrain_size, chunkIndex + 1), 0).r;
+	else if (inTexCoord.y == 1.0 && chunkIndex > TERRAIN_CHUNK_SIZE - 1)
+		mappedPosition.z = texelFetch(sampler2DArray(heightmaps, heightmapSampler), ivec3(vec2(inTexCoord.x, 0.0) * terrain_data.terrain_size, chunkIndex - TERRAIN_CHUNK_SIZE), 0).r;
+	else
+		mappedPosition.z = texelFetch(sampler2DArray(heightmaps, heightmapSampler), ivec3(inTexCoord * terrain_data.terrain_size, chunkIndex), 0).r;
+
+	vec4 chunkOffset = placement.chunk_offsets[chunkIndex];
+	vec4 worldPosition = vec4(mappedPosition.xyz * chunkOffset.w + chunkOffset.xyz, 1.0f);
+
+	gl_Position = camera.proj * (camera.view * worldPosition);
+}
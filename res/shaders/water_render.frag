@@ -14,12 +14,18 @@ layout(location = 4) in vec4 viewPosition;
 layout(location = 0) out vec4 outColor;
 
 // inputs
+layout(binding = 0) uniform CameraBuffer
+{
+	mat4 view;
+	mat4 proj;
+	vec4 camera_pos;
+} camera;
+
 layout(binding = 3) uniform FogBuffer
 {
 	float extinction;
 	float in_scattering;
-	float camera_height;
-	float padding;
+	vec2 padding;
 } fog_data;
 
 layout(binding = 4) uniform ColorBuffer
@@ -55,8 +61,8 @@ void main()
 
 	// use smoothstep function to determine extinction and in-scattering
 
-	float be = fog_data.extinction * smoothstep(0.0, 6.0, fog_data.camera_height - viewPosition.z);
-	float bi = fog_data.in_scattering * smoothstep(0.0, 100.0, fog_data.camera_height - viewPosition.z);
+	float be = fog_data.extinction * smoothstep(0.0, 6.0, camera.camera_pos.z - viewPosition.z);
+	float bi = fog_data.in_scattering * smoothstep(0.0, 100.0, camera.camera_pos.z - viewPosition.z);
 
 	float ext = exp(-dist * be);
 	float insc = exp(-dist * bi);
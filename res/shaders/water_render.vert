@@ -9,12 +9,12 @@ layout(location = 3) in uint inMatIndex;
 #define TERRAIN_CHUNK_COUNT 25
 #define TERRAIN_CHUNK_SIZE 5
 
-layout(binding = 0) uniform MatrixBuffer
+layout(binding = 0) uniform CameraBuffer
 {
-	mat4 model;
 	mat4 view;
 	mat4 proj;
-} matrices;
+	vec4 camera_pos;
+} camera;
 
 layout(binding = 1) uniform WaterDataBuffer
 {
@@ -26,6 +26,13 @@ layout(binding = 1) uniform WaterDataBuffer
 
 layout(binding = 2, r16f) uniform image2D watermap;
 
+// only rewritten when the player moves between chunks
+layout(binding = 5) uniform ChunkPlacementBuffer
+{
+	vec4 chunk_offsets[TERRAIN_CHUNK_COUNT];
+	mat4 water_world;
+} placement;
+
 
 out gl_PerVertex
 {
@@ -89,9 +96,9 @@ void main()
 
 	miscFactors = water_data.camera_pos;
 
-	worldPosition = matrices.model * mappedPosition;
-	viewPosition = matrices.view * worldPosition;
-	gl_Position = matrices.proj * viewPosition;
+	worldPosition = placement.water_world * mappedPosition;
+	viewPosition = camera.view * worldPosition;
+	gl_Position = camera.proj * viewPosition;
 	fragTexCoord = inTexCoord;
 	worldNormal = Sobel(inTexCoord);
 }
\ No newline at end of file
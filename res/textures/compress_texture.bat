@@ -0,0 +1,2 @@
+..\..\x64\Release\TextureCompressor.exe %1 %2
+pause
\ No newline at end of file